@@ -0,0 +1,122 @@
+struct Object {
+  boundsCenter : vec4f, // Local space
+  boundsExtent : vec4f,
+  transformIndex : u32,
+  batch : u32,
+}
+
+struct Batch {
+  indexCount : u32,
+  firstIndex : u32,
+  baseVertex : i32,
+  firstInstance : u32, // First instance of the batch in a region of the instances buffer
+  shadowIndexCount : u32, // LOD drawn by the light views
+  shadowFirstIndex : u32,
+  meshletCount : u32, // Culled by shaderMeshletCulling.wgsl for the camera instead of as an object, 0 when it draws a LOD
+  shadowMeshletCount : u32, // Same for the light views
+  clusterFirstIndex : u32, // Of the batch in each region of the cluster indices
+  transformIndex : u32, // Uniforms slot of the first instance
+  _padding0 : u32, // 48 bytes like GpuCulling::BatchData
+  _padding1 : u32,
+}
+
+struct Uniform {
+  modelMatrix : mat4x4f,
+  normalModelMatrix : mat4x4f,
+}
+
+struct View {
+  planes : array<vec4f, 6>,
+}
+
+struct DrawIndexedIndirectArgs {
+  indexCount : atomic<u32>, // Summed by the meshlet culling for clustered batches
+  instanceCount : atomic<u32>,
+  firstIndex : u32,
+  baseVertex : i32,
+  firstInstance : u32,
+}
+
+struct Params {
+  objectCount : u32,
+  batchCount : u32,
+  batchCapacity : u32,
+  viewCount : u32,
+  instanceStride : u32, // Size of a region of the instances buffer, region 0 is not culled
+  meshletCount : u32,
+  clusterIndexStride : u32, // Size of a region of the cluster indices
+  cameraPosition : vec4f,
+}
+
+@group(0) @binding(0) var<storage, read> objects : array<Object>;
+@group(0) @binding(1) var<storage, read> uniforms : array<Uniform>;
+@group(0) @binding(2) var<storage, read> views : array<View>;
+@group(0) @binding(3) var<storage, read_write> drawArgs : array<DrawIndexedIndirectArgs>;
+@group(0) @binding(4) var<uniform> params : Params;
+@group(0) @binding(5) var<storage, read> batches : array<Batch>;
+@group(0) @binding(6) var<storage, read_write> instances : array<u32>;
+
+// One invocation per batch and view, the batch draws nothing until cs_main adds its visible instances
+@compute @workgroup_size(64)
+fn cs_reset(@builtin(global_invocation_id) id : vec3u) {
+  let batchIndex = id.x;
+  let viewIndex = id.y;
+  if (batchIndex >= params.batchCount || viewIndex >= params.viewCount) {
+    return;
+  }
+
+  let batch = batches[batchIndex];
+  let argsIndex = viewIndex * params.batchCapacity + batchIndex;
+  let isCamera = viewIndex == 0u;
+
+  // Its single instance draws the triangles of its visible meshlets, compacted in the region of the view with their
+  // baseVertex. Region 0 of the instances buffer maps the instance to the slot of its mesh.
+  if (select(batch.shadowMeshletCount, batch.meshletCount, isCamera) > 0u) {
+    atomicStore(&drawArgs[argsIndex].indexCount, 0u);
+    atomicStore(&drawArgs[argsIndex].instanceCount, 1u);
+    drawArgs[argsIndex].firstIndex = viewIndex * params.clusterIndexStride + batch.clusterFirstIndex;
+    drawArgs[argsIndex].baseVertex = 0;
+    drawArgs[argsIndex].firstInstance = batch.firstInstance;
+    return;
+  }
+
+  atomicStore(&drawArgs[argsIndex].indexCount, select(batch.shadowIndexCount, batch.indexCount, isCamera));
+  atomicStore(&drawArgs[argsIndex].instanceCount, 0u);
+  drawArgs[argsIndex].firstIndex = select(batch.shadowFirstIndex, batch.firstIndex, isCamera);
+  drawArgs[argsIndex].baseVertex = batch.baseVertex;
+  drawArgs[argsIndex].firstInstance = (viewIndex + 1u) * params.instanceStride + batch.firstInstance;
+}
+
+// One invocation per object and view
+@compute @workgroup_size(64)
+fn cs_main(@builtin(global_invocation_id) id : vec3u) {
+  let objectIndex = id.x;
+  let viewIndex = id.y;
+  if (objectIndex >= params.objectCount || viewIndex >= params.viewCount) {
+    return;
+  }
+
+  let object = objects[objectIndex];
+  let batch = batches[object.batch];
+  let clustered = select(batch.shadowMeshletCount, batch.meshletCount, viewIndex == 0u) > 0u;
+  if (batch.indexCount == 0u || clustered) {
+    return;
+  }
+
+  // World space box around the transformed local box
+  let model = uniforms[object.transformIndex].modelMatrix;
+  let center = (model * vec4f(object.boundsCenter.xyz, 1.0)).xyz;
+  let absModel = mat3x3f(abs(model[0].xyz), abs(model[1].xyz), abs(model[2].xyz));
+  let extent = absModel * object.boundsExtent.xyz;
+
+  for (var i = 0u; i < 6u; i++) {
+    let plane = views[viewIndex].planes[i];
+    if (dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extent) < 0.0) {
+      return;
+    }
+  }
+
+  // Visible instances of a batch are packed at the beginning of its range, in any order
+  let instance = atomicAdd(&drawArgs[viewIndex * params.batchCapacity + object.batch].instanceCount, 1u);
+  instances[(viewIndex + 1u) * params.instanceStride + batch.firstInstance + instance] = object.transformIndex;
+}
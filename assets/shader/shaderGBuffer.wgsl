@@ -20,18 +20,33 @@ struct Uniform {
 }
 
 @group(2) @binding(0) var<storage, read> uniforms : array<Uniform>;
+@group(2) @binding(1) var<storage, read> instances : array<u32>;
+
+// Set by the pipeline for GeometryPool::PackedVertex: positions are quantized in the bounds of the mesh and mapped back
+// by the model matrix, normals are octahedral encoded in their xy
+override PACKED_VERTICES : bool = false;
+
+fn octahedralDecode(encoded: vec2f) -> vec3f {
+  var normal = vec3f(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+  let fold = max(-normal.z, 0.0);
+  normal.x += select(fold, -fold, normal.x >= 0.0);
+  normal.y += select(fold, -fold, normal.y >= 0.0);
+  return normalize(normal);
+}
 
 @vertex
 fn vs_main(
   @location(0) position: vec3f,
   @location(1) normal: vec3f,
   @location(2) uv: vec2f,
-  @location(3) uniformIndex: u32
+  @builtin(instance_index) instanceIndex: u32
 ) -> VertexOutput {
   var output : VertexOutput;
+  let uniformIndex = instances[instanceIndex];
   let worldPosition = (uniforms[uniformIndex].modelMatrix * vec4(position, 1.0)).xyz;
   output.Position = camera.viewProjectionMatrix * vec4(worldPosition, 1.0);
-  output.fragNormal = normalize((uniforms[uniformIndex].normalModelMatrix * vec4(normal, 1.0)).xyz);
+  let localNormal = select(normal, octahedralDecode(normal.xy), PACKED_VERTICES);
+  output.fragNormal = normalize((uniforms[uniformIndex].normalModelMatrix * vec4(localNormal, 1.0)).xyz);
   output.fragUV = uv;
   return output;
 }
@@ -0,0 +1,112 @@
+// Meshlets of the clustered batches of shaderCulling.wgsl, culled against each view, plus a backface cone test for
+// the camera. The triangles of the visible ones are appended to the region of the view in the cluster indices.
+
+struct Batch {
+  indexCount : u32,
+  firstIndex : u32,
+  baseVertex : i32,
+  firstInstance : u32, // Its single instance
+  shadowIndexCount : u32,
+  shadowFirstIndex : u32,
+  meshletCount : u32, // 0 when the camera draws a LOD of the batch
+  shadowMeshletCount : u32, // Same for the light views
+  clusterFirstIndex : u32,
+  transformIndex : u32, // Uniforms slot of the first instance
+  _padding0 : u32, // 48 bytes like GpuCulling::BatchData
+  _padding1 : u32,
+}
+
+struct Meshlet {
+  sphere : vec4f, // Center in the space of the vertex buffer, radius in local space
+  cone : vec4f, // Local space axis, cutoff
+  firstIndex : u32, // In the GeometryPool indices
+  indexCount : u32,
+  batch : u32,
+}
+
+struct Uniform {
+  modelMatrix : mat4x4f,
+  normalModelMatrix : mat4x4f,
+}
+
+struct View {
+  planes : array<vec4f, 6>,
+}
+
+struct DrawIndexedIndirectArgs {
+  indexCount : atomic<u32>,
+  instanceCount : u32,
+  firstIndex : u32,
+  baseVertex : i32,
+  firstInstance : u32,
+}
+
+struct Params {
+  objectCount : u32,
+  batchCount : u32,
+  batchCapacity : u32,
+  viewCount : u32,
+  instanceStride : u32,
+  meshletCount : u32,
+  clusterIndexStride : u32, // Size of a region of the cluster indices
+  cameraPosition : vec4f,
+}
+
+@group(0) @binding(0) var<storage, read> uniforms : array<Uniform>;
+@group(0) @binding(1) var<storage, read> views : array<View>;
+@group(0) @binding(2) var<storage, read_write> drawArgs : array<DrawIndexedIndirectArgs>;
+@group(0) @binding(3) var<uniform> params : Params;
+@group(0) @binding(4) var<storage, read> batches : array<Batch>;
+@group(0) @binding(5) var<storage, read> meshlets : array<Meshlet>;
+@group(0) @binding(6) var<storage, read> geometryIndices : array<u32>;
+@group(0) @binding(7) var<storage, read_write> clusterIndices : array<u32>;
+
+// One invocation per meshlet and view
+@compute @workgroup_size(64)
+fn cs_main(@builtin(global_invocation_id) id : vec3u) {
+  let meshletIndex = id.x;
+  let viewIndex = id.y;
+  if (meshletIndex >= params.meshletCount || viewIndex >= params.viewCount) {
+    return;
+  }
+
+  let meshlet = meshlets[meshletIndex];
+  let batch = batches[meshlet.batch];
+  let isCamera = viewIndex == 0u;
+  // The view draws a LOD of this batch
+  if (select(batch.shadowMeshletCount, batch.meshletCount, isCamera) == 0u) {
+    return;
+  }
+
+  // The normal matrix is the inverse transpose of the transform alone, its columns are as long as the inverse of the
+  // scales along them, which gives the largest scale of the local space radius
+  let transform = uniforms[batch.transformIndex];
+  let normalMatrix = mat3x3f(transform.normalModelMatrix[0].xyz, transform.normalModelMatrix[1].xyz, transform.normalModelMatrix[2].xyz);
+  let inverseScales = vec3f(length(normalMatrix[0]), length(normalMatrix[1]), length(normalMatrix[2]));
+  let center = (transform.modelMatrix * vec4f(meshlet.sphere.xyz, 1.0)).xyz;
+  let radius = meshlet.sphere.w / min(inverseScales.x, min(inverseScales.y, inverseScales.z));
+
+  for (var i = 0u; i < 6u; i++) {
+    let plane = views[viewIndex].planes[i];
+    if (dot(plane.xyz, center) + plane.w < -radius * length(plane.xyz)) {
+      return;
+    }
+  }
+
+  // Every triangle faces away from the camera
+  if (isCamera && meshlet.cone.w < 1.0) {
+    let axis = normalize(normalMatrix * meshlet.cone.xyz);
+    let toCenter = center - params.cameraPosition.xyz;
+    if (dot(toCenter, axis) >= meshlet.cone.w * length(toCenter) + radius) {
+      return;
+    }
+  }
+
+  let argsIndex = viewIndex * params.batchCapacity + meshlet.batch;
+  let offset = atomicAdd(&drawArgs[argsIndex].indexCount, meshlet.indexCount);
+  let first = viewIndex * params.clusterIndexStride + batch.clusterFirstIndex + offset;
+  let baseVertex = u32(batch.baseVertex);
+  for (var i = 0u; i < meshlet.indexCount; i++) {
+    clusterIndices[first + i] = geometryIndices[meshlet.firstIndex + i] + baseVertex;
+  }
+}
@@ -8,15 +8,18 @@ struct ShadowData {
 };
 
 @group(0) @binding(0) var<storage, read> uniforms : array<Uniform>;
+@group(0) @binding(1) var<storage, read> instances : array<u32>;
 @group(1) @binding(0) var<uniform> shadowData : ShadowData;
 
+// Packed positions are quantized in the bounds of the mesh, the model matrix maps them back
 @vertex
 fn vs_main(
   @location(0) position: vec3f,
   @location(1) normal: vec3f,
   @location(2) uv: vec2f,
-  @location(3) uniformIndex: u32
+  @builtin(instance_index) instanceIndex: u32
 ) -> @builtin(position) vec4f {
+    let uniformIndex = instances[instanceIndex];
     return shadowData.lightViewProj * uniforms[uniformIndex].modelMatrix * vec4f(position, 1.0);
 }
 
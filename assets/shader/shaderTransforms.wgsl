@@ -0,0 +1,77 @@
+// Expands the transforms uploaded by TransformUniforms into the GBuffer uniforms read by shaderGBuffer.wgsl and
+// shaderShadow.wgsl, with the same math as Util::ComputeTransformMatrices on the CPU.
+
+// Scalars, a vec3f would be aligned on 16 bytes. 40 bytes like TransformUniforms::TransformRecord.
+struct Transform {
+  positionX : f32,
+  positionY : f32,
+  positionZ : f32,
+  rotationX : f32,
+  rotationY : f32,
+  rotationZ : f32,
+  rotationW : f32,
+  scaleX : f32,
+  scaleY : f32,
+  scaleZ : f32,
+}
+
+// Maps the positions of the vertex buffer to local space. 24 bytes like TransformUniforms::VertexMapping.
+struct VertexMapping {
+  offsetX : f32,
+  offsetY : f32,
+  offsetZ : f32,
+  scaleX : f32,
+  scaleY : f32,
+  scaleZ : f32,
+}
+
+struct Uniform {
+  modelMatrix : mat4x4f,
+  normalModelMatrix : mat4x4f,
+}
+
+@group(0) @binding(0) var<storage, read> transforms : array<Transform>;
+@group(0) @binding(1) var<storage, read> vertexMappings : array<VertexMapping>;
+@group(0) @binding(2) var<storage, read_write> uniforms : array<Uniform>;
+
+// One invocation per slot
+@compute @workgroup_size(64)
+fn cs_main(@builtin(global_invocation_id) id : vec3u) {
+  let slot = id.x;
+  if (slot >= arrayLength(&transforms)) {
+    return;
+  }
+  let transform = transforms[slot];
+  let mapping = vertexMappings[slot];
+
+  // Rotation matrix, column by column
+  let x = transform.rotationX;
+  let y = transform.rotationY;
+  let z = transform.rotationZ;
+  let w = transform.rotationW;
+  let r0 = vec3f(1.0 - 2.0 * (y * y + z * z), 2.0 * (x * y + w * z), 2.0 * (x * z - w * y));
+  let r1 = vec3f(2.0 * (x * y - w * z), 1.0 - 2.0 * (x * x + z * z), 2.0 * (y * z + w * x));
+  let r2 = vec3f(2.0 * (x * z + w * y), 2.0 * (y * z - w * x), 1.0 - 2.0 * (x * x + y * y));
+
+  let scale = vec3f(transform.scaleX, transform.scaleY, transform.scaleZ);
+  let modelScale = scale * vec3f(mapping.scaleX, mapping.scaleY, mapping.scaleZ);
+  // The vertex offset goes through the transform: R * (S * offset) + position
+  let offset = scale * vec3f(mapping.offsetX, mapping.offsetY, mapping.offsetZ);
+  let translation = r0 * offset.x + r1 * offset.y + r2 * offset.z + vec3f(transform.positionX, transform.positionY, transform.positionZ);
+  uniforms[slot].modelMatrix = mat4x4f(
+    vec4f(r0 * modelScale.x, 0.0),
+    vec4f(r1 * modelScale.y, 0.0),
+    vec4f(r2 * modelScale.z, 0.0),
+    vec4f(translation, 1.0),
+  );
+
+  // (R * S)^-T = R * S^-1, a zero scale gives a zero column instead of infinities
+  let nonZero = scale != vec3f(0.0);
+  let inverseScale = select(vec3f(0.0), vec3f(1.0) / select(vec3f(1.0), scale, nonZero), nonZero);
+  uniforms[slot].normalModelMatrix = mat4x4f(
+    vec4f(r0 * inverseScale.x, 0.0),
+    vec4f(r1 * inverseScale.y, 0.0),
+    vec4f(r2 * inverseScale.z, 0.0),
+    vec4f(0.0, 0.0, 0.0, 1.0),
+  );
+}
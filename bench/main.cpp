@@ -0,0 +1,470 @@
+#include "WebGPU.hpp"
+#include "RenderingPipeline.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <numeric>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Renders a synthetic scene for a fixed number of frames and reports how long frames took, to see how the renderer
+// scales with the number of entities, lights and the resolution.
+//
+// e2-wgpu-bench [--meshes N] [--model sprite|path.obj] [--point-lights M] [--directional-lights K]
+//               [--resolution WxH] [--frames F] [--warmup W] [--output report.json] [--windowed] [--shared-geometry]
+//               [--packed-vertices] [--optimize-meshes] [--lods] [--meshlets] [--frames-in-flight N]
+//               [--allocation-check N]
+//
+// After the measured frames of a headless run, RenderGraph::Execute is called N more times (10 by default, 0 skips it)
+// while the heap allocations are counted. The bench fails when any of them allocated.
+//
+// e2-wgpu-bench --transform-kernel [--meshes N] [--frames F] [--warmup W] [--output report.json]
+// only times the model and normal matrices of N moving transforms, per entity with glm against
+// Util::ComputeTransformMatrices, without rendering anything.
+
+struct BenchConfig
+{
+	size_t meshCount = 100;
+	std::string model = "sprite";
+	size_t pointLightCount = 8;
+	size_t directionalLightCount = 1;
+	glm::uvec2 resolution = {1280, 720};
+	size_t frameCount = 500;
+	size_t warmupFrameCount = 50;
+	std::string output = "bench.json";
+	bool windowed = false;
+	bool sharedGeometry = false; // One uploaded mesh referenced by every entity, drawn instanced
+	bool packedVertices = false; // 16 bytes vertices for the 3D meshes
+	bool optimizeMeshes = false; // Reorder the triangles and vertices of the model with Util::OptimizeMesh
+	bool lods = false; // Build the LOD chain of the model, drawn depending on its size on screen
+	bool meshlets = false; // Split the model in meshlets culled one by one on the GPU
+	bool transformKernel = false; // Run the transform matrices microbenchmark instead
+	uint32_t framesInFlight = 2; // Frames recorded ahead of the GPU
+	size_t allocationCheckFrames = 10; // Executions of the render graph that must not allocate
+};
+
+struct BenchSamples
+{
+	std::vector<double> cpuMilliseconds;	// From the beginning of ToGPU to the end of Draw
+	std::vector<double> frameMilliseconds;	// Between two ends of Draw
+	std::vector<double> gpuMilliseconds;	// Sum of the pass timings, when a new frame was read back
+	std::vector<double> drawCalls;
+	std::vector<double> bytesUploaded;
+	uint64_t lastGpuFrame = 0;
+	uint64_t executeAllocations = 0; // During the allocation check
+	size_t frame = 0;
+	std::chrono::steady_clock::time_point lastFrameEnd;
+};
+
+// Counts the allocations made through the global operator new while enabled, from any thread. wgpu-native allocates
+// from its own heap, only the C++ side of the renderer is counted.
+static std::atomic<bool> countAllocations = false;
+static std::atomic<uint64_t> allocationCount = 0;
+
+static void *CountedAllocation(std::size_t size, std::size_t alignment)
+{
+	if (countAllocations.load(std::memory_order_relaxed))
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+	size = std::max<std::size_t>(size, 1);
+	void *pointer = alignment <= alignof(std::max_align_t) ? std::malloc(size) : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+// The array and nothrow forms call these ones
+void *operator new(std::size_t size) { return CountedAllocation(size, alignof(std::max_align_t)); }
+void *operator new(std::size_t size, std::align_val_t alignment) { return CountedAllocation(size, static_cast<std::size_t>(alignment)); }
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+
+template <typename T>
+static T ParseNumber(std::string_view value, std::string_view option)
+{
+	T result{};
+	auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+	if (error != std::errc() || end != value.data() + value.size())
+		throw std::runtime_error(fmt::format("Invalid value '{}' for {}", value, option));
+	return result;
+}
+
+static BenchConfig ParseArguments(int ac, char **av)
+{
+	BenchConfig config;
+
+	for (int i = 1; i < ac; i++)
+	{
+		std::string_view option = av[i];
+		if (option == "--windowed")
+		{
+			config.windowed = true;
+			continue;
+		}
+		if (option == "--shared-geometry")
+		{
+			config.sharedGeometry = true;
+			continue;
+		}
+		if (option == "--packed-vertices")
+		{
+			config.packedVertices = true;
+			continue;
+		}
+		if (option == "--optimize-meshes")
+		{
+			config.optimizeMeshes = true;
+			continue;
+		}
+		if (option == "--lods")
+		{
+			config.lods = true;
+			continue;
+		}
+		if (option == "--meshlets")
+		{
+			config.meshlets = true;
+			continue;
+		}
+		if (option == "--transform-kernel")
+		{
+			config.transformKernel = true;
+			continue;
+		}
+		if (i + 1 >= ac)
+			throw std::runtime_error(fmt::format("Missing value for {}", option));
+		std::string_view value = av[++i];
+
+		if (option == "--meshes")
+			config.meshCount = ParseNumber<size_t>(value, option);
+		else if (option == "--model")
+			config.model = value;
+		else if (option == "--point-lights")
+			config.pointLightCount = ParseNumber<size_t>(value, option);
+		else if (option == "--directional-lights")
+			config.directionalLightCount = ParseNumber<size_t>(value, option);
+		else if (option == "--frames")
+			config.frameCount = ParseNumber<size_t>(value, option);
+		else if (option == "--warmup")
+			config.warmupFrameCount = ParseNumber<size_t>(value, option);
+		else if (option == "--frames-in-flight")
+			config.framesInFlight = ParseNumber<uint32_t>(value, option);
+		else if (option == "--allocation-check")
+			config.allocationCheckFrames = ParseNumber<size_t>(value, option);
+		else if (option == "--output")
+			config.output = value;
+		else if (option == "--resolution")
+		{
+			size_t separator = value.find('x');
+			if (separator == std::string_view::npos)
+				throw std::runtime_error(fmt::format("Invalid resolution '{}', expected WxH", value));
+			config.resolution.x = ParseNumber<uint32_t>(value.substr(0, separator), option);
+			config.resolution.y = ParseNumber<uint32_t>(value.substr(separator + 1), option);
+		}
+		else
+			throw std::runtime_error(fmt::format("Unknown option {}", option));
+	}
+
+	if (config.frameCount == 0)
+		throw std::runtime_error("--frames must be greater than 0");
+	return config;
+}
+
+static void CreateScene(ES::Engine::Core &core)
+{
+	const auto &config = core.GetResource<BenchConfig>();
+
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texCoords;
+	std::vector<uint32_t> indices;
+
+	if (config.model == "sprite")
+	{
+		ES::Plugin::WebGPU::Util::CreateSprite(glm::vec2(-0.5f), glm::vec2(1.0f), vertices, normals, texCoords, indices);
+	}
+	else if (!ES::Plugin::Object::Resource::OBJLoader::loadModel(config.model, vertices, normals, texCoords, indices))
+	{
+		throw std::runtime_error(fmt::format("Model {} cannot be loaded", config.model));
+	}
+	if (config.optimizeMeshes)
+		ES::Plugin::WebGPU::Util::OptimizeMesh(vertices, normals, texCoords, indices);
+	std::vector<ES::Plugin::WebGPU::Util::LODLevel> lods;
+	if (config.lods)
+		lods = ES::Plugin::WebGPU::Util::BuildLODChain(vertices, indices);
+
+	// Meshes on a square grid around the origin, each one has its own geometry like a regular scene unless it is shared
+	size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(config.meshCount))));
+	entt::entity firstEntity = entt::null;
+	for (size_t i = 0; i < config.meshCount; i++)
+	{
+		auto handle = core.CreateEntity();
+		auto entity = ES::Engine::Entity(handle);
+		glm::vec3 position(
+			(static_cast<float>(i % side) - side * 0.5f) * 2.0f,
+			0.0f,
+			(static_cast<float>(i / side) - side * 0.5f) * 2.0f);
+
+		if (config.sharedGeometry && firstEntity != entt::null)
+		{
+			const auto &source = core.GetRegistry().get<ES::Plugin::WebGPU::Component::Mesh>(firstEntity);
+			entity.AddComponent<ES::Plugin::WebGPU::Component::Mesh>(core, core, source);
+		}
+		else
+		{
+			auto &mesh = entity.AddComponent<ES::Plugin::WebGPU::Component::Mesh>(core, core, vertices, normals, texCoords, indices, core.GetResource<GeometryPool>().GetFormat3D(), config.meshlets);
+			mesh.pipelineType = PipelineType::_3D;
+			for (const auto &lod : lods)
+				mesh.AddLOD(core, lod.indices, lod.error);
+			firstEntity = handle;
+		}
+		entity.AddComponent<ES::Plugin::Object::Component::Transform>(core, position);
+	}
+
+	auto &lights = core.GetResource<std::vector<Light>>();
+	lights.clear();
+	for (size_t i = 0; i < config.pointLightCount; i++)
+	{
+		float angle = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(config.pointLightCount);
+		lights.push_back({.color = {1.0f, 1.0f, 1.0f, 1.0f},
+						  .direction = {glm::cos(angle) * side, 2.0f, glm::sin(angle) * side},
+						  .intensity = 0.5f,
+						  .enabled = true});
+	}
+	for (size_t i = 0; i < config.directionalLightCount; i++)
+	{
+		float angle = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(config.directionalLightCount);
+		lights.push_back({.color = {1.0f, 1.0f, 1.0f, 1.0f},
+						  .direction = {glm::cos(angle), -2.0f, glm::sin(angle)},
+						  .intensity = 0.4f,
+						  .enabled = true,
+						  .type = Light::Type::Directional});
+	}
+	ES::Plugin::WebGPU::Util::UpdateLights(core);
+
+	auto &cameraData = core.GetResource<CameraData>();
+	const auto &renderOutput = core.GetResource<RenderOutput>();
+	cameraData.position = {0.0f, side * 1.5f, -(side * 1.5f)};
+	cameraData.yaw = glm::half_pi<float>();
+	cameraData.pitch = -glm::quarter_pi<float>();
+	cameraData.aspectRatio = static_cast<float>(renderOutput.size.x) / static_cast<float>(renderOutput.size.y);
+	cameraData.farPlane = side * 10.0f + 100.0f;
+}
+
+static double Percentile(std::vector<double> values, double percentile)
+{
+	if (values.empty())
+		return 0.0;
+	std::sort(values.begin(), values.end());
+	size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * values.size()));
+	return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+
+static std::string Summary(const std::vector<double> &values)
+{
+	double mean = values.empty() ? 0.0 : std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+	double max = values.empty() ? 0.0 : *std::max_element(values.begin(), values.end());
+	return fmt::format("{{\"samples\":{},\"mean\":{:.4f},\"p50\":{:.4f},\"p95\":{:.4f},\"p99\":{:.4f},\"max\":{:.4f}}}",
+		values.size(), mean, Percentile(values, 50.0), Percentile(values, 95.0), Percentile(values, 99.0), max);
+}
+
+static void WriteReport(ES::Engine::Core &core)
+{
+	const auto &config = core.GetResource<BenchConfig>();
+	const auto &samples = core.GetResource<BenchSamples>();
+	const auto &gpuTimings = core.GetResource<GpuFrameTimings>();
+	const char *gpuSource = gpuTimings.source == GpuFrameTimings::Source::GpuTimestamps ? "gpu_timestamps"
+		: gpuTimings.source == GpuFrameTimings::Source::CpuEncode ? "cpu_encode" : "none";
+
+	std::ofstream file(config.output);
+	if (!file)
+		throw std::runtime_error(fmt::format("Could not open {} for writing", config.output));
+
+	file << fmt::format("{{\"config\":{{\"meshes\":{},\"model\":\"{}\",\"point_lights\":{},\"directional_lights\":{},"
+						"\"resolution\":[{},{}],\"frames\":{},\"warmup\":{},\"headless\":{},\"shared_geometry\":{},\"packed_vertices\":{},\"optimize_meshes\":{},\"lods\":{},\"meshlets\":{},\"frames_in_flight\":{}}},",
+		config.meshCount, config.model, config.pointLightCount, config.directionalLightCount,
+		config.resolution.x, config.resolution.y, config.frameCount, config.warmupFrameCount, !config.windowed, config.sharedGeometry, config.packedVertices, config.optimizeMeshes, config.lods, config.meshlets, config.framesInFlight);
+	file << fmt::format("\"cpu_ms\":{},\"frame_interval_ms\":{},\"gpu_ms\":{},\"gpu_source\":\"{}\",\"gpu_dropped_frames\":{},",
+		Summary(samples.cpuMilliseconds), Summary(samples.frameMilliseconds), Summary(samples.gpuMilliseconds), gpuSource, gpuTimings.droppedFrames);
+	file << fmt::format("\"draw_calls\":{},\"bytes_uploaded\":{},\"execute_allocations\":{},\"last_gpu_frame\":{}}}\n",
+		Summary(samples.drawCalls), Summary(samples.bytesUploaded), samples.executeAllocations, gpuTimings.ToJSON());
+
+	ES::Utils::Log::Info(fmt::format("Bench report written to {}", config.output));
+}
+
+// Everything Execute uses is warm after the measured frames, so executing the last frame again must not allocate. Only
+// headless, the surface texture of a window is already presented.
+static void CheckExecuteAllocations(ES::Engine::Core &core)
+{
+	const auto &config = core.GetResource<BenchConfig>();
+	auto &samples = core.GetResource<BenchSamples>();
+	if (config.windowed || config.allocationCheckFrames == 0)
+		return;
+
+	auto &renderGraph = core.GetResource<RenderGraph>();
+	allocationCount = 0;
+	countAllocations = true;
+	for (size_t i = 0; i < config.allocationCheckFrames; i++)
+		renderGraph.Execute(core);
+	countAllocations = false;
+	samples.executeAllocations = allocationCount;
+
+	if (samples.executeAllocations != 0)
+		ES::Utils::Log::Error(fmt::format("RenderGraph::Execute made {} heap allocations in {} warm frames", samples.executeAllocations, config.allocationCheckFrames));
+}
+
+// Registered after the plugin's Draw systems, so the frame is complete
+static void RecordFrame(ES::Engine::Core &core)
+{
+	const auto &config = core.GetResource<BenchConfig>();
+	auto &samples = core.GetResource<BenchSamples>();
+	const auto &stats = core.GetResource<FrameStats>();
+	const auto &gpuTimings = core.GetResource<GpuFrameTimings>();
+	auto now = std::chrono::steady_clock::now();
+
+	if (samples.frame++ >= config.warmupFrameCount)
+	{
+		samples.cpuMilliseconds.push_back(std::chrono::duration<double, std::milli>(now - stats.frameStart).count());
+		if (samples.lastFrameEnd != std::chrono::steady_clock::time_point())
+			samples.frameMilliseconds.push_back(std::chrono::duration<double, std::milli>(now - samples.lastFrameEnd).count());
+		if (gpuTimings.source != GpuFrameTimings::Source::None && gpuTimings.frameIndex != samples.lastGpuFrame)
+		{
+			samples.gpuMilliseconds.push_back(gpuTimings.totalMilliseconds);
+			samples.lastGpuFrame = gpuTimings.frameIndex;
+		}
+		samples.drawCalls.push_back(stats.drawCalls);
+		samples.bytesUploaded.push_back(static_cast<double>(stats.bytesUploaded.load()));
+	}
+	samples.lastFrameEnd = now;
+
+	if (samples.frame == config.warmupFrameCount + config.frameCount)
+	{
+		CheckExecuteAllocations(core);
+		WriteReport(core);
+		core.Stop();
+	}
+}
+
+// Matrices of every transform each iteration, as if they all moved: the per entity path UpdateBufferUniforms used
+// (Transform::getTransformationMatrix then a 4x4 inverse), then the kernel on one thread and on a thread pool
+static void RunTransformKernelBench(const BenchConfig &config)
+{
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> scales(0.5f, 2.0f);
+
+	struct TRS
+	{
+		glm::vec3 position;
+		glm::quat rotation;
+		glm::vec3 scale;
+	};
+	std::vector<TRS> transforms(config.meshCount);
+	ES::Plugin::WebGPU::Util::TransformBatch batch;
+	for (size_t i = 0; i < transforms.size(); i++)
+	{
+		auto &transform = transforms[i];
+		transform.position = glm::vec3(unit(random), unit(random), unit(random)) * 100.0f;
+		transform.rotation = glm::normalize(glm::quat(unit(random), unit(random), unit(random), unit(random)));
+		transform.scale = glm::vec3(scales(random), scales(random), scales(random));
+		batch.Push(static_cast<uint32_t>(i), transform.position, transform.rotation, transform.scale);
+	}
+
+	std::vector<Uniforms> reference(transforms.size());
+	std::vector<Uniforms> computed(transforms.size());
+	ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+	std::vector<double> glmMilliseconds, kernelMilliseconds, parallelMilliseconds;
+
+	auto time = [](std::vector<double> &samples, bool record, auto &&function) {
+		auto start = std::chrono::steady_clock::now();
+		function();
+		if (record)
+			samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	};
+	for (size_t iteration = 0; iteration < config.warmupFrameCount + config.frameCount; iteration++)
+	{
+		bool record = iteration >= config.warmupFrameCount;
+		time(glmMilliseconds, record, [&]() {
+			for (size_t i = 0; i < transforms.size(); i++)
+			{
+				const auto &transform = transforms[i];
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), transform.position) * glm::mat4_cast(transform.rotation) * glm::scale(glm::mat4(1.0f), transform.scale);
+				reference[i].modelMatrix = model;
+				reference[i].normalModelMatrix = glm::transpose(glm::inverse(model));
+			}
+		});
+		time(kernelMilliseconds, record, [&]() {
+			ES::Plugin::WebGPU::Util::ComputeTransformMatrices(batch, &computed[0].modelMatrix, &computed[0].normalModelMatrix, 2);
+		});
+		time(parallelMilliseconds, record, [&]() {
+			ES::Plugin::WebGPU::Util::ComputeTransformMatrices(batch, &computed[0].modelMatrix, &computed[0].normalModelMatrix, 2, &pool);
+		});
+	}
+
+	// The normal matrices differ in the fourth row, which the shaders do not read
+	float maxError = 0.0f;
+	for (size_t i = 0; i < transforms.size(); i++)
+	{
+		for (int column = 0; column < 4; column++)
+		{
+			for (int row = 0; row < 4; row++)
+			{
+				maxError = std::max(maxError, std::abs(reference[i].modelMatrix[column][row] - computed[i].modelMatrix[column][row]));
+				if (row < 3)
+					maxError = std::max(maxError, std::abs(reference[i].normalModelMatrix[column][row] - computed[i].normalModelMatrix[column][row]));
+			}
+		}
+	}
+
+	std::ofstream file(config.output);
+	if (!file)
+		throw std::runtime_error(fmt::format("Could not open {} for writing", config.output));
+	file << fmt::format("{{\"config\":{{\"transforms\":{},\"frames\":{},\"warmup\":{},\"threads\":{}}},\"glm_ms\":{},\"kernel_ms\":{},\"kernel_threads_ms\":{},\"max_error\":{}}}\n",
+		transforms.size(), config.frameCount, config.warmupFrameCount, pool.GetThreadCount() + 1,
+		Summary(glmMilliseconds), Summary(kernelMilliseconds), Summary(parallelMilliseconds), maxError);
+	ES::Utils::Log::Info(fmt::format("Bench report written to {}", config.output));
+}
+
+auto main(int ac, char **av) -> int
+{
+	BenchConfig config;
+	try
+	{
+		config = ParseArguments(ac, av);
+	}
+	catch (const std::exception &e)
+	{
+		fmt::print(stderr, "{}\n", e.what());
+		return 1;
+	}
+
+	if (config.transformKernel)
+	{
+		RunTransformKernelBench(config);
+		return 0;
+	}
+
+	ES::Plugin::WebGPU::Plugin::settings.headless = !config.windowed;
+	ES::Plugin::WebGPU::Plugin::settings.headlessResolution = config.resolution;
+	ES::Plugin::WebGPU::Plugin::settings.packedVertices = config.packedVertices;
+	ES::Plugin::WebGPU::Plugin::settings.framesInFlight = config.framesInFlight;
+
+	ES::Engine::Core core;
+	core.RegisterResource(std::move(config));
+	core.RegisterResource(BenchSamples());
+
+	core.AddPlugins<ES::Plugin::WebGPU::Plugin>();
+
+	core.RegisterSystem<ES::Engine::Scheduler::Startup>(CreateScene);
+	core.RegisterSystem<ES::Plugin::RenderingPipeline::Draw>(RecordFrame);
+
+	core.RunCore();
+
+	return core.GetResource<BenchSamples>().executeAllocations == 0 ? 0 : 1;
+}
@@ -290,7 +290,9 @@ auto main(int ac, char **av) -> int
 
 			for (size_t i = 0; i < shapes.size(); i++)
 			{
-				const auto &shape = shapes[i];
+				auto &shape = shapes[i];
+				ES::Plugin::WebGPU::Util::OptimizeMesh(shape.vertices, shape.normals, shape.texCoords, shape.indices);
+				auto lods = ES::Plugin::WebGPU::Util::BuildLODChain(shape.vertices, shape.indices);
 
 				auto entity = ES::Engine::Entity(core.CreateEntity());
 
@@ -307,9 +309,11 @@ auto main(int ac, char **av) -> int
 					color.a = 255; // a
 					return color; }, pipelines.renderPipelines["2D"].bindGroupLayouts[1]);
 
-				auto &mesh = entity.AddComponent<ES::Plugin::WebGPU::Component::Mesh>(core, core, shape.vertices, shape.normals, shape.texCoords, shape.indices);
+				auto &mesh = entity.AddComponent<ES::Plugin::WebGPU::Component::Mesh>(core, core, shape.vertices, shape.normals, shape.texCoords, shape.indices, core.GetResource<GeometryPool>().GetFormat3D(), true);
 				mesh.pipelineType = PipelineType::_3D;
 				mesh.textures.push_back(entt::hashed_string(textureName.c_str()));
+				for (const auto &lod : lods)
+					mesh.AddLOD(core, lod.indices, lod.error);
 				entity.AddComponent<ES::Plugin::Object::Component::Transform>(core, glm::vec3(0), glm::vec3(0.01f));
 				entity.AddComponent<Name>(core, fmt::format("Sponza {}", i));
 			}
@@ -326,9 +330,13 @@ auto main(int ac, char **av) -> int
 			bool success = ES::Plugin::Object::Resource::OBJLoader::loadModel("assets/model/finish.obj", vertices, normals, texCoords, indices);
 			if (!success)
 				throw std::runtime_error("Model cant be loaded");
+			ES::Plugin::WebGPU::Util::OptimizeMesh(vertices, normals, texCoords, indices);
+			auto lods = ES::Plugin::WebGPU::Util::BuildLODChain(vertices, indices);
 
-			auto &mesh = entity.AddComponent<ES::Plugin::WebGPU::Component::Mesh>(core, core, vertices, normals, texCoords, indices);
+			auto &mesh = entity.AddComponent<ES::Plugin::WebGPU::Component::Mesh>(core, core, vertices, normals, texCoords, indices, core.GetResource<GeometryPool>().GetFormat3D());
 			mesh.pipelineType = PipelineType::_3D;
+			for (const auto &lod : lods)
+				mesh.AddLOD(core, lod.indices, lod.error);
 			// mesh.enabled = false;
 			entity.AddComponent<ES::Plugin::Object::Component::Transform>(core);
 			entity.AddComponent<Name>(core, "Finish");
@@ -29,7 +29,7 @@ namespace ES::Plugin::ImGUI {
 			[](ES::Engine::Core &core) {
 				ImGui_ImplWGPU_InitInfo info = ImGui_ImplWGPU_InitInfo();
 				info.DepthStencilFormat = depthTextureFormat;
-				info.RenderTargetFormat = core.GetResource<wgpu::SurfaceCapabilities>().formats[0];
+				info.RenderTargetFormat = core.GetResource<RenderOutput>().format;
 				info.Device = core.GetResource<wgpu::Device>();
 				ImGui_ImplWGPU_Init(&info);
 			},
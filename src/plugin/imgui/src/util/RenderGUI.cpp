@@ -3,12 +3,13 @@
 #include <imgui.h>
 #include <backends/imgui_impl_wgpu.h>
 #include <backends/imgui_impl_glfw.h>
-#include "UpdateLights.hpp"
+#include "GpuFrameTimings.hpp"
+#include "CpuProfiler.hpp"
 #include <glm/gtc/type_ptr.hpp>
 
 namespace ES::Plugin::ImGUI::WebGPU::Util {
 
-void RenderGUI(wgpu::RenderPassEncoder renderPass, ES::Engine::Core &core) {
+void RenderGUI(wgpu::RenderPassEncoder &renderPass, ES::Engine::Core &core) {
     // Start the Dear ImGui frame
     ImGui_ImplWGPU_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -31,6 +32,27 @@ void RenderGUI(wgpu::RenderPassEncoder renderPass, ES::Engine::Core &core) {
 	ImGuiIO& io = ImGui::GetIO();
 	ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
 
+	auto &gpuTimings = core.GetResource<GpuFrameTimings>();
+	if (ImGui::CollapsingHeader("GPU timings")) {
+		const char *source = gpuTimings.source == GpuFrameTimings::Source::GpuTimestamps ? "GPU timestamps"
+			: gpuTimings.source == GpuFrameTimings::Source::CpuEncode ? "CPU encode time" : "None";
+		ImGui::Text("Source: %s, frame %llu, %.3f ms", source, static_cast<unsigned long long>(gpuTimings.frameIndex), gpuTimings.totalMilliseconds);
+		ImGui::PlotLines("Total (ms)", gpuTimings.totalHistory.data(), static_cast<int>(gpuTimings.totalHistory.size()), static_cast<int>(gpuTimings.historyOffset), nullptr, 0.0f, FLT_MAX, ImVec2(0, 60));
+		for (const auto &pass : gpuTimings.passes) {
+			ImGui::Text("%s[%u]: %.3f ms", pass.name.c_str(), pass.iteration, pass.milliseconds);
+		}
+		ImGui::Text("Dropped frames: %llu", static_cast<unsigned long long>(gpuTimings.droppedFrames));
+		if (ImGui::Button("Dump GPU timings")) {
+			gpuTimings.DumpJSON("gpu_timings.json");
+		}
+#if defined(ES_PROFILING)
+		ImGui::SameLine();
+		if (ImGui::Button("Dump CPU trace")) {
+			core.GetResource<CpuProfiler>().ExportChromeTrace("cpu_trace.json");
+		}
+#endif
+	}
+
 	core.GetRegistry().view<ES::Plugin::WebGPU::Component::Mesh, Name>().each([&](ES::Plugin::WebGPU::Component::Mesh &mesh, Name &name) {
 		ImGui::Checkbox(name.value.c_str(), &mesh.enabled);
 	});
@@ -80,8 +102,9 @@ void RenderGUI(wgpu::RenderPassEncoder renderPass, ES::Engine::Core &core) {
 	}
 	ImGui::EndChild();
 
+	// Called while the render graph records, the passes already recorded bind the current lights buffers
 	if (lightsDirty) {
-		ES::Plugin::WebGPU::Util::UpdateLights(core);
+		core.GetResource<LightsDirty>().value = true;
 	}
 
 	ImGui::End();
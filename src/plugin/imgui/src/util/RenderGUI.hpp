@@ -6,6 +6,6 @@
 //TODO: use ImGUI namespace
 namespace ES::Plugin::ImGUI::WebGPU::Util {
 
-void RenderGUI(wgpu::RenderPassEncoder renderPass, ES::Engine::Core &core);
+void RenderGUI(wgpu::RenderPassEncoder &renderPass, ES::Engine::Core &core);
 
 }
@@ -8,13 +8,27 @@
 
 // --- Resource
 #include "RenderGraph.hpp"
+#include "GpuFrameTimings.hpp"
+#include "GpuProfiler.hpp"
+#include "CpuProfiler.hpp"
+#include "FrameStats.hpp"
+#include "GeometryPool.hpp"
+#include "GpuCulling.hpp"
+#include "InstanceBatches.hpp"
+#include "TransformUniforms.hpp"
+#include "FramesInFlight.hpp"
 
 // --- Util ---
 #include "CreateSprite.hpp"
+#include "OptimizeMesh.hpp"
+#include "MeshLOD.hpp"
+#include "Meshlets.hpp"
+#include "TransformKernel.hpp"
 #include "util/structs.hpp"
 #include "Texture.hpp"
 #include "UpdateLights.hpp"
 #include "utils.hpp"
+#include "SaveRenderOutput.hpp"
 #include "util/webgpu.hpp"
 
 // --- System ---
@@ -42,7 +56,6 @@
 #include "InitializeEndPostProcessPipeline.hpp"
 #include "InitBuffers.hpp"
 #include "InitGBufferBuffers.hpp"
-#include "InitGBufferTextures.hpp"
 #include "InitShadowTexture.hpp"
 #include "InitSkyboxBuffers.hpp"
 #include "InitEndPostProcess.hpp"
@@ -58,6 +71,7 @@
 // To GPU
 #include "UpdateBuffers.hpp"
 #include "UpdateCameraBuffer.hpp"
+#include "UpdateMeshLODs.hpp"
 #include "GenerateSurfaceTexture.hpp"
 #include "UpdateBufferUniforms.hpp"
 
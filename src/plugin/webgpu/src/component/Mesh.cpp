@@ -1,63 +1,170 @@
 #include "Mesh.hpp"
+#include "TransformUniforms.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+#include <fmt/format.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 namespace ES::Plugin::WebGPU::Component {
 
-Mesh::Mesh(ES::Engine::Core &core, const std::vector<glm::vec3> &vertices, const std::vector<glm::vec3> &normals, const std::vector<glm::vec2> &uvs, const std::vector<uint32_t> &indices) {
-	auto &device = core.GetResource<wgpu::Device>();
-	auto &queue = core.GetResource<wgpu::Queue>();
+// Unit vector on the octahedron |x| + |y| + |z| = 1, unfolded on the [-1, 1] square, decoded by octahedralDecode in the shaders
+static glm::vec2 OctahedralEncode(glm::vec3 normal) {
+	float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (sum == 0.0f) return glm::vec2(0.0f);
+	normal /= sum;
+	if (normal.z >= 0.0f) return glm::vec2(normal.x, normal.y);
+	glm::vec2 sign(normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f);
+	return (1.0f - glm::abs(glm::vec2(normal.y, normal.x))) * sign;
+}
+
+Mesh::Mesh(ES::Engine::Core &core, std::span<const glm::vec3> vertices, std::span<const glm::vec3> normals, std::span<const glm::vec2> uvs, std::span<const uint32_t> indices, GeometryPool::VertexFormat format, bool buildMeshlets) {
+	if (normals.size() != vertices.size() || uvs.size() != vertices.size()) {
+		throw std::runtime_error(fmt::format("Mesh has {} vertices but {} normals and {} uvs.", vertices.size(), normals.size(), uvs.size()));
+	}
 
-	std::vector<float> pointData;
+	thread_local std::vector<Vertex> pointData;
+	pointData.resize(vertices.size());
 	for (size_t i = 0; i < vertices.size(); i++) {
-		pointData.push_back(vertices.at(i).x);
-		pointData.push_back(vertices.at(i).y);
-		pointData.push_back(vertices.at(i).z);
-		pointData.push_back(normals.at(i).r);
-		pointData.push_back(normals.at(i).g);
-		pointData.push_back(normals.at(i).b);
-		pointData.push_back(uvs.at(i).x);
-		pointData.push_back(uvs.at(i).y);
+		pointData[i] = Vertex{ vertices[i], normals[i], uvs[i] };
 	}
+	upload(core, pointData, indices, format, buildMeshlets);
+}
+
+Mesh::Mesh(ES::Engine::Core &core, std::span<const Vertex> vertices, std::span<const uint32_t> indices, GeometryPool::VertexFormat format, bool buildMeshlets) {
+	upload(core, vertices, indices, format, buildMeshlets);
+}
+
+void Mesh::upload(ES::Engine::Core &core, std::span<const Vertex> vertices, std::span<const uint32_t> indices, GeometryPool::VertexFormat format, bool buildMeshlets) {
+	auto &pool = core.GetResource<GeometryPool>();
 
+	transformIndex = core.GetResource<TransformUniforms>().AllocateSlot();
+	computeBounds(vertices);
+	GeometryPool::IndexFormat indexFormat = buildMeshlets ? GeometryPool::IndexFormat::Uint32 : GeometryPool::GetIndexFormat(vertices.size());
+	geometry = pool.Allocate(core, static_cast<uint32_t>(vertices.size()), static_cast<uint32_t>(indices.size()), format, indexFormat);
+	writeIndices(core, geometry, indices);
 
-	std::vector<uint32_t> indexData;
-	for (size_t i = 0; i < indices.size(); i++) {
-		indexData.push_back(indices.at(i));
+	if (buildMeshlets) {
+		thread_local std::vector<glm::vec3> positions;
+		positions.resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++) positions[i] = vertices[i].position;
+		meshlets = Util::BuildMeshlets(positions, indices);
 	}
 
-	indexCount = indexData.size();
+	if (format == GeometryPool::VertexFormat::Float32) {
+		pool.WriteVertices(core, geometry, vertices);
+		return;
+	}
+
+	// Flat axes keep a zero extent, their positions are all 0 and GetVertexToLocal scales them to nothing
+	glm::vec3 extent = boundsMax - boundsMin;
+	glm::vec3 inverseExtent = glm::vec3(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+	// Radii and cones stay in local space, the culling scales them with the transform alone
+	for (Util::Meshlet &meshlet : meshlets) meshlet.center = (meshlet.center - boundsMin) * inverseExtent;
+
+	thread_local std::vector<GeometryPool::PackedVertex> packedData;
+	packedData.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const Vertex &vertex = vertices[i];
+		packedData[i] = GeometryPool::PackedVertex{
+			.position = glm::packUnorm4x16(glm::vec4((vertex.position - boundsMin) * inverseExtent, 0.0f)),
+			.normal = glm::packSnorm2x16(OctahedralEncode(vertex.normal)),
+			.uv = glm::packHalf2x16(vertex.uv),
+		};
+	}
+	pool.WriteVertices(core, geometry, std::span<const GeometryPool::PackedVertex>(packedData));
+}
+
+void Mesh::writeIndices(ES::Engine::Core &core, const GeometryPool::Allocation &allocation, std::span<const uint32_t> indices) {
+	auto &pool = core.GetResource<GeometryPool>();
+	if (allocation.indexFormat == GeometryPool::IndexFormat::Uint32) {
+		pool.WriteIndices(core, allocation, indices);
+		return;
+	}
 
-	wgpu::BufferDescriptor bufferDesc(wgpu::Default);
-	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Vertex;
-	bufferDesc.size = pointData.size() * sizeof(float);
-	pointBuffer = device.createBuffer(bufferDesc);
+	thread_local std::vector<uint16_t> shortIndices;
+	shortIndices.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); i++) shortIndices[i] = static_cast<uint16_t>(indices[i]);
+	pool.WriteIndices(core, allocation, std::span<const uint16_t>(shortIndices));
+}
 
-	queue.writeBuffer(pointBuffer, 0, pointData.data(), bufferDesc.size);
+Mesh::Mesh(ES::Engine::Core &core, const Mesh &source)
+	: geometry(source.geometry), pipelineType(source.pipelineType), passNames(source.passNames), textures(source.textures),
+	  boundsMin(source.boundsMin), boundsMax(source.boundsMax), enabled(source.enabled), lods(source.lods), meshlets(source.meshlets) {
+	core.GetResource<GeometryPool>().Acquire(geometry);
+	transformIndex = core.GetResource<TransformUniforms>().AllocateSlot();
+}
 
-	bufferDesc.size = indexCount * sizeof(uint32_t);
-	bufferDesc.size = (bufferDesc.size + 3) & ~3;
-	indexData.resize((indexCount + 1) & ~1);
-	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Index;
-	indexBuffer = device.createBuffer(bufferDesc);
+void Mesh::computeBounds(std::span<const Vertex> vertices) {
+	if (vertices.empty()) return;
 
-	queue.writeBuffer(indexBuffer, 0, indexData.data(), bufferDesc.size);
+	boundsMin = boundsMax = vertices[0].position;
+	for (const Vertex &vertex : vertices) {
+		boundsMin = glm::min(boundsMin, vertex.position);
+		boundsMax = glm::max(boundsMax, vertex.position);
+	}
+}
 
-	bufferDesc.size = indexCount * sizeof(uint32_t);
-	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Vertex;
-	transformIndexBuffer = device.createBuffer(bufferDesc);
+glm::mat4 Mesh::GetVertexToLocal() const {
+	if (geometry.format != GeometryPool::VertexFormat::Packed) return glm::mat4(1.0f);
+	return glm::scale(glm::translate(glm::mat4(1.0f), boundsMin), boundsMax - boundsMin);
 }
 
-void Mesh::Release() {
-	if (pointBuffer) {
-		pointBuffer.destroy();
-		pointBuffer.release();
-		pointBuffer = nullptr;
+void Mesh::AddLOD(ES::Engine::Core &core, std::span<const uint32_t> indices, float error) {
+	if (!geometry.IsValid()) throw std::runtime_error("Mesh: Cannot add a LOD to a mesh without geometry.");
+	for (uint32_t index : indices) {
+		if (index >= geometry.vertexCount) throw std::runtime_error(fmt::format("Mesh: LOD index {} is out of the {} vertices.", index, geometry.vertexCount));
 	}
-	if (indexBuffer) {
-		indexBuffer.destroy();
-		indexBuffer.release();
-		indexBuffer = nullptr;
+
+	// Same index buffer as the full mesh, so a LOD only changes the range of the draw
+	LOD level;
+	level.indices = core.GetResource<GeometryPool>().Allocate(core, 0, static_cast<uint32_t>(indices.size()), geometry.format, geometry.indexFormat);
+	level.error = error;
+	writeIndices(core, level.indices, indices);
+	lods.push_back(level);
+}
+
+const GeometryPool::Allocation &Mesh::GetLODIndices(uint32_t level) const {
+	if (level == 0 || lods.empty()) return geometry;
+	return lods[std::min<size_t>(level, lods.size()) - 1].indices;
+}
+
+Mesh::Mesh(Mesh &&other) noexcept {
+	*this = std::move(other);
+}
+
+Mesh &Mesh::operator=(Mesh &&other) noexcept {
+	if (this == &other) return *this;
+	geometry = std::exchange(other.geometry, {});
+	pipelineType = other.pipelineType;
+	passNames = std::move(other.passNames);
+	textures = std::move(other.textures);
+	boundsMin = other.boundsMin;
+	boundsMax = other.boundsMax;
+	transformIndex = std::exchange(other.transformIndex, TransformUniforms::InvalidSlot);
+	enabled = other.enabled;
+	lods = std::exchange(other.lods, {});
+	lod = other.lod;
+	shadowLod = other.shadowLod;
+	meshlets = std::exchange(other.meshlets, {});
+	return *this;
+}
+
+void Mesh::Release(ES::Engine::Core &core) {
+	auto &pool = core.GetResource<GeometryPool>();
+	// LODs are shared like the geometry, the last owner frees them
+	if (pool.Free(geometry)) {
+		for (LOD &level : lods) pool.Free(level.indices);
 	}
-	indexCount = 0;
+	lods.clear();
+	meshlets.clear();
+	lod = shadowLod = 0;
+
+	if (transformIndex != TransformUniforms::InvalidSlot) core.GetResource<TransformUniforms>().FreeSlot(transformIndex);
+	transformIndex = TransformUniforms::InvalidSlot;
 }
 
 }
@@ -1,26 +1,80 @@
 #pragma once
 
+#include <span>
 #include <vector>
 #include <glm/glm.hpp>
 #include "util/webgpu.hpp"
 #include <entt/entt.hpp>
 #include "core/Core.hpp"
 #include "PipelineType.hpp"
+#include "GeometryPool.hpp"
+#include "Meshlets.hpp"
+#include "TransformUniforms.hpp"
 
 namespace ES::Plugin::WebGPU::Component {
 struct Mesh {
-	wgpu::Buffer pointBuffer = nullptr;
-	wgpu::Buffer indexBuffer = nullptr;
-	wgpu::Buffer transformIndexBuffer = nullptr;
+	using Vertex = GeometryPool::Vertex;
+
+	GeometryPool::Allocation geometry; // Vertices and indices in the shared buffers of the GeometryPool
 	PipelineType pipelineType = PipelineType::None;
 	std::vector<std::string> passNames = {};
 	std::vector<entt::hashed_string> textures = {};
-	uint32_t indexCount = 0;
+	glm::vec3 boundsMin = glm::vec3(0.0f); // Local space box around the vertices, used by the GPU culling
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	// Slot in the uniforms array, owned from the construction to Release so it stays the same while other meshes come and
+	// go. TransformUniforms::InvalidSlot without geometry.
+	uint32_t transformIndex = TransformUniforms::InvalidSlot;
 	bool enabled = true;
 
+	// Simplified index buffers drawn with the vertices of geometry, from the finest to the coarsest
+	struct LOD {
+		GeometryPool::Allocation indices; // No vertices of its own, drawn with geometry.vertexOffset
+		float error = 0.0f; // Local space distance to the full mesh
+	};
+	std::vector<LOD> lods = {};
+	// Levels drawn this frame for the camera and for the shadow maps, 0 is geometry. Set by UpdateMeshLODs.
+	uint32_t lod = 0;
+	uint32_t shadowLod = 0;
+
+	// Clusters of the triangles of geometry, culled one by one by GpuCulling when the mesh draws its full detail. The
+	// centers are in the space of the vertex buffer, like the positions (see GetVertexToLocal).
+	std::vector<Util::Meshlet> meshlets = {};
+
 	Mesh() = default;
-	Mesh(ES::Engine::Core &core, const std::vector<glm::vec3> &vertices, const std::vector<glm::vec3> &normals, const std::vector<glm::vec2> &uvs, const std::vector<uint32_t> &indices);
+	// Attributes are interleaved into a reused staging array and uploaded to the pool, nothing is kept on the CPU.
+	// Indices are stored on 16 bits when the mesh has few enough vertices, see geometry.indexFormat.
+	// 3D meshes have to be built with the format of the 3D pipelines, GeometryPool::GetFormat3D.
+	// With buildMeshlets the triangles are also split in meshlets, their indices then always use 32 bits since the
+	// culling pass reads them.
+	Mesh(ES::Engine::Core &core, std::span<const glm::vec3> vertices, std::span<const glm::vec3> normals, std::span<const glm::vec2> uvs, std::span<const uint32_t> indices, GeometryPool::VertexFormat format = GeometryPool::VertexFormat::Float32, bool buildMeshlets = false);
+	Mesh(ES::Engine::Core &core, std::span<const Vertex> vertices, std::span<const uint32_t> indices, GeometryPool::VertexFormat format = GeometryPool::VertexFormat::Float32, bool buildMeshlets = false);
+	// Draw the geometry of another mesh, nothing is uploaded. Meshes sharing their geometry and texture are drawn with
+	// one instanced draw.
+	Mesh(ES::Engine::Core &core, const Mesh &source);
+	// A copy would use the uniforms slot and the geometry of its source without owning them, see the constructor above.
+	// A move hands them over and leaves the moved-from mesh released. The mesh moved into must already be released.
+	Mesh(const Mesh &) = delete;
+	Mesh &operator=(const Mesh &) = delete;
+	Mesh(Mesh &&other) noexcept;
+	Mesh &operator=(Mesh &&other) noexcept;
+
+	// Maps the positions of the vertex buffer to local space, they are quantized in the bounds for packed vertices.
+	// It is part of the model matrix uploaded for the mesh.
+	glm::mat4 GetVertexToLocal() const;
+
+	// Add the next coarser level, indices are into the vertices of the mesh (see Util::BuildLODChain)
+	void AddLOD(ES::Engine::Core &core, std::span<const uint32_t> indices, float error);
+	// Indices of a level, clamped to the coarsest one
+	const GeometryPool::Allocation &GetLODIndices(uint32_t level) const;
+
+	// Give the geometry, its LODs and the uniforms slot back. Called when the component is destroyed, and for the
+	// remaining meshes at shutdown. Does nothing once released.
+	void Release(ES::Engine::Core &core);
+	bool IsReleased() const { return !geometry.IsValid() && lods.empty() && transformIndex == TransformUniforms::InvalidSlot; }
 
-	void Release();
+private:
+	void computeBounds(std::span<const Vertex> vertices);
+	void upload(ES::Engine::Core &core, std::span<const Vertex> vertices, std::span<const uint32_t> indices, GeometryPool::VertexFormat format, bool buildMeshlets);
+	static void writeIndices(ES::Engine::Core &core, const GeometryPool::Allocation &allocation, std::span<const uint32_t> indices);
 };
 }
@@ -7,8 +7,6 @@
 #include "plugin/PluginWindow.hpp"
 #include "scheduler/Shutdown.hpp"
 
-size_t lightIndex = 0;
-
 void DumpDepthTextureAsPNG(
     wgpu::Device &device, wgpu::Queue &queue, wgpu::Texture &depthTexture,
     uint32_t width, uint32_t height, const char *filename,
@@ -101,16 +99,37 @@ void DumpDepthTextureAsPNG(
 
 namespace ES::Plugin::WebGPU {
 void Plugin::Bind() {
-  RequirePlugins<ES::Plugin::Window::Plugin>();
-
+  RequirePlugins<ES::Plugin::RenderingPipeline::Plugin>();
+  if (!settings.headless) RequirePlugins<ES::Plugin::Window::Plugin>();
+
+  RegisterResource(RenderOutput{
+      .headless = settings.headless,
+      .size = settings.headless ? settings.headlessResolution : glm::uvec2(0),
+      .format = settings.headless ? settings.headlessFormat
+                                  : wgpu::TextureFormat::Undefined});
   RegisterResource(ClearColor());
+  RegisterResource(LightsDirty());
   RegisterResource(Pipelines());
   RegisterResource(TextureManager());
   RegisterResource(std::vector<Light>());
   RegisterResource(CameraData());
   RegisterResource(RenderGraph());
+  RegisterResource(GpuFrameTimings());
+  RegisterResource(CpuProfiler());
+  RegisterResource(FrameStats());
+  RegisterResource(FramesInFlight(settings.framesInFlight));
+  RegisterResource(GeometryPool(settings.packedVertices ? GeometryPool::VertexFormat::Packed : GeometryPool::VertexFormat::Float32));
+  RegisterResource(InstanceBatches());
+  RegisterResource(TransformUniforms(settings.gpuTransforms));
+  RegisterResource(GpuCulling(settings.gpuCulling));
+  RegisterResource(MeshLODSettings());
 
   RegisterSystems<ES::Plugin::RenderingPipeline::Setup>(
+      [](ES::Engine::Core &core) {
+        core.GetRegistry()
+            .on_destroy<Component::Mesh>()
+            .connect<&System::ReleaseDestroyedMesh>(core);
+      },
       System::CreateInstance, System::CreateSurface, System::CreateAdapter,
 #if defined(ES_DEBUG)
       System::AdaptaterPrintLimits, System::AdaptaterPrintFeatures,
@@ -131,12 +150,13 @@ void Plugin::Bind() {
       System::CreateBindingGroup2D, System::SetupResizableWindow,
       System::GenerateDefaultTexture,
       [](ES::Engine::Core &core) { stbi_set_flip_vertically_on_load(true); },
-      System::InitGBufferTextures, System::InitializeGBufferPipeline,
+      System::InitializeGBufferPipeline,
       System::InitGBufferBuffers, System::InitShadowTexture,
       System::InitEndPostProcess, System::InitSkyboxBuffers,
       System::CreateBindingGroupSkybox, System::CreateBindingGroupGBuffer,
       System::CreateBindingGroupDeferred,
       [](ES::Engine::Core &core) {
+        core.GetResource<RenderGraph>().AddExternalOutput("WindowColorTexture");
         core.GetResource<RenderGraph>().AddMultipleRenderPass(
             MultipleRenderPassData{
                 .name = "MultipleShadowPass",
@@ -158,86 +178,92 @@ void Plugin::Bind() {
                                 .name = "GBufferUniforms"
                             },
                          },
-                     .perEntityCallback =
-                         [](wgpu::RenderPassEncoder &renderPass,
-                            ES::Engine::Core &core,
-                            ES::Plugin::WebGPU::Component::Mesh &mesh,
-                            ES::Plugin::Object::Component::Transform &transform,
-                            ES::Engine::Entity entity) {
-                           auto &queue = core.GetResource<wgpu::Queue>();
-                           renderPass.setVertexBuffer(
-                               1, mesh.transformIndexBuffer, 0,
-                               mesh.transformIndexBuffer.getSize());
+                     .useRenderBundle = true,
+                     .parallelRecording = true,
+                     .cullingView = GpuCulling::FirstLightView,
+                     // Recorded on a worker, the views and bind groups are
+                     // only read here, preMultiplePassCallback creates them
+                     .depthAttachmentView =
+                         [](ES::Engine::Core &,
+                            size_t iteration) -> wgpu::TextureView {
+                           return shadowLayerViews[iteration];
+                         },
+                     .passCallback =
+                         [](RenderEncoder &renderPass, ES::Engine::Core &core,
+                            size_t iteration) {
+                           // The matrix is in the region of the frame, like
+                           // the bundle recorded here
+                           uint32_t offset =
+                               core.GetResource<FramesInFlight>().GetOffset(
+                                   additionalDirectionalLightsBuffer);
                            renderPass.setBindGroup(
                                1,
-                               additionalDirectionalLights[lightIndex]
+                               additionalDirectionalLights[iteration]
                                    .bindGroup,
-                               0, nullptr);
+                               1, &offset);
                          }},
                 .getNumberOfPass = [](ES::Engine::Core &core) -> size_t {
-                  size_t count = 0;
-                  auto &lights = core.GetResource<std::vector<Light>>();
-                  for (const auto &light : lights)
-                    if (light.type == Light::Type::Directional)
-                      count++;
-
-                  return count;
+                  return additionalDirectionalLights.size();
                 },
                 .preMultiplePassCallback =
-                    [](ES::Engine::Core &, RenderPassData &) {
-                      lightIndex = 0;
-                    },
-                .prePassCallback =
                     [](ES::Engine::Core &core, RenderPassData &) {
                       auto &textureManager = core.GetResource<TextureManager>();
                       auto &textureShadows =
                           textureManager.Get(entt::hashed_string("shadows"));
-                      const std::string name = "shadows";
-                      wgpu::TextureViewDescriptor textureViewDesc;
-                      const std::string textureViewName =
-                          fmt::format("TextureView::{}", name);
-
-                      if (textureShadows.textureView)
-                        textureShadows.textureView.release();
+                      auto &device = core.GetResource<wgpu::Device>();
+                      const size_t layerCount =
+                          std::max<size_t>(1, additionalDirectionalLights.size());
+
+                      // Layer views are created once, each iteration attaches
+                      // the one of its light
+                      while (shadowLayerViews.size() < layerCount) {
+                        wgpu::TextureViewDescriptor textureViewDesc;
+                        textureViewDesc.label =
+                            wgpu::StringView("TextureView::shadows::Layer");
+                        textureViewDesc.format =
+                            wgpu::TextureFormat::Depth32Float;
+                        textureViewDesc.dimension =
+                            wgpu::TextureViewDimension::_2D;
+                        textureViewDesc.aspect = wgpu::TextureAspect::DepthOnly;
+                        textureViewDesc.baseMipLevel = 0;
+                        textureViewDesc.mipLevelCount = 1;
+                        textureViewDesc.baseArrayLayer =
+                            static_cast<uint32_t>(shadowLayerViews.size());
+                        textureViewDesc.arrayLayerCount = 1;
+                        textureViewDesc.usage =
+                            wgpu::TextureUsage::TextureBinding |
+                            wgpu::TextureUsage::RenderAttachment;
+                        shadowLayerViews.push_back(
+                            textureShadows.texture.createView(textureViewDesc));
+                      }
 
-                      textureViewDesc.label =
-                          wgpu::StringView(textureViewName.c_str());
-                      textureViewDesc.format =
-                          wgpu::TextureFormat::Depth32Float;
-                      textureViewDesc.dimension =
-                          wgpu::TextureViewDimension::_2D;
-                      textureViewDesc.aspect = wgpu::TextureAspect::DepthOnly;
-                      textureViewDesc.baseMipLevel = 0;
-                      textureViewDesc.mipLevelCount = 1;
-                      textureViewDesc.baseArrayLayer = lightIndex;
-                      textureViewDesc.arrayLayerCount = 1;
-                      textureViewDesc.usage =
-                          wgpu::TextureUsage::TextureBinding |
-                          wgpu::TextureUsage::RenderAttachment;
+                      // Uncomment this to create a file to debug shadowmaps
+                      // static auto lastDumpTime =
+                      //     std::chrono::steady_clock::now();
+                      // auto now = std::chrono::steady_clock::now();
+                      // if (now - lastDumpTime >= std::chrono::seconds(1)) {
+                      //   auto &queue = core.GetResource<wgpu::Queue>();
+                      //   // Dumper la première couche de la texture array (index
+                      //   // 0)
+                      //   DumpDepthTextureAsPNG(device, queue,
+                      //                         textureShadows.texture, 2048,
+                      //                         2048, "depth.png", 0);
+                      //   lastDumpTime = now;
+                      // }
 
-                      textureShadows.textureView =
-                          textureShadows.texture.createView(textureViewDesc);
-                    },
-                .postPassCallback = [](ES::Engine::Core &,
-                                       RenderPassData &) { lightIndex++; },
-                .postMultiplePassCallback =
-                    [](ES::Engine::Core &core, RenderPassData &) {
-                      auto &textureManager = core.GetResource<TextureManager>();
-                      auto &textureShadows =
-                          textureManager.Get(entt::hashed_string("shadows"));
-                      const std::string name = "shadows";
-                      wgpu::TextureViewDescriptor textureViewDesc;
-                      const std::string textureViewName =
-                          fmt::format("TextureView::{}", name);
-                      auto &device = core.GetResource<wgpu::Device>();
+                      // The array view and its bind group only change with the
+                      // number of directional lights
+                      if (shadowArrayView != nullptr &&
+                          shadowArrayViewLayerCount == layerCount)
+                        return;
 
-                      if (textureShadows.textureView)
-                        textureShadows.textureView.release();
+                      if (shadowArrayView)
+                        shadowArrayView.release();
 
+                      wgpu::TextureViewDescriptor textureViewDesc;
                       textureViewDesc.label =
-                          wgpu::StringView(textureViewName.c_str());
-                      textureViewDesc.format =
-                          wgpu::TextureFormat::Depth32Float;
+                          wgpu::StringView("TextureView::shadows");
+                      textureViewDesc.format = wgpu::TextureFormat::Depth32Float;
                       textureViewDesc.dimension =
                           wgpu::TextureViewDimension::_2DArray;
                       textureViewDesc.aspect = wgpu::TextureAspect::DepthOnly;
@@ -245,20 +271,22 @@ void Plugin::Bind() {
                       textureViewDesc.mipLevelCount = 1;
                       textureViewDesc.baseArrayLayer = 0;
                       textureViewDesc.arrayLayerCount =
-                          std::max(1lu, lightIndex);
+                          static_cast<uint32_t>(layerCount);
                       textureViewDesc.usage =
                           wgpu::TextureUsage::TextureBinding |
                           wgpu::TextureUsage::RenderAttachment;
 
-                      textureShadows.textureView =
+                      shadowArrayView =
                           textureShadows.texture.createView(textureViewDesc);
+                      shadowArrayViewLayerCount = layerCount;
+                      textureShadows.textureView = shadowArrayView;
 
                       if (textureShadows.bindGroup)
                         textureShadows.bindGroup.release();
 
                       wgpu::BindGroupEntry textureBinding(wgpu::Default);
                       textureBinding.binding = 0;
-                      textureBinding.textureView = textureShadows.textureView;
+                      textureBinding.textureView = shadowArrayView;
 
                       if (additionalDirectionalLightsSampler == nullptr) {
                         wgpu::SamplerDescriptor samplerDesc(wgpu::Default);
@@ -270,8 +298,7 @@ void Plugin::Bind() {
 
                       wgpu::BindGroupEntry samplerBinding(wgpu::Default);
                       samplerBinding.binding = 1;
-                      samplerBinding.sampler =
-                          additionalDirectionalLightsSampler;
+                      samplerBinding.sampler = additionalDirectionalLightsSampler;
 
                       std::array<wgpu::BindGroupEntry, 2> bindings = {
                           textureBinding, samplerBinding};
@@ -282,28 +309,9 @@ void Plugin::Bind() {
                                                  .bindGroupLayouts[3];
                       bindGroupDesc.entryCount = bindings.size();
                       bindGroupDesc.entries = bindings.data();
-                      bindGroupDesc.label =
-                          wgpu::StringView("Shadows Bind Group");
+                      bindGroupDesc.label = wgpu::StringView("Shadows Bind Group");
                       textureShadows.bindGroup =
                           device.createBindGroup(bindGroupDesc);
-
-                      entityIndex = 0;
-                      lightIndex = 0;
-
-                      // Uncomment this to create a file to debug shadowmaps
-                      // static auto lastDumpTime =
-                      //     std::chrono::steady_clock::now();
-                      // auto now = std::chrono::steady_clock::now();
-                      // if (now - lastDumpTime >= std::chrono::seconds(1)) {
-                      //   auto &queue = core.GetResource<wgpu::Queue>();
-                      //   // Dumper la première couche de la texture array (index
-                      //   // 0)
-                      //   DumpDepthTextureAsPNG(device, queue,
-                      //                         textureShadows.texture, 2048,
-                      //                         2048, "depth.png", 0);
-                      //   lastDumpTime = now;
-                      // }
-
                     }});
         core.GetResource<RenderGraph>().AddRenderPass(RenderPassData{
             .name = "GBuffer",
@@ -316,6 +324,15 @@ void Plugin::Bind() {
             .outputColorTextureName = {"gBufferTexture2DFloat16",
                                        "gBufferTextureAlbedo"},
             .outputDepthTextureName = "depthTexture",
+            .transientTextures =
+                {
+                    {.name = "gBufferTexture2DFloat16",
+                     .format = wgpu::TextureFormat::RGBA16Float},
+                    {.name = "gBufferTextureAlbedo",
+                     .format = wgpu::TextureFormat::BGRA8Unorm},
+                    {.name = "depthTexture",
+                     .format = wgpu::TextureFormat::Depth24Plus},
+                },
             .bindGroups =
                 {
                     {.groupIndex = 0,
@@ -328,12 +345,14 @@ void Plugin::Bind() {
                      .type = BindGroupsLinks::AssetType::BindGroup,
                      .name = "GBufferUniforms"},
                 },
+            .useRenderBundle = true,
+            .parallelRecording = true,
+            .cullingView = GpuCulling::CameraView,
             .perEntityCallback =
-                [](wgpu::RenderPassEncoder &renderPass, ES::Engine::Core &core,
+                [](RenderEncoder &renderPass, ES::Engine::Core &core,
                    ES::Plugin::WebGPU::Component::Mesh &mesh,
                    ES::Plugin::Object::Component::Transform &transform,
                    ES::Engine::Entity entity) {
-                  auto &queue = core.GetResource<wgpu::Queue>();
                   auto &textures = core.GetResource<TextureManager>();
                   entt::hashed_string textureName =
                       entt::hashed_string("DEFAULT_TEXTURE");
@@ -341,21 +360,9 @@ void Plugin::Bind() {
                       textures.Contains(mesh.textures[0])) {
                     textureName = mesh.textures[0];
                   }
-                  auto texture = textures.Get(textureName);
-
-                  // TODO: do that only at update AND before rendering passes
-                  std::vector<uint32_t> data(mesh.indexCount);
-                  for (size_t i = 0; i < data.size(); i++) {
-                    data[i] = entityIndex;
-                  }
-                  queue.writeBuffer(mesh.transformIndexBuffer, 0, data.data(),
-                                    mesh.transformIndexBuffer.getSize());
+                  auto &texture = textures.Get(textureName);
 
-                  renderPass.setVertexBuffer(
-                      1, mesh.transformIndexBuffer, 0,
-                      mesh.transformIndexBuffer.getSize());
                   renderPass.setBindGroup(1, texture.bindGroup, 0, nullptr);
-                  entityIndex++;
                 }});
         core.GetResource<RenderGraph>().AddRenderPass(RenderPassData{
             .name = "Skybox",
@@ -366,14 +373,17 @@ void Plugin::Bind() {
               return glm::vec4(0, 0, 0, 0);
             },
             .outputColorTextureName = {"SkyboxOutput"},
+            .transientTextures = {{.name = "SkyboxOutput",
+                                   .format = wgpu::TextureFormat::RGBA16Float}},
             .bindGroups =
                 {
                     {.groupIndex = 0,
                      .type = BindGroupsLinks::AssetType::BindGroup,
                      .name = "Skybox"},
                 },
+            .parallelRecording = true,
             .uniqueRenderCallback =
-                [](wgpu::RenderPassEncoder renderPass, ES::Engine::Core &core) {
+                [](wgpu::RenderPassEncoder &renderPass, ES::Engine::Core &core) {
                   renderPass.setVertexBuffer(0, skyboxCubeBuffer, 0,
                                              skyboxCubeBuffer.getSize());
                   renderPass.draw(36, 1, 0, 0);
@@ -383,11 +393,16 @@ void Plugin::Bind() {
             .shaderName = "Deferred",
             .pipelineType = PipelineType::_3D,
             .loadOp = wgpu::LoadOp::Clear,
-            .clearColor = [](ES::Engine::Core &core) -> auto {
+            .clearColor = [](ES::Engine::Core &core) -> glm::vec4 {
               return glm::vec4(0.f, 0.f, 0.f, 1.0);
             },
+            .inputTextureNames = {"gBufferTexture2DFloat16",
+                                  "gBufferTextureAlbedo", "depthTexture",
+                                  "SkyboxOutput"},
             .outputColorTextureName = {"InputEndPostProcess"},
             .outputDepthTextureName = "WindowDepthTexture",
+            .transientTextures = {{.name = "InputEndPostProcess",
+                                   .format = wgpu::TextureFormat::RGBA16Float}},
             .bindGroups = {{.groupIndex = 0,
                             .type = BindGroupsLinks::AssetType::BindGroup,
                             .name = "DeferredGroup0"},
@@ -412,9 +427,10 @@ void Plugin::Bind() {
             .shaderName = "EndPostProcess",
             .pipelineType = PipelineType::_3D,
             .loadOp = wgpu::LoadOp::Clear,
-            .clearColor = [](ES::Engine::Core &core) -> auto {
+            .clearColor = [](ES::Engine::Core &core) -> glm::vec4 {
               return glm::vec4(0.f, 0.f, 0.f, 1.f);
             },
+            .inputTextureNames = {"InputEndPostProcess"},
             .outputColorTextureName = {"WindowColorTexture"},
             .bindGroups = {{.groupIndex = 0,
                             .type = BindGroupsLinks::AssetType::BindGroup,
@@ -437,7 +453,7 @@ void Plugin::Bind() {
                      .name = "2D"},
                 },
             .perEntityCallback =
-                [](wgpu::RenderPassEncoder &renderPass, ES::Engine::Core &core,
+                [](RenderEncoder &renderPass, ES::Engine::Core &core,
                    ES::Plugin::WebGPU::Component::Mesh &mesh,
                    ES::Plugin::Object::Component::Transform &transform,
                    ES::Engine::Entity entity) {
@@ -448,21 +464,53 @@ void Plugin::Bind() {
                       textures.Contains(mesh.textures[0])) {
                     textureName = mesh.textures[0];
                   }
-                  auto texture = textures.Get(textureName);
+                  auto &texture = textures.Get(textureName);
                   renderPass.setBindGroup(1, texture.bindGroup, 0, nullptr);
                 }});
       });
   RegisterSystems<ES::Plugin::RenderingPipeline::ToGPU>(
+      [](ES::Engine::Core &core) {
+        core.GetResource<FrameStats>().BeginFrame();
+        core.GetResource<FramesInFlight>().BeginFrame(core.GetResource<wgpu::Device>());
+      },
+      // Recreates the lights buffers, never while the render graph records
+      // passes that bind them
+      [](ES::Engine::Core &core) {
+        auto &lightsDirty = core.GetResource<LightsDirty>();
+        if (!lightsDirty.value)
+          return;
+        Util::UpdateLights(core);
+        lightsDirty.value = false;
+      },
       System::UpdateBuffers, System::UpdateCameraBuffer,
-      [](ES::Engine::Core &core) { entityIndex = 0; },
-      System::UpdateBufferUniforms, System::GenerateSurfaceTexture,
+      System::UpdateMeshLODs, System::UpdateBufferUniforms,
+      [](ES::Engine::Core &core) { core.GetResource<GpuCulling>().Update(core); },
+      System::GenerateSurfaceTexture,
       [](ES::Engine::Core &core) {
         core.GetResource<RenderGraph>().Execute(core);
       });
-  RegisterSystems<ES::Plugin::RenderingPipeline::Draw>(System::Render);
+  RegisterSystems<ES::Plugin::RenderingPipeline::Draw>(
+      System::Render,
+      [](ES::Engine::Core &core) { core.GetResource<CpuProfiler>().Collect(); });
   RegisterSystems<ES::Engine::Scheduler::Shutdown>(
-      System::ReleaseBindingGroup, System::ReleaseUniforms,
-      System::ReleaseBuffers, System::TerminateDepthBuffer,
+#if defined(ES_PROFILING)
+      [](ES::Engine::Core &core) {
+        core.GetResource<CpuProfiler>().ExportChromeTrace("cpu_trace.json");
+      },
+#endif
+      System::ReleaseBindingGroup,
+      [](ES::Engine::Core &core) {
+        core.GetResource<RenderGraph>().ReleaseRenderBundles();
+        core.GetResource<RenderGraph>().ReleaseProfiler();
+        core.GetResource<RenderGraph>().ReleaseTransientTextures(core);
+      },
+      System::ReleaseUniforms,
+      System::ReleaseBuffers,
+      [](ES::Engine::Core &core) {
+        core.GetResource<GeometryPool>().Release();
+        core.GetResource<GpuCulling>().Release();
+      },
+      System::TerminateDepthBuffer,
       System::ReleasePipeline, System::ReleaseDevice, System::ReleaseSurface,
       System::ReleaseQueue);
 }
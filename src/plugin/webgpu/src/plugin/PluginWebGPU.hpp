@@ -1,10 +1,31 @@
 #pragma once
 
 #include "plugin/APlugin.hpp"
+#include "webgpu.hpp"
+#include <glm/glm.hpp>
 
 namespace ES::Plugin::WebGPU {
 class Plugin : public ES::Engine::APlugin {
   public:
+    struct Settings {
+      // Render into an offscreen texture instead of a window: no window plugin, no surface, nothing presented
+      bool headless = false;
+      glm::uvec2 headlessResolution = {1280, 720};
+      wgpu::TextureFormat headlessFormat = wgpu::TextureFormat::BGRA8UnormSrgb;
+      // Cull the 3D meshes against the camera and shadow frustums in a compute pass and draw them indirectly
+      bool gpuCulling = true;
+      // 3D meshes use GeometryPool::PackedVertex (16 bytes instead of 32), they have to be built with GeometryPool::GetFormat3D
+      bool packedVertices = false;
+      // Upload 40 bytes transforms of the moved meshes and expand them into the GBuffer uniforms in a compute pass,
+      // instead of computing and uploading their matrices on the CPU
+      bool gpuTransforms = false;
+      // Frames recorded before waiting for the GPU (1 to 3), the per-frame uniforms have a region for each
+      uint32_t framesInFlight = 2;
+    };
+
+    // Read when the plugin is bound, set it before adding the plugin
+    static inline Settings settings;
+
     using APlugin::APlugin;
     ~Plugin() = default;
 
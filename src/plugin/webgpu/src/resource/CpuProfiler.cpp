@@ -0,0 +1,125 @@
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+
+static std::atomic<uint64_t> nextProfilerId = 1;
+
+// Zone names include the names of the render graph passes, given by the user
+static std::string EscapeJson(std::string_view text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text) {
+        switch (c) {
+        case '"': escaped += "\\\""; break;
+        case '\\': escaped += "\\\\"; break;
+        case '\n': escaped += "\\n"; break;
+        case '\r': escaped += "\\r"; break;
+        case '\t': escaped += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) escaped += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+            else escaped += c;
+            break;
+        }
+    }
+    return escaped;
+}
+
+CpuProfiler::CpuProfiler() : id(nextProfilerId++), epoch(std::chrono::steady_clock::now()) {}
+
+CpuProfiler::CpuProfiler(CpuProfiler &&other) noexcept : id(other.id), epoch(other.epoch) {
+    std::lock_guard lock(other.ringsMutex);
+    rings = std::move(other.rings);
+    captured = std::move(other.captured);
+    other.id = nextProfilerId++;
+}
+
+uint64_t CpuProfiler::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+CpuProfiler::ThreadRing &CpuProfiler::getThreadRing() {
+    thread_local ThreadRing *ring = nullptr;
+    thread_local uint64_t ringOwner = 0;
+
+    if (ringOwner != id) {
+        std::lock_guard lock(ringsMutex);
+        rings.push_back(std::make_unique<ThreadRing>());
+        ring = rings.back().get();
+        ring->threadIndex = static_cast<uint32_t>(rings.size() - 1);
+        ringOwner = id;
+    }
+    return *ring;
+}
+
+CpuProfiler::Zone::Zone(CpuProfiler &profiler, std::string_view name) : profiler(profiler), name(name), beginNanoseconds(profiler.now()) {
+    profiler.getThreadRing().depth++;
+}
+
+CpuProfiler::Zone::~Zone() {
+    uint64_t endNanoseconds = profiler.now();
+    ThreadRing &ring = profiler.getThreadRing();
+    ring.depth--;
+
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= RingCapacity) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ZoneEvent &event = ring.events[head % RingCapacity];
+    size_t length = std::min(name.size(), MaxZoneNameLength - 1);
+    std::copy_n(name.data(), length, event.name.data());
+    event.name[length] = '\0';
+    event.beginNanoseconds = beginNanoseconds;
+    event.endNanoseconds = endNanoseconds;
+    event.depth = ring.depth;
+    event.threadIndex = ring.threadIndex;
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::Collect() {
+    std::lock_guard lock(ringsMutex);
+
+    for (auto &ring : rings) {
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        size_t head = ring->head.load(std::memory_order_acquire);
+        for (; tail != head; tail++) {
+            captured.push_back(ring->events[tail % RingCapacity]);
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+
+    while (captured.size() > MaxCapturedZones) captured.pop_front();
+}
+
+uint64_t CpuProfiler::GetDroppedZones() const {
+    std::lock_guard lock(ringsMutex);
+    uint64_t dropped = 0;
+    for (auto &ring : rings) dropped += ring->dropped.load(std::memory_order_relaxed);
+    return dropped;
+}
+
+void CpuProfiler::ExportChromeTrace(const std::filesystem::path &path) {
+    Collect();
+
+    std::ofstream file(path);
+    if (!file) throw std::runtime_error(fmt::format("CpuProfiler: Could not open {} for writing.", path.string()));
+
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    for (size_t i = 0; i < rings.size(); i++) {
+        file << (first ? "" : ",") << fmt::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":{},\"args\":{{\"name\":\"Thread {}\"}}}}", i, i);
+        first = false;
+    }
+    for (const ZoneEvent &event : captured) {
+        file << (first ? "" : ",") << fmt::format("{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":0,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+            EscapeJson(event.name.data()), event.threadIndex, event.beginNanoseconds / 1000.0, (event.endNanoseconds - event.beginNanoseconds) / 1000.0);
+        first = false;
+    }
+    file << "],\"displayTimeUnit\":\"ms\"}\n";
+}
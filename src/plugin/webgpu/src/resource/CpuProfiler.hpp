@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Records nested CPU zones of every thread, to find which system a frame-time spike comes from. Each thread writes its
+// closed zones into its own lock-free ring, drained once per frame by Collect. The last captured zones can be exported
+// as a Chrome trace (chrome://tracing, Perfetto).
+// Zones are only recorded when ES_PROFILING is defined (debug builds, or `xmake f --profiling=y`).
+class CpuProfiler {
+    public:
+        static constexpr size_t MaxZoneNameLength = 40;
+        static constexpr size_t RingCapacity = 4096; // Per thread, between two calls to Collect
+        static constexpr size_t MaxCapturedZones = 1 << 16;
+
+        struct ZoneEvent {
+            std::array<char, MaxZoneNameLength> name; // Copied, the zone name may not outlive the export
+            uint64_t beginNanoseconds = 0;
+            uint64_t endNanoseconds = 0;
+            uint32_t depth = 0;
+            uint32_t threadIndex = 0;
+        };
+
+        // RAII zone, recorded when it goes out of scope
+        class Zone {
+            public:
+                Zone(CpuProfiler &profiler, std::string_view name);
+                ~Zone();
+
+                Zone(const Zone &) = delete;
+                Zone &operator=(const Zone &) = delete;
+
+            private:
+                CpuProfiler &profiler;
+                std::string_view name;
+                uint64_t beginNanoseconds;
+        };
+
+        CpuProfiler();
+        CpuProfiler(CpuProfiler &&other) noexcept;
+        CpuProfiler &operator=(CpuProfiler &&other) = delete;
+        CpuProfiler(const CpuProfiler &) = delete;
+        CpuProfiler &operator=(const CpuProfiler &) = delete;
+
+        // Move the zones written by every thread into the capture, keeping the last MaxCapturedZones.
+        // Must always be called from the same thread.
+        void Collect();
+
+        void ExportChromeTrace(const std::filesystem::path &path);
+
+        uint64_t GetDroppedZones() const;
+
+    private:
+        // Single producer (the owning thread), single consumer (Collect)
+        struct ThreadRing {
+            uint32_t threadIndex = 0;
+            uint32_t depth = 0; // Only touched by the owning thread
+            std::atomic<size_t> head = 0; // Written by the producer
+            std::atomic<size_t> tail = 0; // Written by the consumer
+            std::atomic<uint64_t> dropped = 0;
+            std::array<ZoneEvent, RingCapacity> events;
+        };
+
+        ThreadRing &getThreadRing();
+        uint64_t now() const;
+
+        uint64_t id; // Lets a thread tell its cached ring belongs to a previous profiler
+        std::chrono::steady_clock::time_point epoch;
+
+        mutable std::mutex ringsMutex; // Only taken the first time a thread records a zone, and by Collect
+        std::vector<std::unique_ptr<ThreadRing>> rings;
+        std::deque<ZoneEvent> captured;
+};
+
+#if defined(ES_PROFILING)
+#define ES_PROFILE_CONCAT_IMPL(a, b) a##b
+#define ES_PROFILE_CONCAT(a, b) ES_PROFILE_CONCAT_IMPL(a, b)
+#define ES_PROFILE_ZONE(core, name) CpuProfiler::Zone ES_PROFILE_CONCAT(esProfileZone, __LINE__)((core).GetResource<CpuProfiler>(), name)
+#else
+#define ES_PROFILE_ZONE(core, name) ((void)0)
+#endif
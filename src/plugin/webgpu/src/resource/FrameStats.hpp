@@ -0,0 +1,26 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Counters of the frame being rendered, reset when ToGPU starts and complete once Draw is done
+struct FrameStats {
+    uint64_t frameIndex = 0;
+    std::chrono::steady_clock::time_point frameStart;
+    uint32_t drawCalls = 0; // Set by the render graph once every pass is recorded
+    std::atomic<uint64_t> bytesUploaded = 0; // Through queue.writeBuffer, passes recorded in parallel upload too
+
+    FrameStats() = default;
+    FrameStats(FrameStats &&other) noexcept
+        : frameIndex(other.frameIndex), frameStart(other.frameStart), drawCalls(other.drawCalls), bytesUploaded(other.bytesUploaded.load()) {}
+
+    void BeginFrame() {
+        frameIndex++;
+        frameStart = std::chrono::steady_clock::now();
+        drawCalls = 0;
+        bytesUploaded.store(0, std::memory_order_relaxed);
+    }
+
+    void RecordUpload(uint64_t size) { bytesUploaded.fetch_add(size, std::memory_order_relaxed); }
+};
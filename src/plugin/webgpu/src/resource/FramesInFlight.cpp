@@ -0,0 +1,53 @@
+#include "FramesInFlight.hpp"
+
+#include <fmt/format.h>
+#include <stdexcept>
+
+uint64_t FramesInFlight::GetOffsetAlignment(wgpu::Device &device, wgpu::BufferUsage usage) {
+    wgpu::Limits limits(wgpu::Default);
+    device.getLimits(&limits);
+    return (usage & wgpu::BufferUsage::Storage) ? limits.minStorageBufferOffsetAlignment : limits.minUniformBufferOffsetAlignment;
+}
+
+wgpu::Buffer FramesInFlight::CreateRing(wgpu::Device &device, const char *label, uint64_t size, wgpu::BufferUsage usage) const {
+    uint64_t alignment = GetOffsetAlignment(device, usage);
+    uint64_t stride = (size + alignment - 1) / alignment * alignment;
+
+    wgpu::BufferDescriptor bufferDesc(wgpu::Default);
+    bufferDesc.size = stride * count;
+    bufferDesc.usage = usage | wgpu::BufferUsage::CopyDst;
+    bufferDesc.label = wgpu::StringView(label);
+    wgpu::Buffer buffer = device.createBuffer(bufferDesc);
+    if (buffer == nullptr) throw std::runtime_error(fmt::format("FramesInFlight: Could not create {}.", label));
+    return buffer;
+}
+
+void FramesInFlight::BeginFrame(wgpu::Device &device) {
+    frame++;
+
+    uint32_t index = GetIndex();
+    if (submittedFrames[index] <= completedFrame) return;
+
+    // Let wgpu fire the callbacks of the frames already done, and only block when this region is still in use
+    device.poll(false, nullptr);
+    if (submittedFrames[index] <= completedFrame) return;
+    device.poll(true, &submissions[index]);
+    completedFrame = std::max(completedFrame, submittedFrames[index]);
+}
+
+void FramesInFlight::EndFrame(wgpu::Queue &queue, wgpu::SubmissionIndex submission) {
+    uint32_t index = GetIndex();
+    submittedFrames[index] = frame;
+    submissions[index] = submission;
+
+    wgpu::QueueWorkDoneCallbackInfo callbackInfo(wgpu::Default);
+    callbackInfo.mode = wgpu::CallbackMode::AllowSpontaneous;
+    callbackInfo.callback = [](WGPUQueueWorkDoneStatus status, WGPU_NULLABLE void *userdata1, WGPU_NULLABLE void *userdata2) {
+        if (status != WGPUQueueWorkDoneStatus_Success) return;
+        auto *framesInFlight = static_cast<FramesInFlight *>(userdata1);
+        framesInFlight->completedFrame = std::max(framesInFlight->completedFrame, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(userdata2)));
+    };
+    callbackInfo.userdata1 = this;
+    callbackInfo.userdata2 = reinterpret_cast<void *>(static_cast<uintptr_t>(frame));
+    queue.onSubmittedWorkDone(callbackInfo);
+}
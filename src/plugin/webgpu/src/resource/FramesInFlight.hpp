@@ -0,0 +1,48 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "webgpu.hpp"
+
+// Frames the CPU may record ahead of the GPU. The buffers the CPU rewrites whole every frame (camera, lights, 2D,
+// skybox uniforms, shadow matrices of the lights) are rings of GetCount() regions: frame N writes and binds region
+// N % count, with a dynamic offset, so it never writes over what an earlier frame still reads. Before reusing a region,
+// BeginFrame waits until the GPU is done with the frame that last used it, which onSubmittedWorkDone reports.
+// Each ring is a buffer of its own: they are bound by different layouts, uniform and storage offsets do not have the
+// same alignment, and the light rings are recreated when the light count changes, with the bind groups on them.
+// The GBuffer uniforms (uniformsBuffer) and the instances are not rings. They persist across frames and only the slots
+// that changed are written, or the GPU writes them (transform expansion, culling). A ring would upload every change
+// once per region and hold GetCount() copies of the largest buffers, while the queue already orders these writes after
+// the frames submitted before them: a frame in flight may wait on them, it never reads a half written slot.
+class FramesInFlight {
+    public:
+        static constexpr uint32_t MaxCount = 3;
+
+        explicit FramesInFlight(uint32_t count = 2) : count(std::clamp(count, 1u, MaxCount)) {}
+
+        uint32_t GetCount() const { return count; }
+        // Region of the rings written and bound this frame
+        uint32_t GetIndex() const { return static_cast<uint32_t>(frame % count); }
+        // Dynamic offset of the region of this frame in a buffer created by CreateRing
+        uint32_t GetOffset(const wgpu::Buffer &ring) const { return static_cast<uint32_t>(ring.getSize() / count * GetIndex()); }
+
+        // Of the dynamic offsets and of the bindings into a ring
+        static uint64_t GetOffsetAlignment(wgpu::Device &device, wgpu::BufferUsage usage);
+        // GetCount() regions of size bytes, each one aligned as the device requires for dynamic offsets. Bind groups
+        // bind size bytes of it, from offset 0.
+        wgpu::Buffer CreateRing(wgpu::Device &device, const char *label, uint64_t size, wgpu::BufferUsage usage) const;
+
+        // Before the first write of the frame, waits until the region of this frame is no longer read by the GPU
+        void BeginFrame(wgpu::Device &device);
+        // After the last submit of the frame
+        void EndFrame(wgpu::Queue &queue, wgpu::SubmissionIndex submission);
+
+    private:
+        uint32_t count;
+        uint64_t frame = 0; // Frames begun, the first one is 1
+        uint64_t completedFrame = 0; // Last frame the GPU finished, set by the onSubmittedWorkDone callbacks
+        std::array<uint64_t, MaxCount> submittedFrames = {}; // Last frame submitted with each region
+        std::array<wgpu::SubmissionIndex, MaxCount> submissions = {};
+};
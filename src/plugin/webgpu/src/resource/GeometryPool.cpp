@@ -0,0 +1,205 @@
+#include "GeometryPool.hpp"
+#include "FrameStats.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <fmt/format.h>
+
+// Create a buffer of newSize bytes keeping the first oldSize bytes of the previous one
+static wgpu::Buffer ResizeBuffer(ES::Engine::Core &core, wgpu::Buffer &previous, uint64_t oldSize, uint64_t newSize, wgpu::BufferUsage usage, const char *label) {
+    auto &device = core.GetResource<wgpu::Device>();
+
+    wgpu::Limits limits(wgpu::Default);
+    device.getLimits(&limits);
+    if (newSize > limits.maxBufferSize) {
+        throw std::runtime_error(fmt::format("GeometryPool: {} would need {} bytes, the device allows {}.", label, newSize, limits.maxBufferSize));
+    }
+
+    wgpu::BufferDescriptor bufferDesc(wgpu::Default);
+    bufferDesc.label = wgpu::StringView(label);
+    bufferDesc.size = newSize;
+    bufferDesc.usage = usage | wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::CopySrc;
+    wgpu::Buffer buffer = device.createBuffer(bufferDesc);
+    if (buffer == nullptr) throw std::runtime_error(fmt::format("GeometryPool: Could not create {}.", label));
+
+    if (previous != nullptr) {
+        // Writes already queued on the previous buffer are executed before this copy
+        if (oldSize > 0) {
+            wgpu::CommandEncoder encoder = device.createCommandEncoder();
+            encoder.copyBufferToBuffer(previous, 0, buffer, 0, oldSize);
+            wgpu::CommandBuffer commandBuffer = encoder.finish();
+            encoder.release();
+            core.GetResource<wgpu::Queue>().submit(1, &commandBuffer);
+            commandBuffer.release();
+        }
+        previous.destroy();
+        previous.release();
+    }
+
+    ES::Utils::Log::Debug(fmt::format("GeometryPool: {} resized to {} bytes.", label, newSize));
+    return buffer;
+}
+
+void GeometryPool::growVertices(ES::Engine::Core &core, VertexFormat format, uint32_t minCapacity) {
+    RangeAllocator &vertexAllocator = vertexAllocators[size_t(format)];
+    uint32_t oldCapacity = vertexAllocator.GetCapacity();
+    uint32_t newCapacity = std::max({ minCapacity, oldCapacity * 2, InitialVertexCapacity });
+
+    const char *label = format == VertexFormat::Packed ? "GeometryPool::PackedVertexBuffer" : "GeometryPool::VertexBuffer";
+    vertexBuffers[size_t(format)] = ResizeBuffer(core, vertexBuffers[size_t(format)], uint64_t(oldCapacity) * GetVertexSize(format), uint64_t(newCapacity) * GetVertexSize(format), wgpu::BufferUsage::Vertex, label);
+    vertexAllocator.Grow(newCapacity);
+    generation++;
+}
+
+void GeometryPool::growIndices(ES::Engine::Core &core, IndexFormat format, uint32_t minCapacity) {
+    RangeAllocator &indexAllocator = indexAllocators[size_t(format)];
+    uint32_t oldCapacity = indexAllocator.GetCapacity();
+    uint32_t newCapacity = std::max({ minCapacity, oldCapacity * 2, InitialIndexCapacity });
+
+    const char *label = format == IndexFormat::Uint16 ? "GeometryPool::IndexBuffer16" : "GeometryPool::IndexBuffer";
+    indexBuffers[size_t(format)] = ResizeBuffer(core, indexBuffers[size_t(format)], uint64_t(oldCapacity) * GetIndexSize(format), uint64_t(newCapacity) * GetIndexSize(format), wgpu::BufferUsage::Index | wgpu::BufferUsage::Storage, label);
+    indexAllocator.Grow(newCapacity);
+    generation++;
+}
+
+uint64_t GeometryPool::GetVertexSize(VertexFormat format) {
+    return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+wgpu::VertexBufferLayout GeometryPool::GetVertexBufferLayout(VertexFormat format) {
+    static const std::array<WGPUVertexAttribute, 3> floatAttributes = {{
+        { .format = wgpu::VertexFormat::Float32x3, .offset = offsetof(Vertex, position), .shaderLocation = 0 },
+        { .format = wgpu::VertexFormat::Float32x3, .offset = offsetof(Vertex, normal), .shaderLocation = 1 },
+        { .format = wgpu::VertexFormat::Float32x2, .offset = offsetof(Vertex, uv), .shaderLocation = 2 },
+    }};
+    static const std::array<WGPUVertexAttribute, 3> packedAttributes = {{
+        { .format = wgpu::VertexFormat::Unorm16x4, .offset = offsetof(PackedVertex, position), .shaderLocation = 0 },
+        { .format = wgpu::VertexFormat::Snorm16x2, .offset = offsetof(PackedVertex, normal), .shaderLocation = 1 },
+        { .format = wgpu::VertexFormat::Float16x2, .offset = offsetof(PackedVertex, uv), .shaderLocation = 2 },
+    }};
+    const auto &attributes = format == VertexFormat::Packed ? packedAttributes : floatAttributes;
+
+    wgpu::VertexBufferLayout layout(wgpu::Default);
+    layout.attributeCount = static_cast<uint32_t>(attributes.size());
+    layout.attributes = attributes.data();
+    layout.arrayStride = GetVertexSize(format);
+    layout.stepMode = wgpu::VertexStepMode::Vertex;
+    return layout;
+}
+
+GeometryPool::Allocation GeometryPool::Allocate(ES::Engine::Core &core, uint32_t vertexCount, uint32_t indexCount, VertexFormat format, IndexFormat indexFormat) {
+    Allocation allocation;
+    allocation.vertexCount = vertexCount;
+    allocation.indexCount = indexCount;
+    allocation.format = format;
+    allocation.indexFormat = indexFormat;
+
+    RangeAllocator &vertexAllocator = vertexAllocators[size_t(format)];
+    allocation.vertexOffset = vertexAllocator.Allocate(vertexCount);
+    if (allocation.vertexOffset == RangeAllocator::InvalidOffset || vertexBuffers[size_t(format)] == nullptr) {
+        if (allocation.vertexOffset != RangeAllocator::InvalidOffset) vertexAllocator.Free(allocation.vertexOffset, vertexCount);
+        growVertices(core, format, vertexAllocator.GetCapacity() + vertexCount);
+        allocation.vertexOffset = vertexAllocator.Allocate(vertexCount);
+    }
+
+    RangeAllocator &indexAllocator = indexAllocators[size_t(indexFormat)];
+    uint32_t indexRange = indexRangeSize(indexFormat, indexCount);
+    allocation.firstIndex = indexAllocator.Allocate(indexRange);
+    if (allocation.firstIndex == RangeAllocator::InvalidOffset || indexBuffers[size_t(indexFormat)] == nullptr) {
+        if (allocation.firstIndex != RangeAllocator::InvalidOffset) indexAllocator.Free(allocation.firstIndex, indexRange);
+        growIndices(core, indexFormat, indexAllocator.GetCapacity() + indexRange);
+        allocation.firstIndex = indexAllocator.Allocate(indexRange);
+    }
+
+    return allocation;
+}
+
+bool GeometryPool::Free(Allocation &allocation) {
+    if (!allocation.IsValid()) return false;
+
+    if (auto it = extraOwners.find(ownerKey(allocation)); it != extraOwners.end() && allocation.vertexCount > 0) {
+        if (--it->second == 0) extraOwners.erase(it);
+        allocation = Allocation();
+        return false;
+    }
+
+    vertexAllocators[size_t(allocation.format)].Free(allocation.vertexOffset, allocation.vertexCount);
+    indexAllocators[size_t(allocation.indexFormat)].Free(allocation.firstIndex, indexRangeSize(allocation.indexFormat, allocation.indexCount));
+    allocation = Allocation();
+    return true;
+}
+
+void GeometryPool::Acquire(const Allocation &allocation) {
+    // Empty allocations do not own any range
+    if (!allocation.IsValid() || allocation.vertexCount == 0) return;
+    extraOwners[ownerKey(allocation)]++;
+}
+
+void GeometryPool::writeVertices(ES::Engine::Core &core, const Allocation &allocation, VertexFormat format, const void *data, size_t count) {
+    if (allocation.format != format) throw std::runtime_error("GeometryPool: Vertex format does not match the allocation.");
+    if (count != allocation.vertexCount) throw std::runtime_error("GeometryPool: Vertex count does not match the allocation.");
+    if (count == 0) return;
+
+    uint64_t vertexSize = GetVertexSize(format);
+    core.GetResource<wgpu::Queue>().writeBuffer(vertexBuffers[size_t(format)], uint64_t(allocation.vertexOffset) * vertexSize, data, count * vertexSize);
+    core.GetResource<FrameStats>().RecordUpload(count * vertexSize);
+}
+
+void GeometryPool::WriteVertices(ES::Engine::Core &core, const Allocation &allocation, std::span<const Vertex> vertices) {
+    writeVertices(core, allocation, VertexFormat::Float32, vertices.data(), vertices.size());
+}
+
+void GeometryPool::WriteVertices(ES::Engine::Core &core, const Allocation &allocation, std::span<const PackedVertex> vertices) {
+    writeVertices(core, allocation, VertexFormat::Packed, vertices.data(), vertices.size());
+}
+
+void GeometryPool::WriteIndices(ES::Engine::Core &core, const Allocation &allocation, std::span<const uint32_t> indices) {
+    if (allocation.indexFormat != IndexFormat::Uint32) throw std::runtime_error("GeometryPool: Index format does not match the allocation.");
+    if (indices.size() != allocation.indexCount) throw std::runtime_error("GeometryPool: Index count does not match the allocation.");
+    if (indices.empty()) return;
+
+    core.GetResource<wgpu::Queue>().writeBuffer(indexBuffers[size_t(IndexFormat::Uint32)], uint64_t(allocation.firstIndex) * sizeof(uint32_t), indices.data(), indices.size_bytes());
+    core.GetResource<FrameStats>().RecordUpload(indices.size_bytes());
+}
+
+void GeometryPool::WriteIndices(ES::Engine::Core &core, const Allocation &allocation, std::span<const uint16_t> indices) {
+    if (allocation.indexFormat != IndexFormat::Uint16) throw std::runtime_error("GeometryPool: Index format does not match the allocation.");
+    if (indices.size() != allocation.indexCount) throw std::runtime_error("GeometryPool: Index count does not match the allocation.");
+    if (indices.empty()) return;
+
+    auto &queue = core.GetResource<wgpu::Queue>();
+    const wgpu::Buffer &indexBuffer = indexBuffers[size_t(IndexFormat::Uint16)];
+    uint64_t offset = uint64_t(allocation.firstIndex) * sizeof(uint16_t);
+
+    // Writes are multiples of 4 bytes, the last index of an odd count goes with the padding of the range
+    size_t evenCount = indices.size() & ~size_t(1);
+    if (evenCount > 0) queue.writeBuffer(indexBuffer, offset, indices.data(), evenCount * sizeof(uint16_t));
+    if (evenCount != indices.size()) {
+        std::array<uint16_t, 2> last = { indices.back(), 0 };
+        queue.writeBuffer(indexBuffer, offset + evenCount * sizeof(uint16_t), last.data(), sizeof(last));
+    }
+    core.GetResource<FrameStats>().RecordUpload(indexRangeSize(IndexFormat::Uint16, allocation.indexCount) * sizeof(uint16_t));
+}
+
+void GeometryPool::BindVertices(RenderEncoder &encoder, VertexFormat format) const {
+    const wgpu::Buffer &vertexBuffer = vertexBuffers[size_t(format)];
+    encoder.setVertexBuffer(0, vertexBuffer, 0, vertexBuffer.getSize());
+}
+
+void GeometryPool::BindIndices(RenderEncoder &encoder, IndexFormat format) const {
+    const wgpu::Buffer &indexBuffer = indexBuffers[size_t(format)];
+    encoder.setIndexBuffer(indexBuffer, format == IndexFormat::Uint16 ? wgpu::IndexFormat::Uint16 : wgpu::IndexFormat::Uint32, 0, indexBuffer.getSize());
+}
+
+void GeometryPool::Release() {
+    for (wgpu::Buffer *buffer : { &vertexBuffers[0], &vertexBuffers[1], &indexBuffers[0], &indexBuffers[1] }) {
+        if (*buffer == nullptr) continue;
+        buffer->destroy();
+        buffer->release();
+        *buffer = nullptr;
+    }
+    vertexAllocators = {};
+    indexAllocators = {};
+    extraOwners.clear();
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <unordered_map>
+
+#include "webgpu.hpp"
+#include "RangeAllocator.hpp"
+#include "RenderEncoder.hpp"
+#include "core/Core.hpp"
+#include <glm/glm.hpp>
+
+// Vertices and indices of every mesh, suballocated from a few shared buffers so a pass binds them once and each draw
+// only gives its baseVertex/firstIndex. Buffers grow (and are copied) when full, which changes their handles.
+// Each vertex format has its own vertex buffer, and each index format its own index buffer.
+class GeometryPool {
+    public:
+        enum class VertexFormat : uint8_t {
+            Float32, // Vertex
+            Packed, // PackedVertex, half the size
+        };
+        static constexpr size_t VertexFormatCount = 2;
+
+        enum class IndexFormat : uint8_t {
+            Uint32,
+            Uint16, // Meshes with at most 65536 vertices
+        };
+        static constexpr size_t IndexFormatCount = 2;
+
+        struct Vertex {
+            glm::vec3 position;
+            glm::vec3 normal;
+            glm::vec2 uv;
+        };
+        static_assert(sizeof(Vertex) == 8 * sizeof(float), "GeometryPool::Vertex must match the vertex layout of the pipelines");
+
+        // Positions are quantized in the bounds of the mesh, the model matrix of the mesh maps them back (see
+        // Mesh::GetVertexToLocal), normals are octahedral encoded and decoded by the shaders
+        struct PackedVertex {
+            uint64_t position; // Unorm16x4, w is unused
+            uint32_t normal; // Snorm16x2
+            uint32_t uv; // Float16x2
+        };
+        static_assert(sizeof(PackedVertex) == 16, "GeometryPool::PackedVertex must match the vertex layout of the pipelines");
+
+        struct Allocation {
+            uint32_t vertexOffset = RangeAllocator::InvalidOffset; // baseVertex of the draws
+            uint32_t vertexCount = 0;
+            uint32_t firstIndex = RangeAllocator::InvalidOffset;
+            uint32_t indexCount = 0;
+            VertexFormat format = VertexFormat::Float32; // Vertex buffer the vertices live in
+            IndexFormat indexFormat = IndexFormat::Uint32; // Index buffer the indices live in
+
+            bool IsValid() const { return vertexOffset != RangeAllocator::InvalidOffset; }
+            bool operator==(const Allocation &) const = default;
+        };
+
+        static constexpr uint32_t InitialVertexCapacity = 1 << 16;
+        static constexpr uint32_t InitialIndexCapacity = 1 << 18;
+
+        // format3D is the format of the meshes drawn by the 3D pipelines (GBuffer and shadows)
+        explicit GeometryPool(VertexFormat format3D = VertexFormat::Float32) : format3D(format3D) {}
+        GeometryPool(GeometryPool &&) = default;
+        GeometryPool &operator=(GeometryPool &&) = default;
+        GeometryPool(const GeometryPool &) = delete;
+        GeometryPool &operator=(const GeometryPool &) = delete;
+
+        VertexFormat GetFormat3D() const { return format3D; }
+
+        static uint64_t GetVertexSize(VertexFormat format);
+        static uint64_t GetIndexSize(IndexFormat format) { return format == IndexFormat::Uint16 ? sizeof(uint16_t) : sizeof(uint32_t); }
+        // Smallest format addressing every vertex of a mesh
+        static IndexFormat GetIndexFormat(size_t vertexCount) { return vertexCount <= 65536 ? IndexFormat::Uint16 : IndexFormat::Uint32; }
+        // Positions, normals and uvs at locations 0, 1 and 2 of slot 0, attributes are kept in static storage
+        static wgpu::VertexBufferLayout GetVertexBufferLayout(VertexFormat format);
+
+        // Content is undefined until written
+        Allocation Allocate(ES::Engine::Core &core, uint32_t vertexCount, uint32_t indexCount, VertexFormat format = VertexFormat::Float32, IndexFormat indexFormat = IndexFormat::Uint32);
+        // Free drops one owner, the ranges are only given back once every owner freed the allocation, which is returned
+        bool Free(Allocation &allocation);
+        // Add an owner to an allocation, e.g. a mesh drawing the same geometry as another one
+        void Acquire(const Allocation &allocation);
+
+        void WriteVertices(ES::Engine::Core &core, const Allocation &allocation, std::span<const Vertex> vertices);
+        void WriteVertices(ES::Engine::Core &core, const Allocation &allocation, std::span<const PackedVertex> vertices);
+        void WriteIndices(ES::Engine::Core &core, const Allocation &allocation, std::span<const uint32_t> indices);
+        void WriteIndices(ES::Engine::Core &core, const Allocation &allocation, std::span<const uint16_t> indices);
+
+        // Vertices of this format in slot 0
+        void BindVertices(RenderEncoder &encoder, VertexFormat format) const;
+        void BindIndices(RenderEncoder &encoder, IndexFormat format) const;
+        // Also bindable as storage, e.g. read by the meshlet culling. Changes when the pool grows.
+        wgpu::Buffer GetIndexBuffer(IndexFormat format) const { return indexBuffers[size_t(format)]; }
+
+        bool IsEmpty() const { return indexBuffers[0] == nullptr && indexBuffers[1] == nullptr; }
+
+        // Changes each time a buffer grows, the commands binding the previous buffers have to be recorded again
+        uint64_t GetGeneration() const { return generation; }
+
+        void Release();
+
+    private:
+        void growVertices(ES::Engine::Core &core, VertexFormat format, uint32_t minCapacity);
+        void growIndices(ES::Engine::Core &core, IndexFormat format, uint32_t minCapacity);
+        // 16 bits ranges have an even size so every write (and copy) is aligned on 4 bytes
+        static uint32_t indexRangeSize(IndexFormat format, uint32_t indexCount) { return format == IndexFormat::Uint16 ? (indexCount + 1) & ~1u : indexCount; }
+        void writeVertices(ES::Engine::Core &core, const Allocation &allocation, VertexFormat format, const void *data, size_t count);
+
+        VertexFormat format3D = VertexFormat::Float32;
+
+        std::array<RangeAllocator, VertexFormatCount> vertexAllocators;
+        std::array<wgpu::Buffer, VertexFormatCount> vertexBuffers = {};
+
+        std::array<RangeAllocator, IndexFormatCount> indexAllocators;
+        std::array<wgpu::Buffer, IndexFormatCount> indexBuffers = {};
+
+        static uint64_t ownerKey(const Allocation &allocation) { return (uint64_t(allocation.format) << 32) | allocation.vertexOffset; }
+        std::unordered_map<uint64_t, uint32_t> extraOwners; // By ownerKey, owners besides the one that allocated
+        uint64_t generation = 0;
+};
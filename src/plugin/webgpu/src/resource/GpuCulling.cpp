@@ -0,0 +1,453 @@
+#include "GpuCulling.hpp"
+#include "CpuProfiler.hpp"
+#include "FrameStats.hpp"
+#include "GeometryPool.hpp"
+#include "InstanceBatches.hpp"
+#include "structs.hpp"
+#include "utils.hpp"
+#include "component/Transform.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fmt/format.h>
+
+// Planes of the clip volume in world space (Gribb & Hartmann). The near plane is taken at z = -w, which also holds for a
+// [0, 1] depth range, only slightly less tight.
+static std::array<glm::vec4, 6> ExtractFrustumPlanes(const glm::mat4 &viewProjection) {
+    auto row = [&](int i) { return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]); };
+    return {
+        row(3) + row(0),
+        row(3) - row(0),
+        row(3) + row(1),
+        row(3) - row(1),
+        row(3) + row(2),
+        row(3) - row(2),
+    };
+}
+
+static wgpu::Buffer CreateBuffer(wgpu::Device &device, const char *label, uint64_t size, wgpu::BufferUsage usage) {
+    wgpu::BufferDescriptor bufferDesc(wgpu::Default);
+    bufferDesc.label = wgpu::StringView(label);
+    bufferDesc.size = size;
+    bufferDesc.usage = usage | wgpu::BufferUsage::CopyDst;
+    wgpu::Buffer buffer = device.createBuffer(bufferDesc);
+    if (buffer == nullptr) throw std::runtime_error(fmt::format("GpuCulling: Could not create {}.", label));
+    return buffer;
+}
+
+static wgpu::ShaderModule LoadShaderModule(wgpu::Device &device, const char *path, const char *label) {
+    wgpu::ShaderSourceWGSL wgslDesc(wgpu::Default);
+    std::string wgslSource = loadFile(path);
+    wgslDesc.code = wgpu::StringView(wgslSource);
+    wgpu::ShaderModuleDescriptor shaderDesc(wgpu::Default);
+    shaderDesc.nextInChain = &wgslDesc.chain;
+    shaderDesc.label = wgpu::StringView(label);
+    return device.createShaderModule(shaderDesc);
+}
+
+// Binding i of group 0 is a buffer of types[i]
+template <size_t N>
+static wgpu::BindGroupLayout CreateBindGroupLayout(wgpu::Device &device, const std::array<wgpu::BufferBindingType, N> &types, const char *label) {
+    std::array<WGPUBindGroupLayoutEntry, N> entries = {};
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        entries[i].binding = i;
+        entries[i].visibility = wgpu::ShaderStage::Compute;
+        entries[i].buffer.type = types[i];
+    }
+
+    wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc(wgpu::Default);
+    bindGroupLayoutDesc.entryCount = entries.size();
+    bindGroupLayoutDesc.entries = entries.data();
+    bindGroupLayoutDesc.label = wgpu::StringView(label);
+    return device.createBindGroupLayout(bindGroupLayoutDesc);
+}
+
+template <size_t N>
+static wgpu::BindGroup CreateBindGroup(wgpu::Device &device, wgpu::BindGroupLayout layout, const std::array<wgpu::Buffer, N> &buffers, const char *label) {
+    std::array<wgpu::BindGroupEntry, N> entries;
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        entries[i] = wgpu::BindGroupEntry(wgpu::Default);
+        entries[i].binding = i;
+        entries[i].buffer = buffers[i];
+        entries[i].size = buffers[i].getSize();
+    }
+
+    wgpu::BindGroupDescriptor bindGroupDesc(wgpu::Default);
+    bindGroupDesc.layout = layout;
+    bindGroupDesc.entryCount = entries.size();
+    bindGroupDesc.entries = entries.data();
+    bindGroupDesc.label = wgpu::StringView(label);
+    wgpu::BindGroup bindGroup = device.createBindGroup(bindGroupDesc);
+    if (bindGroup == nullptr) throw std::runtime_error(fmt::format("GpuCulling: Could not create {}.", label));
+    return bindGroup;
+}
+
+static wgpu::ComputePipeline CreatePipeline(wgpu::Device &device, wgpu::PipelineLayout layout, wgpu::ShaderModule module, const char *entryPoint, const char *label) {
+    wgpu::ComputePipelineDescriptor pipelineDesc(wgpu::Default);
+    pipelineDesc.label = wgpu::StringView(label);
+    pipelineDesc.layout = layout;
+    pipelineDesc.compute.module = module;
+    pipelineDesc.compute.entryPoint = wgpu::StringView(entryPoint);
+    return device.createComputePipeline(pipelineDesc);
+}
+
+static wgpu::PipelineLayout CreatePipelineLayout(wgpu::Device &device, wgpu::BindGroupLayout bindGroupLayout) {
+    WGPUBindGroupLayout layouts[] = { bindGroupLayout };
+    wgpu::PipelineLayoutDescriptor layoutDesc(wgpu::Default);
+    layoutDesc.bindGroupLayoutCount = 1;
+    layoutDesc.bindGroupLayouts = layouts;
+    return device.createPipelineLayout(layoutDesc);
+}
+
+void GpuCulling::initialize(wgpu::Device &device) {
+    initialized = true;
+
+    // Culled batches are drawn with an indirect firstInstance, which points in the region of their view
+    if (!device.hasFeature(wgpu::FeatureName::IndirectFirstInstance)) {
+        ES::Utils::Log::Info("GpuCulling: IndirectFirstInstance is not supported, meshes are drawn without culling.");
+        return;
+    }
+
+    wgpu::ShaderModule shaderModule = LoadShaderModule(device, "./assets/shader/shaderCulling.wgsl", "Shader source Culling");
+    bindGroupLayout = CreateBindGroupLayout<7>(device, {
+        wgpu::BufferBindingType::ReadOnlyStorage, // Objects
+        wgpu::BufferBindingType::ReadOnlyStorage, // GBuffer uniforms
+        wgpu::BufferBindingType::ReadOnlyStorage, // Views
+        wgpu::BufferBindingType::Storage, // Draw arguments
+        wgpu::BufferBindingType::Uniform, // Params
+        wgpu::BufferBindingType::ReadOnlyStorage, // Batches
+        wgpu::BufferBindingType::Storage, // GBuffer instances
+    }, "Culling Bind Group Layout");
+    wgpu::PipelineLayout layout = CreatePipelineLayout(device, bindGroupLayout);
+    resetPipeline = CreatePipeline(device, layout, shaderModule, "cs_reset", "Culling Reset Pipeline");
+    pipeline = CreatePipeline(device, layout, shaderModule, "cs_main", "Culling Pipeline");
+    layout.release();
+    shaderModule.release();
+
+    wgpu::ShaderModule meshletModule = LoadShaderModule(device, "./assets/shader/shaderMeshletCulling.wgsl", "Shader source Meshlet Culling");
+    meshletBindGroupLayout = CreateBindGroupLayout<8>(device, {
+        wgpu::BufferBindingType::ReadOnlyStorage, // GBuffer uniforms
+        wgpu::BufferBindingType::ReadOnlyStorage, // Views
+        wgpu::BufferBindingType::Storage, // Draw arguments
+        wgpu::BufferBindingType::Uniform, // Params
+        wgpu::BufferBindingType::ReadOnlyStorage, // Batches
+        wgpu::BufferBindingType::ReadOnlyStorage, // Meshlets
+        wgpu::BufferBindingType::ReadOnlyStorage, // GeometryPool indices
+        wgpu::BufferBindingType::Storage, // Cluster indices
+    }, "Meshlet Culling Bind Group Layout");
+    wgpu::PipelineLayout meshletLayout = CreatePipelineLayout(device, meshletBindGroupLayout);
+    meshletPipeline = CreatePipeline(device, meshletLayout, meshletModule, "cs_main", "Meshlet Culling Pipeline");
+    meshletLayout.release();
+    meshletModule.release();
+
+    if (resetPipeline == nullptr || pipeline == nullptr || meshletPipeline == nullptr) throw std::runtime_error("GpuCulling: Could not create compute pipelines.");
+
+    paramsBuffer = CreateBuffer(device, "GpuCulling::ParamsBuffer", sizeof(Params), wgpu::BufferUsage::Uniform);
+}
+
+void GpuCulling::reserve(wgpu::Device &device, uint32_t objectsNeeded, uint32_t batchesNeeded, uint32_t viewsNeeded) {
+    if (objectsNeeded > objectCapacity) {
+        objectCapacity = std::max({ objectsNeeded, objectCapacity * 2, 1024u });
+        if (objectsBuffer) objectsBuffer.release();
+        objectsBuffer = CreateBuffer(device, "GpuCulling::ObjectsBuffer", uint64_t(objectCapacity) * sizeof(ObjectData), wgpu::BufferUsage::Storage);
+        objects.clear(); // Uploaded again
+        if (bindGroup) bindGroup.release();
+        bindGroup = nullptr;
+    }
+
+    if (batchesNeeded <= batchCapacity && viewsNeeded <= viewCapacity) return;
+
+    if (batchesNeeded > batchCapacity) {
+        batchCapacity = std::max({ batchesNeeded, batchCapacity * 2, 256u });
+        if (batchesBuffer) batchesBuffer.release();
+        batchesBuffer = CreateBuffer(device, "GpuCulling::BatchesBuffer", uint64_t(batchCapacity) * sizeof(BatchData), wgpu::BufferUsage::Storage);
+        batches.clear();
+    }
+    if (viewsNeeded > viewCapacity) {
+        viewCapacity = std::max({ viewsNeeded, viewCapacity * 2, 8u });
+        if (viewsBuffer) viewsBuffer.release();
+        viewsBuffer = CreateBuffer(device, "GpuCulling::ViewsBuffer", uint64_t(viewCapacity) * sizeof(ViewData), wgpu::BufferUsage::Storage);
+    }
+
+    // Offsets of the arguments depend on the batch capacity, recorded draws see the new buffer and are recorded again
+    uint64_t drawArgsSize = uint64_t(batchCapacity) * viewCapacity * sizeof(DrawIndexedIndirectArgs);
+    wgpu::Limits limits(wgpu::Default);
+    device.getLimits(&limits);
+    if (drawArgsSize > limits.maxStorageBufferBindingSize) {
+        throw std::runtime_error(fmt::format("GpuCulling: {} batches in {} views need {} bytes of draw arguments, the device allows {}.",
+            batchCapacity, viewCapacity, drawArgsSize, limits.maxStorageBufferBindingSize));
+    }
+    if (drawArgsBuffer) {
+        drawArgsBuffer.destroy();
+        drawArgsBuffer.release();
+    }
+    drawArgsBuffer = CreateBuffer(device, "GpuCulling::DrawArgsBuffer", drawArgsSize, wgpu::BufferUsage::Storage | wgpu::BufferUsage::Indirect);
+    generation++;
+
+    if (bindGroup) bindGroup.release();
+    bindGroup = nullptr;
+    if (meshletBindGroup) meshletBindGroup.release();
+    meshletBindGroup = nullptr;
+}
+
+void GpuCulling::reserveMeshlets(wgpu::Device &device, uint32_t meshletsNeeded, uint32_t clusterIndicesNeeded) {
+    if (meshletsNeeded > meshletCapacity) {
+        meshletCapacity = std::max({ meshletsNeeded, meshletCapacity * 2, 1024u });
+        if (meshletsBuffer) meshletsBuffer.release();
+        meshletsBuffer = CreateBuffer(device, "GpuCulling::MeshletsBuffer", uint64_t(meshletCapacity) * sizeof(MeshletData), wgpu::BufferUsage::Storage);
+        meshlets.clear();
+        if (meshletBindGroup) meshletBindGroup.release();
+        meshletBindGroup = nullptr;
+    }
+
+    // One region per view
+    uint64_t indicesNeeded = uint64_t(clusterIndicesNeeded) * viewCapacity;
+    if (indicesNeeded <= clusterIndexCapacity) return;
+
+    clusterIndexCapacity = std::max({ indicesNeeded, clusterIndexCapacity * 2, uint64_t(1) << 16 });
+    wgpu::Limits limits(wgpu::Default);
+    device.getLimits(&limits);
+    if (clusterIndexCapacity * sizeof(uint32_t) > limits.maxStorageBufferBindingSize) {
+        throw std::runtime_error(fmt::format("GpuCulling: {} cluster indices need {} bytes, the device allows {}.",
+            clusterIndexCapacity, clusterIndexCapacity * sizeof(uint32_t), limits.maxStorageBufferBindingSize));
+    }
+    if (clusterIndicesBuffer) {
+        clusterIndicesBuffer.destroy();
+        clusterIndicesBuffer.release();
+    }
+    clusterIndicesBuffer = CreateBuffer(device, "GpuCulling::ClusterIndicesBuffer", clusterIndexCapacity * sizeof(uint32_t), wgpu::BufferUsage::Storage | wgpu::BufferUsage::Index);
+    generation++;
+    if (meshletBindGroup) meshletBindGroup.release();
+    meshletBindGroup = nullptr;
+}
+
+void GpuCulling::createBindGroup(wgpu::Device &device) {
+    bindGroup = CreateBindGroup<7>(device, bindGroupLayout, { objectsBuffer, uniformsBuffer, viewsBuffer, drawArgsBuffer, paramsBuffer, batchesBuffer, instancesBuffer }, "Culling Bind Group");
+    boundUniformsBuffer = uniformsBuffer;
+    boundInstancesBuffer = instancesBuffer;
+}
+
+void GpuCulling::createMeshletBindGroup(wgpu::Device &device, wgpu::Buffer geometryIndices) {
+    wgpu::Limits limits(wgpu::Default);
+    device.getLimits(&limits);
+    if (geometryIndices.getSize() > limits.maxStorageBufferBindingSize) {
+        throw std::runtime_error(fmt::format("GpuCulling: The meshlets read {} bytes of indices, the device allows {}.", geometryIndices.getSize(), limits.maxStorageBufferBindingSize));
+    }
+
+    meshletBindGroup = CreateBindGroup<8>(device, meshletBindGroupLayout, { uniformsBuffer, viewsBuffer, drawArgsBuffer, paramsBuffer, batchesBuffer, meshletsBuffer, geometryIndices, clusterIndicesBuffer }, "Meshlet Culling Bind Group");
+    meshletBoundUniformsBuffer = uniformsBuffer;
+    boundGeometryIndices = geometryIndices;
+}
+
+void GpuCulling::BindClusterIndices(RenderEncoder &encoder) const {
+    encoder.setIndexBuffer(clusterIndicesBuffer, wgpu::IndexFormat::Uint32, 0, clusterIndicesBuffer.getSize());
+}
+
+void GpuCulling::Update(ES::Engine::Core &core) {
+    ES_PROFILE_ZONE(core, "GpuCulling::Update");
+
+    uint32_t previousViewCount = viewCount;
+    update(core);
+    if (viewCount != previousViewCount) generation++;
+}
+
+void GpuCulling::update(ES::Engine::Core &core) {
+    viewCount = 0;
+    if (!enabled) return;
+
+    auto &device = core.GetResource<wgpu::Device>();
+    if (!initialized) initialize(device);
+    if (pipeline == nullptr || uniformsBuffer == nullptr || instancesBuffer == nullptr) return;
+
+    // Objects are the instances of the batches, in the same order
+    const auto &instances = core.GetResource<InstanceBatches>();
+    const auto &instanceBatches = instances.GetBatches();
+    batchCount = static_cast<uint32_t>(instanceBatches.size());
+    objectCount = batchCount > 0 ? instanceBatches.back().firstInstance + instanceBatches.back().instanceCount : 0;
+
+    auto &registry = core.GetRegistry();
+    scratchBatches.resize(batchCount);
+    scratchObjects.resize(objectCount);
+    scratchMeshlets.clear();
+    uint32_t clusterIndexCount = 0;
+    for (uint32_t i = 0; i < batchCount; i++) {
+        const auto &batch = instanceBatches[i];
+        bool valid = batch.geometry.IsValid();
+        BatchData &data = scratchBatches[i];
+        data = {
+            .indexCount = valid ? batch.indexCount : 0,
+            .firstIndex = valid ? batch.firstIndex : 0,
+            .baseVertex = valid ? static_cast<int32_t>(batch.geometry.vertexOffset) : 0,
+            .firstInstance = batch.firstInstance,
+            .shadowIndexCount = valid ? batch.shadowIndexCount : 0,
+            .shadowFirstIndex = valid ? batch.shadowFirstIndex : 0,
+            .meshletCount = 0,
+            .shadowMeshletCount = 0,
+            .clusterFirstIndex = 0,
+            .transformIndex = instances.GetInstanceSlots()[batch.firstInstance],
+            ._padding = { 0, 0 },
+        };
+        for (uint32_t instance = batch.firstInstance; instance < batch.firstInstance + batch.instanceCount; instance++) {
+            const auto &mesh = registry.get<ES::Plugin::WebGPU::Component::Mesh>(instances.GetInstanceEntity(instance));
+
+            // The model matrix starts from the positions of the vertex buffer, packed ones fill the unit box
+            bool packed = mesh.geometry.format == GeometryPool::VertexFormat::Packed;
+            glm::vec3 boundsMin = packed ? glm::vec3(0.0f) : mesh.boundsMin;
+            glm::vec3 boundsMax = packed ? glm::vec3(1.0f) : mesh.boundsMax;
+
+            scratchObjects[instance] = {
+                .boundsCenter = glm::vec4((boundsMin + boundsMax) * 0.5f, 0.0f),
+                .boundsExtent = glm::vec4((boundsMax - boundsMin) * 0.5f, 0.0f),
+                .transformIndex = mesh.transformIndex,
+                .batch = i,
+                ._padding = { 0, 0 },
+            };
+        }
+
+        // Batches of meshes with meshlets have a single instance, their meshlets only cover the full detail
+        if (!valid || batch.geometry.indexFormat != GeometryPool::IndexFormat::Uint32) continue;
+        const auto &mesh = registry.get<ES::Plugin::WebGPU::Component::Mesh>(batch.entity);
+        bool cameraClustered = batch.firstIndex == batch.geometry.firstIndex;
+        bool shadowClustered = batch.shadowFirstIndex == batch.geometry.firstIndex;
+        if (mesh.meshlets.empty() || (!cameraClustered && !shadowClustered)) continue;
+
+        data.meshletCount = cameraClustered ? static_cast<uint32_t>(mesh.meshlets.size()) : 0;
+        data.shadowMeshletCount = shadowClustered ? static_cast<uint32_t>(mesh.meshlets.size()) : 0;
+        data.clusterFirstIndex = clusterIndexCount;
+        clusterIndexCount += batch.geometry.indexCount;
+        for (const auto &meshlet : mesh.meshlets) {
+            scratchMeshlets.push_back({
+                .sphere = glm::vec4(meshlet.center, meshlet.radius),
+                .cone = glm::vec4(meshlet.coneAxis, meshlet.coneCutoff),
+                .firstIndex = batch.geometry.firstIndex + meshlet.firstIndex,
+                .indexCount = meshlet.indexCount,
+                .batch = i,
+                ._padding = 0,
+            });
+        }
+    }
+    meshletCount = static_cast<uint32_t>(scratchMeshlets.size());
+
+    views.clear();
+    views.push_back({});
+    std::array<glm::vec4, 6> planes = ExtractFrustumPlanes(cameraViewProjection);
+    std::copy(planes.begin(), planes.end(), views.back().planes);
+    for (const auto &light : additionalDirectionalLights) {
+        views.push_back({});
+        planes = ExtractFrustumPlanes(light.lightViewProj);
+        std::copy(planes.begin(), planes.end(), views.back().planes);
+    }
+
+    reserve(device, std::max(objectCount, 1u), std::max(batchCount, 1u), static_cast<uint32_t>(views.size()));
+    if (bindGroup == nullptr || boundUniformsBuffer != uniformsBuffer || boundInstancesBuffer != instancesBuffer) {
+        if (bindGroup) bindGroup.release();
+        createBindGroup(device);
+    }
+    if (meshletCount > 0) reserveMeshlets(device, meshletCount, clusterIndexCount);
+    wgpu::Buffer geometryIndices = core.GetResource<GeometryPool>().GetIndexBuffer(GeometryPool::IndexFormat::Uint32);
+    if (meshletCount > 0 && (meshletBindGroup == nullptr || meshletBoundUniformsBuffer != uniformsBuffer || boundGeometryIndices != geometryIndices)) {
+        if (meshletBindGroup) meshletBindGroup.release();
+        createMeshletBindGroup(device, geometryIndices);
+    }
+
+    auto &queue = core.GetResource<wgpu::Queue>();
+    auto &stats = core.GetResource<FrameStats>();
+
+    if (scratchObjects.size() != objects.size() || std::memcmp(scratchObjects.data(), objects.data(), objects.size() * sizeof(ObjectData)) != 0) {
+        if (objectCount > 0) queue.writeBuffer(objectsBuffer, 0, scratchObjects.data(), scratchObjects.size() * sizeof(ObjectData));
+        stats.RecordUpload(scratchObjects.size() * sizeof(ObjectData));
+        objects.swap(scratchObjects);
+    }
+    if (scratchBatches.size() != batches.size() || std::memcmp(scratchBatches.data(), batches.data(), batches.size() * sizeof(BatchData)) != 0) {
+        if (batchCount > 0) queue.writeBuffer(batchesBuffer, 0, scratchBatches.data(), scratchBatches.size() * sizeof(BatchData));
+        stats.RecordUpload(scratchBatches.size() * sizeof(BatchData));
+        batches.swap(scratchBatches);
+        generation++; // Batches may have switched between clustered and not
+    }
+    if (scratchMeshlets.size() != meshlets.size() || std::memcmp(scratchMeshlets.data(), meshlets.data(), meshlets.size() * sizeof(MeshletData)) != 0) {
+        if (meshletCount > 0) queue.writeBuffer(meshletsBuffer, 0, scratchMeshlets.data(), scratchMeshlets.size() * sizeof(MeshletData));
+        stats.RecordUpload(scratchMeshlets.size() * sizeof(MeshletData));
+        meshlets.swap(scratchMeshlets);
+    }
+
+    queue.writeBuffer(viewsBuffer, 0, views.data(), views.size() * sizeof(ViewData));
+    // Regions of the instances buffer have the size UpdateBufferUniforms gave them, region 0 is not culled
+    Params params = {
+        .objectCount = objectCount,
+        .batchCount = batchCount,
+        .batchCapacity = batchCapacity,
+        .viewCount = static_cast<uint32_t>(views.size()),
+        .instanceStride = std::max(objectCount, 1u),
+        .meshletCount = meshletCount,
+        .clusterIndexStride = clusterIndexCount,
+        ._padding = 0,
+        .cameraPosition = glm::vec4(cameraPosition, 1.0f),
+    };
+    queue.writeBuffer(paramsBuffer, 0, &params, sizeof(Params));
+    stats.RecordUpload(views.size() * sizeof(ViewData) + sizeof(Params));
+
+    viewCount = static_cast<uint32_t>(views.size());
+    if (objectCount == 0) return;
+
+    // Submitted on its own, before the render graph, so the arguments are written when the passes read them. Each
+    // dispatch sees the writes of the previous one.
+    wgpu::CommandEncoder encoder = device.createCommandEncoder();
+    wgpu::ComputePassEncoder computePass = encoder.beginComputePass();
+    computePass.setBindGroup(0, bindGroup, 0, nullptr);
+    computePass.setPipeline(resetPipeline);
+    computePass.dispatchWorkgroups((batchCount + WorkgroupSize - 1) / WorkgroupSize, viewCount, 1);
+    computePass.setPipeline(pipeline);
+    computePass.dispatchWorkgroups((objectCount + WorkgroupSize - 1) / WorkgroupSize, viewCount, 1);
+    if (meshletCount > 0) {
+        computePass.setBindGroup(0, meshletBindGroup, 0, nullptr);
+        computePass.setPipeline(meshletPipeline);
+        computePass.dispatchWorkgroups((meshletCount + WorkgroupSize - 1) / WorkgroupSize, viewCount, 1);
+    }
+    computePass.end();
+    computePass.release();
+    wgpu::CommandBuffer commandBuffer = encoder.finish();
+    encoder.release();
+    queue.submit(1, &commandBuffer);
+    commandBuffer.release();
+}
+
+void GpuCulling::Release() {
+    if (bindGroup) bindGroup.release();
+    if (bindGroupLayout) bindGroupLayout.release();
+    if (resetPipeline) resetPipeline.release();
+    if (pipeline) pipeline.release();
+    if (meshletBindGroup) meshletBindGroup.release();
+    if (meshletBindGroupLayout) meshletBindGroupLayout.release();
+    if (meshletPipeline) meshletPipeline.release();
+    for (wgpu::Buffer *buffer : { &objectsBuffer, &batchesBuffer, &viewsBuffer, &paramsBuffer, &drawArgsBuffer, &meshletsBuffer, &clusterIndicesBuffer }) {
+        if (*buffer == nullptr) continue;
+        buffer->destroy();
+        buffer->release();
+        *buffer = nullptr;
+    }
+    bindGroup = nullptr;
+    bindGroupLayout = nullptr;
+    resetPipeline = nullptr;
+    pipeline = nullptr;
+    meshletBindGroup = nullptr;
+    meshletBindGroupLayout = nullptr;
+    meshletPipeline = nullptr;
+    boundUniformsBuffer = nullptr;
+    boundInstancesBuffer = nullptr;
+    meshletBoundUniformsBuffer = nullptr;
+    boundGeometryIndices = nullptr;
+    objectCapacity = 0;
+    batchCapacity = 0;
+    viewCapacity = 0;
+    meshletCapacity = 0;
+    clusterIndexCapacity = 0;
+    objectCount = 0;
+    batchCount = 0;
+    viewCount = 0;
+    meshletCount = 0;
+    objects.clear();
+    batches.clear();
+    meshlets.clear();
+    initialized = false;
+}
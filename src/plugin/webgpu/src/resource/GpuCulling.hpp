@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vector>
+
+#include "webgpu.hpp"
+#include "RenderEncoder.hpp"
+#include "core/Core.hpp"
+#include <glm/glm.hpp>
+
+// Frustum culling on the GPU. Every frame a compute pass tests the bounds of the 3D meshes against each view (the camera,
+// then one view per shadow casting light). Visible instances of each InstanceBatches batch are compacted into the region
+// of the view in the instances buffer, and the batch gets DrawIndexedIndirect arguments drawing just them. Passes draw
+// with fixed offsets in these arguments, so their commands, and their render bundles, stay the same while objects move
+// in and out of the views.
+// Objects are the instances of InstanceBatches, each one reads the uniforms slot of its mesh.
+// Meshes with meshlets are culled cluster by cluster instead, in the views drawing their full detail: the frustum test
+// and, for the camera, a backface cone test. The triangles of the visible meshlets are compacted into the cluster
+// indices (one region per view), which the batch then draws with indirect arguments. Their indices already include
+// the baseVertex.
+class GpuCulling {
+    public:
+        static constexpr uint32_t WorkgroupSize = 64; // Has to match shaderCulling.wgsl and shaderMeshletCulling.wgsl
+        static constexpr uint32_t CameraView = 0;
+        static constexpr uint32_t FirstLightView = 1; // Followed by one view per additional directional light
+
+        struct DrawIndexedIndirectArgs {
+            uint32_t indexCount;
+            uint32_t instanceCount;
+            uint32_t firstIndex;
+            int32_t baseVertex;
+            uint32_t firstInstance;
+        };
+        static_assert(sizeof(DrawIndexedIndirectArgs) == 5 * sizeof(uint32_t), "Layout of the indirect draw arguments of WebGPU");
+
+        explicit GpuCulling(bool enabled = true) : enabled(enabled) {}
+        GpuCulling(GpuCulling &&) = default;
+        GpuCulling &operator=(GpuCulling &&) = default;
+        GpuCulling(const GpuCulling &) = delete;
+        GpuCulling &operator=(const GpuCulling &) = delete;
+
+        void SetEnabled(bool value) { enabled = value; }
+        bool IsEnabled() const { return enabled; }
+
+        // Needs the IndirectFirstInstance feature, the firstInstance of a batch points in the region of its view
+        bool IsSupported() const { return pipeline != nullptr; }
+
+        void SetCamera(const glm::mat4 &viewProjection, const glm::vec3 &position) {
+            cameraViewProjection = viewProjection;
+            cameraPosition = position;
+        }
+
+        // Gather the objects and views of this frame and submit the culling pass, before the render graph is executed
+        void Update(ES::Engine::Core &core);
+
+        // True when the arguments of this view were written this frame, passes draw directly otherwise
+        bool HasView(uint32_t view) const { return view < viewCount; }
+
+        wgpu::Buffer GetDrawArgsBuffer() const { return drawArgsBuffer; }
+        uint64_t GetDrawArgsOffset(uint32_t view, uint32_t batch) const {
+            return (uint64_t(view) * batchCapacity + batch) * sizeof(DrawIndexedIndirectArgs);
+        }
+        // The indirect draw of this batch reads the cluster indices, which have to be bound instead of the pool ones
+        bool IsClustered(uint32_t view, uint32_t batch) const {
+            if (!HasView(view) || batch >= batches.size()) return false;
+            return (view == CameraView ? batches[batch].meshletCount : batches[batch].shadowMeshletCount) > 0;
+        }
+        void BindClusterIndices(RenderEncoder &encoder) const;
+
+        // Changes with what the passes record from it: views, clustered batches and buffers holding the arguments
+        uint64_t GetGeneration() const { return generation; }
+
+        void Release();
+
+    private:
+        struct ObjectData {
+            glm::vec4 boundsCenter; // Local space
+            glm::vec4 boundsExtent;
+            uint32_t transformIndex;
+            uint32_t batch;
+            uint32_t _padding[2];
+        };
+        static_assert(sizeof(ObjectData) == 48, "ObjectData must match the Object struct of shaderCulling.wgsl");
+
+        struct BatchData {
+            uint32_t indexCount;
+            uint32_t firstIndex;
+            int32_t baseVertex;
+            uint32_t firstInstance;
+            uint32_t shadowIndexCount; // LOD drawn by the light views
+            uint32_t shadowFirstIndex;
+            // Meshlets culled for the camera and the light views, 0 when they draw a LOD or the mesh has none
+            uint32_t meshletCount;
+            uint32_t shadowMeshletCount;
+            uint32_t clusterFirstIndex; // Of the batch in each region of the cluster indices
+            uint32_t transformIndex; // Uniforms slot of the first instance, the only one of a batch with meshlets
+            uint32_t _padding[2];
+        };
+        static_assert(sizeof(BatchData) == 48, "BatchData must match the Batch struct of shaderCulling.wgsl");
+
+        struct MeshletData {
+            glm::vec4 sphere; // Center in the space of the vertex buffer, radius in local space
+            glm::vec4 cone; // Local space axis and cutoff, see Util::Meshlet
+            uint32_t firstIndex; // In the 32 bits index buffer of the GeometryPool
+            uint32_t indexCount;
+            uint32_t batch;
+            uint32_t _padding;
+        };
+        static_assert(sizeof(MeshletData) == 48, "MeshletData must match the Meshlet struct of shaderMeshletCulling.wgsl");
+
+        struct ViewData {
+            glm::vec4 planes[6]; // Inside when dot(plane.xyz, p) + plane.w >= 0
+        };
+
+        struct Params {
+            uint32_t objectCount;
+            uint32_t batchCount;
+            uint32_t batchCapacity;
+            uint32_t viewCount;
+            uint32_t instanceStride; // Size of a region of the instances buffer
+            uint32_t meshletCount;
+            uint32_t clusterIndexStride; // Size of a region of the cluster indices
+            uint32_t _padding;
+            glm::vec4 cameraPosition;
+        };
+
+        void update(ES::Engine::Core &core);
+        void initialize(wgpu::Device &device);
+        void reserve(wgpu::Device &device, uint32_t objects, uint32_t batches, uint32_t views);
+        void reserveMeshlets(wgpu::Device &device, uint32_t meshlets, uint32_t clusterIndices);
+        void createBindGroup(wgpu::Device &device);
+        void createMeshletBindGroup(wgpu::Device &device, wgpu::Buffer geometryIndices);
+
+        bool enabled = true;
+        bool initialized = false;
+        glm::mat4 cameraViewProjection = glm::mat4(1.0f);
+        glm::vec3 cameraPosition = glm::vec3(0.0f);
+
+        wgpu::ComputePipeline resetPipeline = nullptr; // Writes the arguments of every batch with no instance
+        wgpu::ComputePipeline pipeline = nullptr;
+        wgpu::BindGroupLayout bindGroupLayout = nullptr;
+        wgpu::BindGroup bindGroup = nullptr;
+        // GBuffer buffers the bind group was created with
+        wgpu::Buffer boundUniformsBuffer = nullptr;
+        wgpu::Buffer boundInstancesBuffer = nullptr;
+
+        wgpu::ComputePipeline meshletPipeline = nullptr; // Separate bind group, a single one would need 9 storage buffers
+        wgpu::BindGroupLayout meshletBindGroupLayout = nullptr;
+        wgpu::BindGroup meshletBindGroup = nullptr;
+        // Buffers the meshlet bind group was created with
+        wgpu::Buffer meshletBoundUniformsBuffer = nullptr;
+        wgpu::Buffer boundGeometryIndices = nullptr;
+
+        wgpu::Buffer objectsBuffer = nullptr;
+        wgpu::Buffer batchesBuffer = nullptr;
+        wgpu::Buffer viewsBuffer = nullptr;
+        wgpu::Buffer paramsBuffer = nullptr;
+        wgpu::Buffer drawArgsBuffer = nullptr;
+        wgpu::Buffer meshletsBuffer = nullptr;
+        wgpu::Buffer clusterIndicesBuffer = nullptr;
+        uint32_t objectCapacity = 0;
+        uint32_t batchCapacity = 0;
+        uint32_t viewCapacity = 0;
+        uint32_t meshletCapacity = 0;
+        uint64_t clusterIndexCapacity = 0;
+
+        uint32_t objectCount = 0;
+        uint32_t batchCount = 0;
+        uint32_t viewCount = 0; // 0 when the culling did not run this frame
+        uint64_t generation = 0;
+        uint32_t meshletCount = 0;
+        // Last uploaded, they are only uploaded again when they change
+        std::vector<ObjectData> objects;
+        std::vector<BatchData> batches;
+        std::vector<MeshletData> meshlets;
+        std::vector<ObjectData> scratchObjects;
+        std::vector<BatchData> scratchBatches;
+        std::vector<MeshletData> scratchMeshlets;
+        std::vector<ViewData> views;
+};
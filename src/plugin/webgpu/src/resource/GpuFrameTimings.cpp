@@ -0,0 +1,34 @@
+#include "GpuFrameTimings.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <fmt/format.h>
+
+static std::string EscapeJSON(const std::string &value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (char c : value) {
+        if (c == '"' || c == '\\') escaped.push_back('\\');
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+std::string GpuFrameTimings::ToJSON() const {
+    const char *sourceName = source == Source::GpuTimestamps ? "gpu_timestamps" : source == Source::CpuEncode ? "cpu_encode" : "none";
+
+    std::string json = fmt::format("{{\"source\":\"{}\",\"frame\":{},\"total_ms\":{},\"dropped_frames\":{},\"passes\":[",
+        sourceName, frameIndex, totalMilliseconds, droppedFrames);
+    for (size_t i = 0; i < passes.size(); i++) {
+        if (i > 0) json += ",";
+        json += fmt::format("{{\"name\":\"{}\",\"iteration\":{},\"ms\":{}}}", EscapeJSON(passes[i].name), passes[i].iteration, passes[i].milliseconds);
+    }
+    json += "]}";
+    return json;
+}
+
+void GpuFrameTimings::DumpJSON(const std::filesystem::path &path) const {
+    std::ofstream file(path);
+    if (!file) throw std::runtime_error(fmt::format("GpuFrameTimings: Could not open {} for writing.", path.string()));
+    file << ToJSON() << '\n';
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+struct GpuPassTiming {
+    std::string name;
+    uint32_t iteration = 0; // Index of the pass in a MultipleRenderPassData
+    double milliseconds = 0.0;
+};
+
+// Last measured split of the frame between the render graph passes. Results are a few frames late, they are read back
+// without waiting for the GPU.
+struct GpuFrameTimings {
+    enum class Source {
+        None,
+        GpuTimestamps,
+        CpuEncode, // The adapter has no timestamp queries, only the time spent recording each pass is measured
+    };
+
+    static constexpr size_t HistorySize = 240;
+
+    Source source = Source::None;
+    uint64_t frameIndex = 0; // Frame the passes were measured on
+    std::vector<GpuPassTiming> passes;
+    double totalMilliseconds = 0.0;
+    uint64_t droppedFrames = 0; // Frames not measured because every readback buffer was still in use
+
+    std::array<float, HistorySize> totalHistory = {}; // Ring of totalMilliseconds, historyOffset is the oldest entry
+    size_t historyOffset = 0;
+
+    void PushTotal() {
+        totalHistory[historyOffset] = static_cast<float>(totalMilliseconds);
+        historyOffset = (historyOffset + 1) % HistorySize;
+    }
+
+    std::string ToJSON() const;
+    void DumpJSON(const std::filesystem::path &path) const;
+};
@@ -0,0 +1,187 @@
+#include "GpuProfiler.hpp"
+
+#include "core/Core.hpp"
+#include <algorithm>
+#include <fmt/format.h>
+
+void GpuProfiler::Initialize(wgpu::Device &device, uint32_t frameCount) {
+    initialized = true;
+    slots = std::vector<FrameSlot>(std::max(frameCount, 1u));
+
+    if (!device.hasFeature(wgpu::FeatureName::TimestampQuery)) {
+        ES::Utils::Log::Info("GpuProfiler: Timestamp queries are not supported, falling back to CPU encode timings.");
+        return;
+    }
+
+    constexpr uint32_t queriesPerFrame = MaxPassesPerFrame * 2;
+
+    wgpu::QuerySetDescriptor querySetDesc(wgpu::Default);
+    querySetDesc.label = wgpu::StringView("GpuProfiler::QuerySet");
+    querySetDesc.type = wgpu::QueryType::Timestamp;
+    querySetDesc.count = queriesPerFrame * static_cast<uint32_t>(slots.size());
+    querySet = device.createQuerySet(querySetDesc);
+    if (querySet == nullptr) throw std::runtime_error("GpuProfiler: Could not create timestamp query set.");
+
+    wgpu::BufferDescriptor bufferDesc(wgpu::Default);
+    bufferDesc.label = wgpu::StringView("GpuProfiler::ResolveBuffer");
+    bufferDesc.size = sizeof(uint64_t) * queriesPerFrame * slots.size();
+    bufferDesc.usage = wgpu::BufferUsage::QueryResolve | wgpu::BufferUsage::CopySrc;
+    resolveBuffer = device.createBuffer(bufferDesc);
+
+    for (size_t i = 0; i < slots.size(); i++) {
+        std::string label = fmt::format("GpuProfiler::ReadbackBuffer::{}", i);
+        bufferDesc.label = wgpu::StringView(label);
+        bufferDesc.size = sizeof(uint64_t) * queriesPerFrame;
+        bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead;
+        slots[i].readbackBuffer = device.createBuffer(bufferDesc);
+    }
+}
+
+void GpuProfiler::Release() {
+    for (auto &slot : slots) {
+        if (slot.readbackBuffer == nullptr) continue;
+        if (slot.state == SlotState::Ready) slot.readbackBuffer.unmap();
+        slot.readbackBuffer.release();
+        slot.readbackBuffer = nullptr;
+        slot.state = SlotState::Free;
+    }
+    if (resolveBuffer) resolveBuffer.release();
+    if (querySet) querySet.release();
+    resolveBuffer = nullptr;
+    querySet = nullptr;
+    initialized = false;
+}
+
+void GpuProfiler::publish(FrameSlot &slot, GpuFrameTimings &timings, GpuFrameTimings::Source source) {
+    timings.source = source;
+    timings.frameIndex = slot.frameIndex;
+    timings.passes.resize(slot.passCount);
+    timings.totalMilliseconds = 0.0;
+
+    const uint64_t *timestamps = nullptr;
+    if (source == GpuFrameTimings::Source::GpuTimestamps) {
+        timestamps = static_cast<const uint64_t *>(slot.readbackBuffer.getConstMappedRange(0, sizeof(uint64_t) * 2 * slot.passCount));
+    }
+
+    for (uint32_t i = 0; i < slot.passCount; i++) {
+        GpuPassTiming &timing = timings.passes[i];
+        timing.name = slot.passes[i].name;
+        timing.iteration = slot.passes[i].iteration;
+        if (timestamps != nullptr) {
+            // Timestamps are in nanoseconds, the end may come before the beginning if the GPU reset its counter
+            uint64_t begin = timestamps[i * 2];
+            uint64_t end = timestamps[i * 2 + 1];
+            timing.milliseconds = end > begin ? static_cast<double>(end - begin) / 1e6 : 0.0;
+        } else {
+            timing.milliseconds = slot.passes[i].milliseconds;
+        }
+        timings.totalMilliseconds += timing.milliseconds;
+    }
+
+    timings.PushTotal();
+}
+
+void GpuProfiler::BeginFrame(GpuFrameTimings &timings) {
+    nextPass = 0;
+    frameCount++;
+
+    if (!UsesTimestamps()) {
+        currentSlot = &slots[0];
+        currentSlot->frameIndex = frameCount;
+        return;
+    }
+
+    // Only the most recent frame read back is published, older ones are just released
+    FrameSlot *latest = nullptr;
+    for (auto &slot : slots) {
+        if (slot.state != SlotState::Ready) continue;
+        if (latest == nullptr || slot.frameIndex > latest->frameIndex) latest = &slot;
+    }
+    if (latest != nullptr) publish(*latest, timings, GpuFrameTimings::Source::GpuTimestamps);
+    for (auto &slot : slots) {
+        if (slot.state != SlotState::Ready) continue;
+        slot.readbackBuffer.unmap();
+        slot.state = SlotState::Free;
+    }
+
+    currentSlot = &slots[frameCount % slots.size()];
+    if (currentSlot->state != SlotState::Free) {
+        currentSlot = nullptr;
+        timings.droppedFrames++;
+        return;
+    }
+    currentSlot->frameIndex = frameCount;
+}
+
+bool GpuProfiler::WritePassTimestamps(std::string_view name, uint32_t iteration, wgpu::RenderPassTimestampWrites &timestampWrites) {
+    if (!UsesTimestamps() || currentSlot == nullptr) return false;
+
+    uint32_t pass = nextPass++;
+    if (pass >= MaxPassesPerFrame) return false;
+
+    currentSlot->passes[pass].name = name;
+    currentSlot->passes[pass].iteration = iteration;
+
+    uint32_t firstQuery = static_cast<uint32_t>(currentSlot - slots.data()) * MaxPassesPerFrame * 2;
+    timestampWrites.querySet = querySet;
+    timestampWrites.beginningOfPassWriteIndex = firstQuery + pass * 2;
+    timestampWrites.endOfPassWriteIndex = firstQuery + pass * 2 + 1;
+    return true;
+}
+
+void GpuProfiler::RecordCpuPass(std::string_view name, uint32_t iteration, std::chrono::steady_clock::duration duration) {
+    if (UsesTimestamps() || currentSlot == nullptr) return;
+
+    uint32_t pass = nextPass++;
+    if (pass >= MaxPassesPerFrame) return;
+
+    currentSlot->passes[pass].name = name;
+    currentSlot->passes[pass].iteration = iteration;
+    currentSlot->passes[pass].milliseconds = std::chrono::duration<double, std::milli>(duration).count();
+}
+
+wgpu::CommandBuffer GpuProfiler::Resolve(wgpu::Device &device) {
+    if (!UsesTimestamps() || currentSlot == nullptr) return nullptr;
+
+    currentSlot->passCount = std::min(nextPass.load(), MaxPassesPerFrame);
+    if (currentSlot->passCount == 0) return nullptr;
+
+    uint32_t firstQuery = static_cast<uint32_t>(currentSlot - slots.data()) * MaxPassesPerFrame * 2;
+    uint32_t queryCount = currentSlot->passCount * 2;
+
+    wgpu::CommandEncoderDescriptor encoderDesc(wgpu::Default);
+    encoderDesc.label = wgpu::StringView("GpuProfiler::CommandEncoder");
+    wgpu::CommandEncoder encoder = device.createCommandEncoder(encoderDesc);
+    encoder.resolveQuerySet(querySet, firstQuery, queryCount, resolveBuffer, sizeof(uint64_t) * firstQuery);
+    encoder.copyBufferToBuffer(resolveBuffer, sizeof(uint64_t) * firstQuery, currentSlot->readbackBuffer, 0, sizeof(uint64_t) * queryCount);
+    wgpu::CommandBuffer commandBuffer = encoder.finish();
+    encoder.release();
+
+    return commandBuffer;
+}
+
+void GpuProfiler::EndFrame(wgpu::Device &device, GpuFrameTimings &timings) {
+    if (currentSlot == nullptr) return;
+
+    if (!UsesTimestamps()) {
+        currentSlot->passCount = std::min(nextPass.load(), MaxPassesPerFrame);
+        publish(*currentSlot, timings, GpuFrameTimings::Source::CpuEncode);
+        return;
+    }
+
+    if (currentSlot->passCount == 0) return;
+
+    currentSlot->state = SlotState::Pending;
+
+    wgpu::BufferMapCallbackInfo callbackInfo(wgpu::Default);
+    callbackInfo.mode = wgpu::CallbackMode::AllowSpontaneous;
+    callbackInfo.callback = [](WGPUMapAsyncStatus status, WGPUStringView message, WGPU_NULLABLE void *userdata1, WGPU_NULLABLE void *userdata2) {
+        auto *slot = static_cast<FrameSlot *>(userdata1);
+        slot->state = status == WGPUMapAsyncStatus_Success ? SlotState::Ready : SlotState::Free;
+    };
+    callbackInfo.userdata1 = currentSlot;
+    currentSlot->readbackBuffer.mapAsync(wgpu::MapMode::Read, 0, sizeof(uint64_t) * 2 * currentSlot->passCount, callbackInfo);
+
+    // Let wgpu fire the callbacks of the buffers the GPU is done with, without waiting for the others
+    device.poll(false, nullptr);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "webgpu.hpp"
+#include "GpuFrameTimings.hpp"
+
+// Measures the passes of the render graph. With the TimestampQuery feature every pass writes begin/end timestamps,
+// resolved into a ring of map-read buffers that are read back frames later without stalling. Without it, the time spent
+// recording each pass is measured on the CPU instead.
+class GpuProfiler {
+    public:
+        static constexpr uint32_t MaxPassesPerFrame = 64;
+
+        GpuProfiler() = default;
+        GpuProfiler(const GpuProfiler &) = delete;
+        GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+        // One readback slot per frame in flight (FramesInFlight::GetCount()), a frame is read back once the GPU is done
+        // with it, before its slot comes around again
+        void Initialize(wgpu::Device &device, uint32_t frameCount);
+        void Release();
+
+        bool IsInitialized() const { return initialized; }
+        bool UsesTimestamps() const { return querySet != nullptr; }
+
+        // Publish the frames read back since the last call and pick the readback slot of this frame
+        void BeginFrame(GpuFrameTimings &timings);
+
+        // Fill the timestamp writes of a pass, returns false when this frame is not measured on the GPU
+        bool WritePassTimestamps(std::string_view name, uint32_t iteration, wgpu::RenderPassTimestampWrites &timestampWrites);
+
+        // CPU fallback, called once the pass is recorded
+        void RecordCpuPass(std::string_view name, uint32_t iteration, std::chrono::steady_clock::duration duration);
+
+        // Resolve this frame's timestamps into its readback buffer, nullptr when there is nothing to resolve
+        wgpu::CommandBuffer Resolve(wgpu::Device &device);
+
+        // After the frame is submitted: start mapping its readback buffer, or publish the CPU timings
+        void EndFrame(wgpu::Device &device, GpuFrameTimings &timings);
+
+    private:
+        enum class SlotState {
+            Free,
+            Pending, // Waiting for the GPU, mapAsync was requested
+            Ready, // Mapped, results can be read
+        };
+
+        struct PassRecord {
+            std::string name;
+            uint32_t iteration = 0;
+            double milliseconds = 0.0; // CPU fallback only
+        };
+
+        struct FrameSlot {
+            wgpu::Buffer readbackBuffer = nullptr;
+            std::atomic<SlotState> state = SlotState::Free;
+            uint32_t passCount = 0;
+            uint64_t frameIndex = 0;
+            std::array<PassRecord, MaxPassesPerFrame> passes;
+        };
+
+        void publish(FrameSlot &slot, GpuFrameTimings &timings, GpuFrameTimings::Source source);
+
+        bool initialized = false;
+        wgpu::QuerySet querySet = nullptr;
+        wgpu::Buffer resolveBuffer = nullptr;
+        std::vector<FrameSlot> slots; // Allocated once by Initialize, the map callbacks keep pointers to them
+        FrameSlot *currentSlot = nullptr; // nullptr when this frame is not measured
+        std::atomic<uint32_t> nextPass = 0; // Passes can be recorded in parallel
+        uint64_t frameCount = 0;
+};
@@ -0,0 +1,66 @@
+#include "InstanceBatches.hpp"
+#include "Mesh.hpp"
+#include "TransformUniforms.hpp"
+#include "component/Transform.hpp"
+
+#include <algorithm>
+
+uint32_t InstanceBatches::Build(ES::Engine::Core &core) {
+    auto &registry = core.GetRegistry();
+
+    entries.clear();
+    registry.view<ES::Plugin::WebGPU::Component::Mesh, ES::Plugin::Object::Component::Transform>().each([&](auto entity, ES::Plugin::WebGPU::Component::Mesh &mesh, ES::Plugin::Object::Component::Transform &) {
+        if (mesh.pipelineType != PipelineType::_3D || !mesh.enabled || mesh.transformIndex == TransformUniforms::InvalidSlot) return;
+        entries.push_back({
+            .indexFormat = mesh.geometry.indexFormat,
+            .geometry = (uint64_t(mesh.geometry.vertexOffset) << 32) | mesh.geometry.firstIndex,
+            .lods = (uint64_t(mesh.lod) << 32) | mesh.shadowLod,
+            .material = mesh.textures.empty() ? 0u : mesh.textures[0].value(),
+            .clustered = !mesh.meshlets.empty(),
+            .entity = entity,
+        });
+    });
+
+    // Ties are broken by entity so the instances do not move from frame to frame
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        if (a.indexFormat != b.indexFormat) return a.indexFormat < b.indexFormat;
+        if (a.geometry != b.geometry) return a.geometry < b.geometry;
+        if (a.lods != b.lods) return a.lods < b.lods;
+        if (a.material != b.material) return a.material < b.material;
+        return entt::to_integral(a.entity) < entt::to_integral(b.entity);
+    });
+
+    previousBatches.swap(batches);
+    batches.clear();
+    previousInstanceSlots.swap(instanceSlots);
+    instanceSlots.resize(entries.size());
+    for (uint32_t instance = 0; instance < entries.size(); instance++) {
+        const Entry &entry = entries[instance];
+        const auto &mesh = registry.get<ES::Plugin::WebGPU::Component::Mesh>(entry.entity);
+        instanceSlots[instance] = mesh.transformIndex;
+
+        const Entry *previous = instance > 0 ? &entries[instance - 1] : nullptr;
+        if (previous && !entry.clustered && previous->geometry == entry.geometry && previous->lods == entry.lods && previous->material == entry.material) {
+            batches.back().instanceCount++;
+            continue;
+        }
+
+        const GeometryPool::Allocation &indices = mesh.GetLODIndices(mesh.lod);
+        const GeometryPool::Allocation &shadowIndices = mesh.GetLODIndices(mesh.shadowLod);
+        batches.push_back({
+            .geometry = mesh.geometry,
+            .entity = entry.entity,
+            .material = entry.material,
+            .firstInstance = instance,
+            .instanceCount = 1,
+            .firstIndex = indices.firstIndex,
+            .indexCount = indices.indexCount,
+            .shadowFirstIndex = shadowIndices.firstIndex,
+            .shadowIndexCount = shadowIndices.indexCount,
+        });
+    }
+
+    instancesChanged = instanceSlots != previousInstanceSlots;
+    batchesChanged = batches != previousBatches;
+    return static_cast<uint32_t>(entries.size());
+}
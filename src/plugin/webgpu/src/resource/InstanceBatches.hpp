@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+
+#include "GeometryPool.hpp"
+#include "core/Core.hpp"
+#include <entt/entt.hpp>
+
+// 3D meshes grouped by geometry, LODs and material (their first texture). Instances are numbered batch by batch, so
+// the instances of a batch are contiguous and a batch is a single instanced draw. Each instance gives the uniforms slot
+// of its mesh (Mesh::transformIndex), which does not move, in region 0 of the instances buffer.
+// Rebuilt every frame by UpdateBufferUniforms.
+class InstanceBatches {
+    public:
+        struct Batch {
+            GeometryPool::Allocation geometry;
+            entt::entity entity; // First instance, given to the per-entity callbacks which bind the material
+            uint32_t material;
+            uint32_t firstInstance;
+            uint32_t instanceCount;
+            // Index ranges of the LODs drawn for the camera and in the shadow maps, with the vertices of geometry
+            uint32_t firstIndex;
+            uint32_t indexCount;
+            uint32_t shadowFirstIndex;
+            uint32_t shadowIndexCount;
+
+            bool operator==(const Batch &) const = default;
+        };
+
+        // Group the enabled 3D meshes, returns the number of instances
+        uint32_t Build(ES::Engine::Core &core);
+
+        const std::vector<Batch> &GetBatches() const { return batches; }
+        // Uniforms slot and entity of each instance
+        const std::vector<uint32_t> &GetInstanceSlots() const { return instanceSlots; }
+        entt::entity GetInstanceEntity(uint32_t instance) const { return entries[instance].entity; }
+        // The instance slots differ from the previous Build
+        bool InstancesChanged() const { return instancesChanged; }
+        // The batches differ from the previous Build, so do the draws recorded from them
+        bool BatchesChanged() const { return batchesChanged; }
+
+    private:
+        struct Entry {
+            GeometryPool::IndexFormat indexFormat; // Sorted first, batches only rebind the index buffer when it changes
+            uint64_t geometry; // vertexOffset and firstIndex
+            uint64_t lods; // lod and shadowLod
+            uint32_t material;
+            bool clustered; // Meshlets are culled per entity, so these meshes are never instanced
+            entt::entity entity;
+        };
+
+        std::vector<Entry> entries; // Sorted, entry i is instance i
+        std::vector<Batch> batches;
+        std::vector<Batch> previousBatches;
+        std::vector<uint32_t> instanceSlots;
+        std::vector<uint32_t> previousInstanceSlots;
+        bool instancesChanged = true;
+        bool batchesChanged = true;
+};
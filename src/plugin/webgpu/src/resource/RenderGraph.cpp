@@ -0,0 +1,771 @@
+#include "RenderGraph.hpp"
+#include "FramesInFlight.hpp"
+
+#include <unordered_map>
+
+const RenderPassData &RenderGraph::getPassData(const Node &node) const {
+    if (node.type == NodeType::MultipleRenderPass) return multipleRenderPasses[node.index].pass;
+    return singleRenderPasses[node.index];
+}
+
+RenderGraph::CompiledPass &RenderGraph::getCompiledPass(const Node &node) {
+    if (node.type == NodeType::MultipleRenderPass) return compiledMultipleRenderPasses[node.index];
+    return compiledRenderPasses[node.index];
+}
+
+bool RenderGraph::hasName(const Node &node, const std::string &name) const {
+    if (node.type == NodeType::MultipleRenderPass) {
+        const auto &multiplePass = multipleRenderPasses[node.index];
+        return multiplePass.name == name || multiplePass.pass.name == name;
+    }
+    return singleRenderPasses[node.index].name == name;
+}
+
+void RenderGraph::Compile() {
+    const size_t nodeCount = nodes.size();
+    std::vector<std::vector<size_t>> successors(nodeCount); // Ordering edges
+    std::vector<std::vector<size_t>> producers(nodeCount); // Edges through which a pass consumes the result of another one
+    std::vector<size_t> inDegree(nodeCount, 0);
+    std::vector<std::vector<std::string>> writes(nodeCount);
+    std::vector<bool> disabled(nodeCount, false);
+
+    auto addEdge = [&](size_t from, size_t to, bool consumes) {
+        if (from == to) return;
+        successors[from].push_back(to);
+        inDegree[to]++;
+        if (consumes) producers[to].push_back(from);
+    };
+
+    std::unordered_map<std::string, size_t> lastWriter;
+    std::unordered_map<std::string, std::vector<size_t>> readersSinceLastWrite;
+
+    for (size_t i = 0; i < nodeCount; i++) {
+        const RenderPassData &pass = getPassData(nodes[i]);
+
+        for (const auto &name : disabledPasses) {
+            if (hasName(nodes[i], name)) disabled[i] = true;
+        }
+
+        writes[i] = pass.outputColorTextureName;
+        if (pass.outputDepthTextureName.has_value()) writes[i].push_back(pass.outputDepthTextureName.value());
+
+        std::vector<std::string> reads = pass.inputTextureNames;
+        for (const BindGroupsLinks &link : pass.bindGroups) {
+            if (link.type == BindGroupsLinks::AssetType::TextureView) reads.push_back(link.name);
+        }
+        // Loading an attachment reads what the previous writer left in it
+        if (pass.loadOp == wgpu::LoadOp::Load) reads.insert(reads.end(), writes[i].begin(), writes[i].end());
+
+        for (const auto &name : reads) {
+            if (auto it = lastWriter.find(name); it != lastWriter.end()) addEdge(it->second, i, true);
+            readersSinceLastWrite[name].push_back(i);
+        }
+
+        for (const auto &name : writes[i]) {
+            if (auto it = lastWriter.find(name); it != lastWriter.end()) addEdge(it->second, i, false);
+            for (size_t reader : readersSinceLastWrite[name]) addEdge(reader, i, false);
+            readersSinceLastWrite[name].clear();
+            lastWriter[name] = i;
+        }
+
+        for (const auto &dependency : pass.dependsOn) {
+            size_t j = 0;
+            while (j < nodeCount && !hasName(nodes[j], dependency)) j++;
+            if (j == nodeCount) throw std::runtime_error(fmt::format("RenderGraph: Pass '{}' depends on unknown pass '{}'.", pass.name, dependency));
+            addEdge(j, i, true);
+        }
+    }
+
+    // Walk back from the passes producing external outputs, everything not reached is dead
+    std::vector<bool> live(nodeCount, externalOutputs.empty());
+    if (!externalOutputs.empty()) {
+        std::vector<size_t> stack;
+        for (size_t i = 0; i < nodeCount; i++) {
+            if (disabled[i]) continue;
+            for (const auto &name : writes[i]) {
+                if (std::find(externalOutputs.begin(), externalOutputs.end(), name) != externalOutputs.end()) {
+                    live[i] = true;
+                    stack.push_back(i);
+                    break;
+                }
+            }
+        }
+        while (!stack.empty()) {
+            size_t i = stack.back();
+            stack.pop_back();
+            for (size_t producer : producers[i]) {
+                if (live[producer] || disabled[producer]) continue;
+                live[producer] = true;
+                stack.push_back(producer);
+            }
+        }
+    }
+
+    // Topological sort, ties are broken by insertion order to keep the plan stable
+    plan.clear();
+    std::vector<bool> scheduled(nodeCount, false);
+    for (size_t step = 0; step < nodeCount; step++) {
+        size_t next = 0;
+        while (next < nodeCount && (scheduled[next] || inDegree[next] != 0)) next++;
+        if (next == nodeCount) throw std::runtime_error("RenderGraph: Cycle detected between passes, cannot compile render graph.");
+
+        scheduled[next] = true;
+        for (size_t successor : successors[next]) inDegree[successor]--;
+
+        if (live[next] && !disabled[next]) {
+            plan.push_back(nodes[next]);
+        } else {
+            ES::Utils::Log::Debug(fmt::format("RenderGraph: Pass '{}' culled.", getPassData(nodes[next]).name));
+        }
+    }
+
+    computeTransientLifetimes();
+
+    // Passes are only ever appended, so existing compiled passes keep their render bundles
+    compiledRenderPasses.resize(singleRenderPasses.size());
+    compiledMultipleRenderPasses.resize(multipleRenderPasses.size());
+    resolveDirty = true;
+
+    dirty = false;
+}
+
+void RenderGraph::computeTransientLifetimes() {
+    std::unordered_map<std::string, const TransientTextureDescriptor *> descriptors;
+    for (const Node &node : nodes) {
+        for (const auto &descriptor : getPassData(node).transientTextures) descriptors[descriptor.name] = &descriptor;
+    }
+
+    // A transient texture lives from the first to the last pass of the plan using it, culled passes do not count
+    std::unordered_map<std::string, size_t> transientIndices;
+    transientTextures.clear();
+    for (size_t position = 0; position < plan.size(); position++) {
+        const RenderPassData &pass = getPassData(plan[position]);
+
+        // Reads go first: a pass loading or sampling a transient nothing wrote before it has to find it cleared
+        auto use = [&](const std::string &name, bool write) {
+            auto descriptor = descriptors.find(name);
+            if (descriptor == descriptors.end()) return;
+            auto [it, inserted] = transientIndices.try_emplace(name, transientTextures.size());
+            if (inserted) {
+                transientTextures.push_back({ .descriptor = *descriptor->second, .firstUse = position, .lastUse = position, .clearBeforeFirstUse = !write });
+                if (!write) ES::Utils::Log::Debug(fmt::format("RenderGraph: Transient texture '{}' is read by '{}' before any write, it is cleared.", name, pass.name));
+            }
+            transientTextures[it->second].lastUse = position;
+        };
+
+        for (const auto &name : pass.inputTextureNames) use(name, false);
+        for (const BindGroupsLinks &link : pass.bindGroups) {
+            if (link.type == BindGroupsLinks::AssetType::TextureView) use(link.name, false);
+        }
+        bool load = pass.loadOp == wgpu::LoadOp::Load;
+        for (const auto &name : pass.outputColorTextureName) use(name, !load);
+        if (pass.outputDepthTextureName.has_value()) use(pass.outputDepthTextureName.value(), !load);
+    }
+
+    transientTexturesDirty = true;
+}
+
+void RenderGraph::ReleaseTransientTextures(ES::Engine::Core &core) {
+    auto &textureManager = core.GetResource<TextureManager>();
+
+    for (const auto &name : allocatedTransientTextureNames) {
+        auto textureID = entt::hashed_string(name.c_str());
+        if (textureManager.Contains(textureID)) textureManager.Remove(textureID);
+    }
+    allocatedTransientTextureNames.clear();
+
+    for (auto &slot : transientSlots) {
+        slot.textureView.release();
+        slot.texture.destroy();
+        slot.texture.release();
+    }
+    transientSlots.clear();
+    transientTexturesDirty = true;
+}
+
+void RenderGraph::allocateTransientTextures(ES::Engine::Core &core, glm::uvec2 extent) {
+    auto &device = core.GetResource<wgpu::Device>();
+    auto &textureManager = core.GetResource<TextureManager>();
+
+    ReleaseTransientTextures(core);
+
+    // Greedy interval assignment: reuse the first compatible slot whose previous user is done before this one starts
+    for (auto &transient : transientTextures) {
+        const auto &descriptor = transient.descriptor;
+        // Cleared by an empty render pass
+        wgpu::TextureUsage usage = descriptor.usage;
+        if (transient.clearBeforeFirstUse) usage = usage | wgpu::TextureUsage::RenderAttachment;
+        auto slot = std::find_if(transientSlots.begin(), transientSlots.end(), [&](const TransientSlot &candidate) {
+            return candidate.format == descriptor.format && candidate.usage == usage &&
+                candidate.sizeScale == descriptor.sizeScale && candidate.lastUse < transient.firstUse;
+        });
+        if (slot == transientSlots.end()) {
+            transientSlots.push_back({ .format = descriptor.format, .usage = usage, .sizeScale = descriptor.sizeScale, .lastUse = transient.lastUse });
+            transient.slot = transientSlots.size() - 1;
+        } else {
+            slot->lastUse = transient.lastUse;
+            transient.slot = static_cast<size_t>(slot - transientSlots.begin());
+        }
+    }
+
+    for (size_t i = 0; i < transientSlots.size(); i++) {
+        auto &slot = transientSlots[i];
+
+        wgpu::TextureDescriptor textureDesc(wgpu::Default);
+        std::string textureLabel = fmt::format("RenderGraph::TransientTexture::{}", i);
+        textureDesc.label = wgpu::StringView(textureLabel);
+        textureDesc.size = {
+            std::max(1u, static_cast<uint32_t>(static_cast<float>(extent.x) * slot.sizeScale.x)),
+            std::max(1u, static_cast<uint32_t>(static_cast<float>(extent.y) * slot.sizeScale.y)),
+            1
+        };
+        textureDesc.format = slot.format;
+        textureDesc.usage = slot.usage;
+
+        slot.texture = device.createTexture(textureDesc);
+        if (slot.texture == nullptr) throw std::runtime_error(fmt::format("RenderGraph: Could not create transient texture {}.", i));
+        slot.textureView = slot.texture.createView();
+    }
+
+    for (const auto &transient : transientTextures) {
+        const auto &slot = transientSlots[transient.slot];
+        Texture texture;
+        texture.texture = slot.texture;
+        texture.textureView = slot.textureView;
+        texture.format = transient.descriptor.format;
+        textureManager.Add(entt::hashed_string(transient.descriptor.name.c_str()), texture);
+        allocatedTransientTextureNames.push_back(transient.descriptor.name);
+    }
+
+    ES::Utils::Log::Debug(fmt::format("RenderGraph: {} transient textures aliased onto {} textures.", transientTextures.size(), transientSlots.size()));
+
+    transientExtent = extent;
+    transientTexturesDirty = false;
+    resolveDirty = true;
+
+    for (auto &callback : transientTexturesCallbacks) {
+        callback(core);
+    }
+}
+
+ThreadPool &RenderGraph::GetThreadPool() {
+    if (threadPool == nullptr) threadPool = std::make_unique<ThreadPool>(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return *threadPool;
+}
+
+void RenderGraph::Execute(ES::Engine::Core &core) {
+    ES_PROFILE_ZONE(core, "RenderGraph::Execute");
+
+    if (dirty) Compile();
+
+    if (!transientTextures.empty()) {
+        if (externalOutputs.empty()) throw std::runtime_error("RenderGraph: Transient textures need an external output to be sized.");
+        const Texture &reference = core.GetResource<TextureManager>().Get(entt::hashed_string(externalOutputs.front().c_str()));
+        glm::uvec2 extent(reference.texture.getWidth(), reference.texture.getHeight());
+        if (transientTexturesDirty || extent != transientExtent) allocateTransientTextures(core, extent);
+    }
+
+    if (resolveDirty) {
+        for (const Node &node : plan) resolvePass(getPassData(node), getCompiledPass(node), core);
+        resolveDirty = false;
+        commandsGeneration++;
+    }
+
+    uint64_t geometry = core.GetResource<GeometryPool>().GetGeneration();
+    uint64_t culling = core.GetResource<GpuCulling>().GetGeneration();
+    if (core.GetResource<InstanceBatches>().BatchesChanged() || geometry != geometryGeneration || culling != cullingGeneration) {
+        commandsGeneration++;
+        geometryGeneration = geometry;
+        cullingGeneration = culling;
+    }
+
+    wgpu::Device &device = core.GetResource<wgpu::Device>();
+    auto &timings = core.GetResource<GpuFrameTimings>();
+    if (!profiler->IsInitialized()) profiler->Initialize(device, core.GetResource<FramesInFlight>().GetCount());
+    profiler->BeginFrame(timings);
+
+    for (const Node &node : plan) {
+        if (node.type != NodeType::MultipleRenderPass) continue;
+        auto &multiplePass = multipleRenderPasses[node.index];
+        if (multiplePass.preMultiplePassCallback != nullptr) multiplePass.preMultiplePassCallback(core, multiplePass.pass);
+    }
+
+    // Consecutive passes allowing it are recorded in parallel into their own command buffers, each iteration of a
+    // multiple pass into one of its own. The others are recorded on this thread into one command buffer per run.
+    // Everything is submitted at once in plan order, iterations in order.
+    commandBuffers.clear();
+    size_t begin = 0;
+    while (begin < plan.size()) {
+        size_t end = begin + 1;
+        bool parallel = getPassData(plan[begin]).parallelRecording;
+        while (end < plan.size() && getPassData(plan[end]).parallelRecording == parallel) end++;
+
+        recordJobs.clear();
+        if (parallel) {
+            for (size_t position = begin; position < end; position++) {
+                const Node &node = plan[position];
+                if (node.type != NodeType::MultipleRenderPass) {
+                    recordJobs.push_back({ .position = position });
+                    continue;
+                }
+                size_t passCount = multipleRenderPasses[node.index].getNumberOfPass(core);
+                reserveIterations(getCompiledPass(node), passCount, core);
+                getCompiledPass(node).drawCount = 0;
+                // Without any iteration, its transient textures are still cleared
+                for (size_t i = 0; i < std::max<size_t>(passCount, 1); i++) recordJobs.push_back({ .position = position, .iteration = i, .passCount = passCount });
+            }
+        }
+
+        if (recordJobs.size() <= 1) {
+            commandBuffers.push_back(recordNodes(begin, end, core));
+        } else {
+            size_t first = commandBuffers.size();
+            commandBuffers.resize(first + recordJobs.size());
+            GetThreadPool().ParallelFor(recordJobs.size(), [&](size_t i) {
+                RecordJob &job = recordJobs[i];
+                commandBuffers[first + i] = job.iteration == RecordJob::WholeNode ? recordNodes(job.position, job.position + 1, core) : recordIteration(job, core);
+            });
+            for (const RecordJob &job : recordJobs) {
+                if (job.iteration != RecordJob::WholeNode) getCompiledPass(plan[job.position]).drawCount += job.drawCount;
+            }
+        }
+        begin = end;
+    }
+
+    for (const Node &node : plan) {
+        if (node.type != NodeType::MultipleRenderPass) continue;
+        auto &multiplePass = multipleRenderPasses[node.index];
+        if (multiplePass.postMultiplePassCallback != nullptr) multiplePass.postMultiplePassCallback(core, multiplePass.pass);
+    }
+
+    uint32_t drawCalls = 0;
+    for (const Node &node : plan) drawCalls += getCompiledPass(node).drawCount;
+    core.GetResource<FrameStats>().drawCalls = drawCalls;
+
+    if (wgpu::CommandBuffer resolveCommands = profiler->Resolve(device)) commandBuffers.push_back(resolveCommands);
+
+    wgpu::Queue &queue = core.GetResource<wgpu::Queue>();
+    {
+        ES_PROFILE_ZONE(core, "RenderGraph::Submit");
+        wgpu::SubmissionIndex submission = queue.submitForIndex(commandBuffers.size(), commandBuffers.data());
+        core.GetResource<FramesInFlight>().EndFrame(queue, submission);
+    }
+    for (auto &commandBuffer : commandBuffers) commandBuffer.release();
+
+    profiler->EndFrame(device, timings);
+}
+
+wgpu::CommandBuffer RenderGraph::recordNodes(size_t begin, size_t end, ES::Engine::Core &core) {
+    wgpu::CommandEncoder commandEncoder = createCommandEncoder(core);
+
+    for (size_t i = begin; i < end; i++) {
+        clearTransientTextures(commandEncoder, i);
+        executeNode(commandEncoder, plan[i], core);
+    }
+
+    return finishCommandEncoder(commandEncoder);
+}
+
+wgpu::CommandBuffer RenderGraph::recordIteration(RecordJob &job, ES::Engine::Core &core) {
+    wgpu::CommandEncoder commandEncoder = createCommandEncoder(core);
+
+    // The first iteration is submitted first
+    if (job.iteration == 0) clearTransientTextures(commandEncoder, job.position);
+    if (job.iteration < job.passCount) {
+        const Node &node = plan[job.position];
+        auto &multiplePass = multipleRenderPasses[node.index];
+#if defined(DEBUG)
+        commandEncoder.pushDebugGroup(wgpu::StringView(multiplePass.name));
+#endif
+        job.drawCount = executeIteration(commandEncoder, multiplePass, getCompiledPass(node), core, job.iteration);
+#if defined(DEBUG)
+        commandEncoder.popDebugGroup();
+#endif
+    }
+
+    return finishCommandEncoder(commandEncoder);
+}
+
+wgpu::CommandEncoder RenderGraph::createCommandEncoder(ES::Engine::Core &core) {
+    wgpu::Device &device = core.GetResource<wgpu::Device>();
+
+    wgpu::CommandEncoderDescriptor encoderDesc(wgpu::Default);
+#if defined(DEBUG)
+    encoderDesc.label = wgpu::StringView("RenderGraph::CommandEncoder");
+#endif
+    wgpu::CommandEncoder commandEncoder = device.createCommandEncoder(encoderDesc);
+    if (commandEncoder == nullptr) throw std::runtime_error("RenderGraph: Command encoder is not created, cannot execute render graph.");
+    return commandEncoder;
+}
+
+wgpu::CommandBuffer RenderGraph::finishCommandEncoder(wgpu::CommandEncoder &commandEncoder) {
+    wgpu::CommandBufferDescriptor cmdBufferDescriptor(wgpu::Default);
+#if defined(DEBUG)
+    cmdBufferDescriptor.label = wgpu::StringView("RenderGraph::CommandBuffer");
+#endif
+    wgpu::CommandBuffer commandBuffer = commandEncoder.finish(cmdBufferDescriptor);
+    commandEncoder.release();
+
+    return commandBuffer;
+}
+
+void RenderGraph::clearTransientTextures(wgpu::CommandEncoder &commandEncoder, size_t position) {
+    for (const auto &transient : transientTextures) {
+        if (transient.firstUse != position || !transient.clearBeforeFirstUse) continue;
+
+        const TransientSlot &slot = transientSlots[transient.slot];
+        wgpu::RenderPassDescriptor renderPassDesc(wgpu::Default);
+        wgpu::RenderPassColorAttachment colorAttachment(wgpu::Default);
+        wgpu::RenderPassDepthStencilAttachment depthStencilAttachment(wgpu::Default);
+        switch (slot.format) {
+        case wgpu::TextureFormat::Depth16Unorm:
+        case wgpu::TextureFormat::Depth24Plus:
+        case wgpu::TextureFormat::Depth32Float:
+        case wgpu::TextureFormat::Depth24PlusStencil8:
+        case wgpu::TextureFormat::Depth32FloatStencil8:
+            depthStencilAttachment.view = slot.textureView;
+            depthStencilAttachment.depthClearValue = 1.0f;
+            depthStencilAttachment.depthLoadOp = wgpu::LoadOp::Clear;
+            depthStencilAttachment.depthStoreOp = wgpu::StoreOp::Store;
+            if (slot.format == wgpu::TextureFormat::Depth24PlusStencil8 || slot.format == wgpu::TextureFormat::Depth32FloatStencil8) {
+                depthStencilAttachment.stencilLoadOp = wgpu::LoadOp::Clear;
+                depthStencilAttachment.stencilStoreOp = wgpu::StoreOp::Store;
+            }
+            renderPassDesc.depthStencilAttachment = &depthStencilAttachment;
+            break;
+        default:
+            colorAttachment.view = slot.textureView;
+            colorAttachment.loadOp = wgpu::LoadOp::Clear;
+            colorAttachment.storeOp = wgpu::StoreOp::Store;
+            renderPassDesc.colorAttachmentCount = 1;
+            renderPassDesc.colorAttachments = &colorAttachment;
+            break;
+        }
+#if defined(DEBUG)
+        renderPassDesc.label = wgpu::StringView(transient.descriptor.name);
+#endif
+
+        wgpu::RenderPassEncoder renderPass = commandEncoder.beginRenderPass(renderPassDesc);
+        renderPass.end();
+        renderPass.release();
+    }
+}
+
+void RenderGraph::resolvePass(const RenderPassData &renderPassData, CompiledPass &compiled, ES::Engine::Core &core) {
+    auto &textureManager = core.GetResource<TextureManager>();
+    auto &bindGroups = core.GetResource<BindGroups>();
+
+    if (renderPassData.outputColorTextureName.size() > MaxColorAttachments) {
+        throw std::runtime_error(fmt::format("RenderGraph: Pass '{}' has more than {} color attachments.", renderPassData.name, MaxColorAttachments));
+    }
+
+    compiled.colorAttachmentCount = static_cast<uint32_t>(renderPassData.outputColorTextureName.size());
+    for (size_t i = 0; i < compiled.colorAttachmentCount; i++) {
+        compiled.colorTextures[i] = &textureManager.Get(entt::hashed_string(renderPassData.outputColorTextureName[i].c_str()));
+
+        wgpu::RenderPassColorAttachment &colorAttachment = compiled.colorAttachments[i];
+        colorAttachment = wgpu::RenderPassColorAttachment(wgpu::Default);
+        colorAttachment.loadOp = renderPassData.loadOp;
+        colorAttachment.storeOp = wgpu::StoreOp::Store;
+    }
+
+    compiled.depthTexture = nullptr;
+    if (renderPassData.outputDepthTextureName.has_value()) {
+        compiled.depthTexture = &textureManager.Get(entt::hashed_string(renderPassData.outputDepthTextureName.value().c_str()));
+
+        compiled.depthStencilAttachment = wgpu::RenderPassDepthStencilAttachment(wgpu::Default);
+        compiled.depthStencilAttachment.depthClearValue = 1.0f;
+        compiled.depthStencilAttachment.depthLoadOp = renderPassData.loadOp;
+        compiled.depthStencilAttachment.depthStoreOp = wgpu::StoreOp::Store;
+    }
+
+    compiled.pipeline = nullptr;
+    compiled.bindGroups.clear();
+    if (renderPassData.shaderName.has_value()) {
+        compiled.pipeline = &core.GetResource<Pipelines>().renderPipelines[renderPassData.shaderName.value()];
+
+        for (const BindGroupsLinks &link : renderPassData.bindGroups) {
+            const auto &name = link.name;
+            if (link.type == BindGroupsLinks::AssetType::BindGroup) {
+                auto it = bindGroups.groups.find(name);
+                if (it != bindGroups.groups.end()) {
+                    auto ring = bindGroups.rings.find(name);
+                    compiled.bindGroups.push_back({ .groupIndex = link.groupIndex, .bindGroup = &it->second,
+                        .ring = ring != bindGroups.rings.end() ? ring->second : nullptr });
+                } else {
+                    ES::Utils::Log::Error(fmt::format("CreateRenderPass::{}: Bind group with name '{}' not found.", renderPassData.name, name));
+                }
+            } else if (link.type == BindGroupsLinks::AssetType::TextureView) {
+                auto textureID = entt::hashed_string(name.c_str());
+                if (textureManager.Contains(textureID)) {
+                    compiled.bindGroups.push_back({ .groupIndex = link.groupIndex, .texture = &textureManager.Get(textureID) });
+                } else {
+                    ES::Utils::Log::Error(fmt::format("CreateRenderPass::{}: Texture with name '{}' not found.", renderPassData.name, name));
+                }
+            } else {
+                ES::Utils::Log::Error(fmt::format("CreateRenderPass::{}: Unknown BindGroupsLinks type.", renderPassData.name));
+            }
+        }
+    }
+
+#if defined(DEBUG)
+    compiled.label = fmt::format("CreateRenderPass::{}::RenderPass", renderPassData.name);
+#endif
+}
+
+void RenderGraph::executeNode(wgpu::CommandEncoder &commandEncoder, const Node &node, ES::Engine::Core &core) {
+    CompiledPass &compiled = getCompiledPass(node);
+    compiled.drawCount = 0;
+
+    switch (node.type) {
+    case NodeType::RenderPass:
+        compiled.drawCount = executePass(commandEncoder, singleRenderPasses[node.index], compiled, core);
+        break;
+    case NodeType::MultipleRenderPass: {
+        auto &multiplePass = multipleRenderPasses[node.index];
+#if defined(DEBUG)
+        commandEncoder.pushDebugGroup(wgpu::StringView(multiplePass.name));
+#endif
+        size_t passCount = multiplePass.getNumberOfPass(core);
+        for (size_t i = 0; i < passCount; i++) compiled.drawCount += executeIteration(commandEncoder, multiplePass, compiled, core, i);
+#if defined(DEBUG)
+        commandEncoder.popDebugGroup();
+#endif
+        break;
+    }
+    }
+}
+
+uint32_t RenderGraph::executeIteration(wgpu::CommandEncoder &commandEncoder, MultipleRenderPassData &multiplePass, CompiledPass &compiled, ES::Engine::Core &core, size_t iteration) {
+    if (multiplePass.prePassCallback != nullptr) multiplePass.prePassCallback(core, multiplePass.pass, iteration);
+    uint32_t drawCount = executePass(commandEncoder, multiplePass.pass, compiled, core, iteration);
+    if (multiplePass.postPassCallback != nullptr) multiplePass.postPassCallback(core, multiplePass.pass, iteration);
+    return drawCount;
+}
+
+void RenderGraph::reserveIterations(CompiledPass &compiled, size_t passCount, ES::Engine::Core &core) {
+    size_t bundleCount = passCount * core.GetResource<FramesInFlight>().GetCount();
+    if (compiled.renderBundles.size() < bundleCount) compiled.renderBundles.resize(bundleCount);
+    if (compiled.bundleRecorders.size() < passCount) compiled.bundleRecorders.resize(passCount);
+}
+
+uint32_t RenderGraph::executePass(wgpu::CommandEncoder &commandEncoder, const RenderPassData& renderPassData, CompiledPass &compiled, ES::Engine::Core &core, size_t iteration) {
+    ES_PROFILE_ZONE(core, renderPassData.name);
+    auto recordStart = std::chrono::steady_clock::now();
+
+    wgpu::RenderPassDescriptor renderPassDesc(wgpu::Default);
+#if defined(DEBUG)
+    commandEncoder.pushDebugGroup(wgpu::StringView(renderPassData.name));
+    renderPassDesc.label = wgpu::StringView(compiled.label);
+#endif
+
+    // Views are read every frame, the surface texture and the shadow map layers change between passes. The attachments
+    // are copied, the iterations of a multiple pass may be recorded at the same time.
+    wgpu::Color clearValue(wgpu::Default);
+    if (renderPassData.clearColor != nullptr) {
+        glm::vec4 clearColor = renderPassData.clearColor(core);
+        clearValue = wgpu::Color(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+    }
+    std::array<wgpu::RenderPassColorAttachment, MaxColorAttachments> colorAttachments = compiled.colorAttachments;
+    for (size_t i = 0; i < compiled.colorAttachmentCount; i++) {
+        colorAttachments[i].view = compiled.colorTextures[i]->textureView;
+        if (renderPassData.clearColor != nullptr) colorAttachments[i].clearValue = clearValue;
+    }
+
+    renderPassDesc.colorAttachmentCount = compiled.colorAttachmentCount;
+    renderPassDesc.colorAttachments = colorAttachments.data();
+
+    wgpu::RenderPassDepthStencilAttachment depthStencilAttachment = compiled.depthStencilAttachment;
+    if (compiled.depthTexture != nullptr) {
+        depthStencilAttachment.view = renderPassData.depthAttachmentView != nullptr ? renderPassData.depthAttachmentView(core, iteration) : compiled.depthTexture->textureView;
+        renderPassDesc.depthStencilAttachment = &depthStencilAttachment;
+    }
+
+    wgpu::RenderPassTimestampWrites timestampWrites(wgpu::Default);
+    if (profiler->WritePassTimestamps(renderPassData.name, static_cast<uint32_t>(iteration), timestampWrites)) {
+        renderPassDesc.timestampWrites = &timestampWrites;
+    }
+
+    wgpu::RenderPassEncoder renderPass = commandEncoder.beginRenderPass(renderPassDesc);
+
+    uint32_t drawCount = 0;
+    if (renderPassData.useRenderBundle && renderPassData.uniqueRenderCallback == nullptr) {
+        // The dynamic offsets of the rings differ from one frame in flight to the next, each one keeps its bundle
+        const auto &framesInFlight = core.GetResource<FramesInFlight>();
+        size_t bundleIndex = iteration * framesInFlight.GetCount() + framesInFlight.GetIndex();
+        // Already reserved when the iterations are recorded in parallel
+        if (compiled.renderBundles.size() <= bundleIndex) compiled.renderBundles.resize(bundleIndex + 1);
+        if (compiled.bundleRecorders.size() <= iteration) compiled.bundleRecorders.resize(iteration + 1);
+        CachedRenderBundle &cached = compiled.renderBundles[bundleIndex];
+        RenderEncoder &recorder = compiled.bundleRecorders[iteration];
+
+        // 3D passes draw the batches, whose changes are tracked by commandsGeneration, so their callbacks do not run
+        // while it stays the same. Other passes are recorded every frame. Either way, the bundle is only re-encoded
+        // when the commands differ from the ones it was encoded from.
+        bool tracked = renderPassData.pipelineType == PipelineType::_3D;
+        if (cached.bundle == nullptr || !tracked || cached.generation != commandsGeneration) {
+            recorder.Reset();
+            recordPassCommands(recorder, renderPassData, compiled, core, iteration);
+            if (cached.bundle == nullptr || !cached.commands.SameCommands(recorder)) {
+                if (cached.bundle) cached.bundle.release();
+                cached.bundle = createRenderBundle(renderPassData, compiled, core, recorder);
+                std::swap(cached.commands, recorder); // Keeps the memory of both lists
+            }
+            cached.generation = commandsGeneration;
+        }
+        renderPass.executeBundles(1, &cached.bundle);
+        drawCount = cached.commands.GetDrawCount();
+    } else {
+        RenderEncoder encoder(renderPass);
+        recordPassCommands(encoder, renderPassData, compiled, core, iteration);
+        drawCount = encoder.GetDrawCount();
+        if (renderPassData.uniqueRenderCallback != nullptr) { // Find a way to handle this properly, PS: this is used for ImGUI
+            renderPassData.uniqueRenderCallback(renderPass, core);
+        }
+    }
+
+    renderPass.end();
+    renderPass.release();
+
+    profiler->RecordCpuPass(renderPassData.name, static_cast<uint32_t>(iteration), std::chrono::steady_clock::now() - recordStart);
+
+#if defined(DEBUG)
+    commandEncoder.popDebugGroup();
+#endif
+    return drawCount;
+}
+
+void RenderGraph::recordPassCommands(RenderEncoder &encoder, const RenderPassData &renderPassData, const CompiledPass &compiled, ES::Engine::Core &core, size_t iteration) {
+    if (compiled.pipeline != nullptr) {
+        encoder.setPipeline(compiled.pipeline->pipeline);
+
+        const auto &framesInFlight = core.GetResource<FramesInFlight>();
+        for (const ResolvedBindGroup &resolved : compiled.bindGroups) {
+            wgpu::BindGroup bindGroup = resolved.texture != nullptr ? resolved.texture->bindGroup : *resolved.bindGroup;
+            if (resolved.ring != nullptr) {
+                uint32_t offset = framesInFlight.GetOffset(*resolved.ring);
+                encoder.setBindGroup(resolved.groupIndex, bindGroup, 1, &offset);
+            } else {
+                encoder.setBindGroup(resolved.groupIndex, bindGroup, 0, nullptr);
+            }
+        }
+    }
+
+    if (renderPassData.passCallback != nullptr) renderPassData.passCallback(encoder, core, iteration);
+
+    if (renderPassData.uniqueRenderCallback != nullptr) return;
+
+    // Every mesh lives in the pool buffers, they are bound once and draws only select their range
+    const auto &geometryPool = core.GetResource<GeometryPool>();
+    std::optional<GeometryPool::VertexFormat> boundVertexFormat;
+    // Index buffer of a format, or IndexFormatCount for the cluster indices of GpuCulling
+    std::optional<size_t> boundIndices;
+    auto bindGeometry = [&](const GeometryPool::Allocation &geometry) {
+        if (boundVertexFormat != geometry.format) geometryPool.BindVertices(encoder, geometry.format);
+        if (boundIndices != size_t(geometry.indexFormat)) geometryPool.BindIndices(encoder, geometry.indexFormat);
+        boundVertexFormat = geometry.format;
+        boundIndices = size_t(geometry.indexFormat);
+    };
+
+    // 3D meshes have a slot in the GBuffer uniforms and are drawn batch by batch, one instanced draw each
+    if (renderPassData.pipelineType == PipelineType::_3D) {
+        auto &registry = core.GetRegistry();
+        const auto &batches = core.GetResource<InstanceBatches>().GetBatches();
+
+        // Culled draws read their arguments at offsets that only move when the culling buffers grow, so the recorded
+        // commands (and the render bundle) stay the same whatever the GPU culls
+        const auto &culling = core.GetResource<GpuCulling>();
+        uint32_t cullingView = renderPassData.cullingView.value_or(0) + static_cast<uint32_t>(iteration);
+        bool indirect = renderPassData.cullingView.has_value() && culling.HasView(cullingView);
+        // Light views draw the coarser LODs picked for the shadows
+        bool shadowView = renderPassData.cullingView.value_or(GpuCulling::CameraView) != GpuCulling::CameraView;
+
+        for (uint32_t i = 0; i < batches.size(); i++) {
+            const auto &batch = batches[i];
+            if (!batch.geometry.IsValid()) continue;
+
+            if (renderPassData.perEntityCallback != nullptr) {
+                auto [mesh, transform] = registry.get<ES::Plugin::WebGPU::Component::Mesh, ES::Plugin::Object::Component::Transform>(batch.entity);
+                renderPassData.perEntityCallback(encoder, core, mesh, transform, ES::Engine::Entity(batch.entity));
+            }
+
+            if (indirect && culling.IsClustered(cullingView, i)) {
+                // The culling compacted the triangles of the visible meshlets, with their baseVertex
+                if (boundVertexFormat != batch.geometry.format) geometryPool.BindVertices(encoder, batch.geometry.format);
+                if (boundIndices != GeometryPool::IndexFormatCount) culling.BindClusterIndices(encoder);
+                boundVertexFormat = batch.geometry.format;
+                boundIndices = GeometryPool::IndexFormatCount;
+            } else {
+                bindGeometry(batch.geometry);
+            }
+            if (indirect) {
+                encoder.drawIndexedIndirect(culling.GetDrawArgsBuffer(), culling.GetDrawArgsOffset(cullingView, i));
+            } else {
+                uint32_t indexCount = shadowView ? batch.shadowIndexCount : batch.indexCount;
+                uint32_t firstIndex = shadowView ? batch.shadowFirstIndex : batch.firstIndex;
+                encoder.drawIndexed(indexCount, batch.instanceCount, firstIndex, static_cast<int32_t>(batch.geometry.vertexOffset), batch.firstInstance);
+            }
+        }
+        return;
+    }
+
+    core.GetRegistry().view<ES::Plugin::WebGPU::Component::Mesh, ES::Plugin::Object::Component::Transform>().each([&](auto e, ES::Plugin::WebGPU::Component::Mesh &mesh, ES::Plugin::Object::Component::Transform &transform) {
+        if (!mesh.enabled || mesh.pipelineType != renderPassData.pipelineType || !mesh.geometry.IsValid()) return;
+
+        if (renderPassData.perEntityCallback != nullptr) {
+            renderPassData.perEntityCallback(encoder, core, mesh, transform, ES::Engine::Entity(e));
+        }
+
+        bindGeometry(mesh.geometry);
+        encoder.drawIndexed(mesh.geometry.indexCount, 1, mesh.geometry.firstIndex, static_cast<int32_t>(mesh.geometry.vertexOffset), 0);
+    });
+}
+
+wgpu::RenderBundle RenderGraph::createRenderBundle(const RenderPassData &renderPassData, const CompiledPass &compiled, ES::Engine::Core &core, const RenderEncoder &recorded) {
+    auto &device = core.GetResource<wgpu::Device>();
+
+    // A bundle has to match the attachments of the pass it is executed in
+    std::array<WGPUTextureFormat, MaxColorAttachments> colorFormats = {};
+    for (size_t i = 0; i < compiled.colorAttachmentCount; i++) {
+        colorFormats[i] = compiled.colorTextures[i]->texture.getFormat();
+    }
+
+    wgpu::RenderBundleEncoderDescriptor bundleEncoderDesc(wgpu::Default);
+    bundleEncoderDesc.colorFormatCount = compiled.colorAttachmentCount;
+    bundleEncoderDesc.colorFormats = colorFormats.data();
+    if (compiled.depthTexture != nullptr) {
+        bundleEncoderDesc.depthStencilFormat = compiled.depthTexture->texture.getFormat();
+    }
+#if defined(DEBUG)
+    std::string bundleEncoderLabel = fmt::format("CreateRenderPass::{}::RenderBundleEncoder", renderPassData.name);
+    bundleEncoderDesc.label = wgpu::StringView(bundleEncoderLabel);
+#endif
+
+    wgpu::RenderBundleEncoder bundleEncoder = device.createRenderBundleEncoder(bundleEncoderDesc);
+    if (bundleEncoder == nullptr) throw std::runtime_error(fmt::format("RenderGraph: Could not create render bundle encoder for pass '{}'.", renderPassData.name));
+
+    recorded.Replay(bundleEncoder);
+
+    wgpu::RenderBundleDescriptor bundleDesc(wgpu::Default);
+#if defined(DEBUG)
+    std::string bundleLabel = fmt::format("CreateRenderPass::{}::RenderBundle", renderPassData.name);
+    bundleDesc.label = wgpu::StringView(bundleLabel);
+#endif
+    wgpu::RenderBundle bundle = bundleEncoder.finish(bundleDesc);
+    bundleEncoder.release();
+
+    ES::Utils::Log::Debug(fmt::format("RenderGraph: Render bundle of pass '{}' re-encoded.", renderPassData.name));
+
+    return bundle;
+}
+
+void RenderGraph::ReleaseRenderBundles() {
+    for (auto *compiledPasses : { &compiledRenderPasses, &compiledMultipleRenderPasses }) {
+        for (auto &compiled : *compiledPasses) {
+            for (auto &cached : compiled.renderBundles) {
+                if (cached.bundle) cached.bundle.release();
+            }
+            compiled.renderBundles.clear();
+        }
+    }
+}
@@ -1,6 +1,18 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+
 #include "structs.hpp"
+#include "ThreadPool.hpp"
+#include "GpuProfiler.hpp"
+#include "CpuProfiler.hpp"
+#include "FrameStats.hpp"
+#include "GpuCulling.hpp"
+#include "InstanceBatches.hpp"
 #include "entity/Entity.hpp"
 
 // TODO: Add namespace
@@ -10,152 +22,184 @@ class RenderGraph {
         ~RenderGraph() = default;
 
         void AddRenderPass(const RenderPassData& passData) {
-            order.push_back({ "RenderPassData", singleRenderPasses.size() });
+            nodes.push_back({ NodeType::RenderPass, singleRenderPasses.size() });
             singleRenderPasses.push_back(passData);
+            dirty = true;
         }
 
         void AddMultipleRenderPass(const MultipleRenderPassData& passesData) {
-            order.push_back({ "MultipleRenderPassData", multipleRenderPasses.size() });
+            nodes.push_back({ NodeType::MultipleRenderPass, multipleRenderPasses.size() });
             multipleRenderPasses.push_back(passesData);
+            dirty = true;
         }
 
-        void Execute(ES::Engine::Core &core) {
-            for (const auto& [type, index] : order) {
-                if (type == "RenderPassData") {
-                    executePass(singleRenderPasses[index], core);
-                } else if (type == "MultipleRenderPassData") {
-                    auto &multiplePass = multipleRenderPasses[index];
-                    // TODO: find a way to have a better resource management than ugly and unsafe std::function
-                    if (multiplePass.preMultiplePassCallback.has_value()) multiplePass.preMultiplePassCallback.value()(core, multiplePass.pass);
-                    for (size_t i = 0; i < multiplePass.getNumberOfPass(core); i++) {
-                        if (multiplePass.prePassCallback.has_value()) multiplePass.prePassCallback.value()(core, multiplePass.pass);
-                        executePass(multiplePass.pass, core);
-                        if (multiplePass.postPassCallback.has_value()) multiplePass.postPassCallback.value()(core, multiplePass.pass);
-                    }
-                    if (multiplePass.postMultiplePassCallback.has_value()) multiplePass.postMultiplePassCallback.value()(core, multiplePass.pass);
-                } else {
-                    throw std::runtime_error("Unknown render graph node type.");
-                }
-            }
+        // Textures consumed outside of the graph (e.g. presented to the surface), passes producing them are never culled.
+        // The first one also gives the reference size of transient textures. See TransientTextureDescriptor for which
+        // transient textures share memory.
+        void AddExternalOutput(const std::string &textureName) {
+            if (std::find(externalOutputs.begin(), externalOutputs.end(), textureName) == externalOutputs.end()) externalOutputs.push_back(textureName);
+            dirty = true;
         }
 
-    private:
-        void executePass(const RenderPassData& renderPassData, ES::Engine::Core &core) {
-            wgpu::Queue &queue = core.GetResource<wgpu::Queue>();
-            wgpu::Device &device = core.GetResource<wgpu::Device>();
-
-            wgpu::CommandEncoderDescriptor encoderDesc(wgpu::Default);
-            std::string encoderDescLabel = fmt::format("CreateRenderPass::{}::CommandEncoder", renderPassData.name);
-            encoderDesc.label = wgpu::StringView(encoderDescLabel);
-            auto commandEncoder = device.createCommandEncoder(encoderDesc);
-            if (commandEncoder == nullptr) throw std::runtime_error(fmt::format("CreateRenderPass::{}::Command encoder is not created, cannot draw sprite.", renderPassData.name));
-
-            std::vector<wgpu::CommandBuffer> commandBuffers;
-
-            wgpu::RenderPassDescriptor renderPassDesc(wgpu::Default);
-            std::string renderPassDescLabel = fmt::format("CreateRenderPass::{}::RenderPass", renderPassData.name);
-            renderPassDesc.label = wgpu::StringView(renderPassDescLabel);
-
-            std::vector<wgpu::RenderPassColorAttachment> colorAttachments;
-            colorAttachments.reserve(renderPassData.outputColorTextureName.size());
-
-            for (const auto& colorTextureName : renderPassData.outputColorTextureName) {
-                wgpu::RenderPassColorAttachment renderPassColorAttachment(wgpu::Default);
-                {
-                    renderPassColorAttachment.view = core.GetResource<TextureManager>().Get(entt::hashed_string(colorTextureName.c_str())).textureView;
-                    renderPassColorAttachment.loadOp = renderPassData.loadOp;
-                    renderPassColorAttachment.storeOp = wgpu::StoreOp::Store;
-                }
-                if (renderPassData.clearColor.has_value()) {
-                    glm::vec4 clearColor = renderPassData.clearColor.value()(core);
-                    renderPassColorAttachment.clearValue = wgpu::Color(
-                        clearColor.r,
-                        clearColor.g,
-                        clearColor.b,
-                        clearColor.a
-                    );
-                }
-                colorAttachments.push_back(renderPassColorAttachment);
-            }
-
-            renderPassDesc.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
-            renderPassDesc.colorAttachments = colorAttachments.data();
-
-            if (renderPassData.outputDepthTextureName.has_value()) {
-                wgpu::RenderPassDepthStencilAttachment depthStencilAttachment(wgpu::Default);
-                {
-                    depthStencilAttachment.view = core.GetResource<TextureManager>().Get(entt::hashed_string(renderPassData.outputDepthTextureName.value().c_str())).textureView;
-                    depthStencilAttachment.depthClearValue = 1.0f;
-                    depthStencilAttachment.depthLoadOp = renderPassData.loadOp;
-                    depthStencilAttachment.depthStoreOp = wgpu::StoreOp::Store;
-                }
-
-                renderPassDesc.depthStencilAttachment = &depthStencilAttachment;
-            }
-
-            wgpu::RenderPassEncoder renderPass = commandEncoder.beginRenderPass(renderPassDesc);
-
-            if (renderPassData.shaderName.has_value()) {
-                PipelineData &pipelineData = core.GetResource<Pipelines>().renderPipelines[renderPassData.shaderName.value()];
-                renderPass.setPipeline(pipelineData.pipeline);
-
-                for (const BindGroupsLinks &link : renderPassData.bindGroups) {
-                    auto name = link.name;
-                    if (link.type == BindGroupsLinks::AssetType::BindGroup) {
-                        auto &bindGroups = core.GetResource<BindGroups>();
-                        if (bindGroups.groups.contains(name)) {
-                            renderPass.setBindGroup(link.groupIndex, bindGroups.groups[name], 0, nullptr);
-                        } else {
-                            ES::Utils::Log::Error(fmt::format("CreateRenderPass::{}: Bind group with name '{}' not found.", renderPassData.name, name));
-                        }
-                    } else if (link.type == BindGroupsLinks::AssetType::TextureView) {
-                        auto &textures = core.GetResource<TextureManager>();
-                        auto textureID = entt::hashed_string(name.c_str());
-                        if (textures.Contains(textureID)) {
-                            auto &texture = textures.Get(textureID);
-                            renderPass.setBindGroup(link.groupIndex, texture.bindGroup, 0, nullptr);
-                        } else {
-                            ES::Utils::Log::Error(fmt::format("CreateRenderPass::{}: Texture with name '{}' not found.", renderPassData.name, name));
-                        }
-                    } else {
-                        ES::Utils::Log::Error(fmt::format("CreateRenderPass::{}: Unknown BindGroupsLinks type.", renderPassData.name));
-                    }
-                }
-            }
-            // Select which render pipeline to use
-            if (renderPassData.uniqueRenderCallback.has_value()) { // Find a way to handle this properly, PS: this is used for ImGUI
-                renderPassData.uniqueRenderCallback.value()(renderPass, core);
-            } else {
-                core.GetRegistry().view<ES::Plugin::WebGPU::Component::Mesh, ES::Plugin::Object::Component::Transform>().each([&](auto e, ES::Plugin::WebGPU::Component::Mesh &mesh, ES::Plugin::Object::Component::Transform &transform) {
-                    if (!mesh.enabled || mesh.pipelineType != renderPassData.pipelineType) return;
-
-                    if (renderPassData.perEntityCallback.has_value()) {
-                        renderPassData.perEntityCallback.value()(renderPass, core, mesh, transform, ES::Engine::Entity(e));
-                    }
-
-                    renderPass.setVertexBuffer(0, mesh.pointBuffer, 0, mesh.pointBuffer.getSize());
-                    renderPass.setIndexBuffer(mesh.indexBuffer, wgpu::IndexFormat::Uint32, 0, mesh.indexBuffer.getSize());
-                    renderPass.drawIndexed(mesh.indexCount, 1, 0, 0, 0);
-                });
-            }
-
-
-            renderPass.end();
-            renderPass.release();
-
-            // Finally encode and submit the render pass
-            wgpu::CommandBufferDescriptor cmdBufferDescriptor(wgpu::Default);
-            cmdBufferDescriptor.label = wgpu::StringView(fmt::format("CreateRenderPass::{}::CommandBuffer", renderPassData.name));
-            commandBuffers.push_back(commandEncoder.finish(cmdBufferDescriptor));
-            commandEncoder.release();
-
-            queue.submit(static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-            for (auto &command : commandBuffers) {
-                command.release();
-            }
+        // Called each time the transient textures are (re)allocated, to rebuild what references them (e.g. bind groups)
+        void AddTransientTexturesCallback(const std::function<void(ES::Engine::Core &)> &callback) {
+            transientTexturesCallbacks.push_back(callback);
+        }
+
+        // A disabled pass is culled from the plan. Its external outputs keep their previous content, its transient ones
+        // are cleared (to 0, depth to 1) before the first pass still reading them.
+        void SetPassEnabled(const std::string &name, bool enabled) {
+            if (enabled) disabledPasses.erase(name);
+            else disabledPasses.insert(name);
+            dirty = true;
         }
 
+        bool IsPassEnabled(const std::string &name) const { return !disabledPasses.contains(name); }
+
+        // Build the pass DAG from declared inputs/outputs and dependsOn, sort it and cull passes nothing consumes.
+        // Called lazily by Execute whenever the graph changed.
+        void Compile();
+
+        void Execute(ES::Engine::Core &core);
+
+        // Workers recording the parallel passes, also lent to the systems running before Execute. Started on first use.
+        ThreadPool &GetThreadPool();
+
+        // Destroy the textures backing the transient attachments, they are recreated on the next Execute
+        void ReleaseTransientTextures(ES::Engine::Core &core);
+
+        void ReleaseRenderBundles();
+
+        // Render bundles of 3D passes are only recorded again when something they draw changed. Batches, GeometryPool and
+        // GpuCulling changes are detected, anything else a pass reads when recording (a bind group or texture replaced
+        // outside of the graph) has to be reported here.
+        void InvalidateRecordedCommands() { commandsGeneration++; }
+
+        void ReleaseProfiler() { profiler->Release(); }
+
+    private:
+        enum class NodeType {
+            RenderPass,
+            MultipleRenderPass,
+        };
+
+        struct Node {
+            NodeType type;
+            size_t index;
+        };
+
+        struct TransientTexture {
+            TransientTextureDescriptor descriptor;
+            size_t firstUse; // Position in the plan
+            size_t lastUse;
+            size_t slot = 0;
+            bool clearBeforeFirstUse = false; // Its first user reads it, no pass of the plan wrote it before
+        };
+
+        // Physical texture shared by transient textures with the same format, usage and size
+        struct TransientSlot {
+            wgpu::TextureFormat format;
+            wgpu::TextureUsage usage;
+            glm::vec2 sizeScale;
+            size_t lastUse;
+            wgpu::Texture texture = nullptr;
+            wgpu::TextureView textureView = nullptr;
+        };
+
+        struct CachedRenderBundle {
+            uint64_t generation = 0; // commandsGeneration it was recorded at
+            RenderEncoder commands; // The bundle is encoded from them
+            wgpu::RenderBundle bundle = nullptr;
+        };
+
+        static constexpr size_t MaxColorAttachments = 8; // Default maxColorAttachments limit of WebGPU
+
+        // Bind group of a pass resolved to the entry it reads, the handle itself is fetched when recording
+        struct ResolvedBindGroup {
+            uint32_t groupIndex;
+            wgpu::BindGroup *bindGroup = nullptr; // In BindGroups::groups, std::map nodes are stable
+            Texture *texture = nullptr; // For TextureView links, the texture bind group is used
+            const wgpu::Buffer *ring = nullptr; // In BindGroups::rings, the group is bound at the offset of the frame
+        };
+
+        // Names of a pass resolved once, so executing it does not look anything up, format or allocate.
+        // Resolved again after each compilation and transient textures reallocation, the entries it points to have to be
+        // updated in place rather than removed and added back.
+        struct CompiledPass {
+            std::array<Texture *, MaxColorAttachments> colorTextures = {};
+            std::array<wgpu::RenderPassColorAttachment, MaxColorAttachments> colorAttachments;
+            uint32_t colorAttachmentCount = 0;
+            Texture *depthTexture = nullptr;
+            wgpu::RenderPassDepthStencilAttachment depthStencilAttachment;
+            PipelineData *pipeline = nullptr;
+            std::vector<ResolvedBindGroup> bindGroups;
+            std::vector<CachedRenderBundle> renderBundles; // One per iteration of a multiple pass and frame in flight
+            std::vector<RenderEncoder> bundleRecorders; // Per iteration so they can be recorded in parallel, swapped with the cached commands
+            uint32_t drawCount = 0; // Last frame, every iteration of a multiple pass included
+#if defined(DEBUG)
+            std::string label;
+#endif
+        };
+
+        // Part of a run of parallel passes recorded by a worker into its own command buffer: a whole node, or one
+        // iteration of a multiple pass
+        struct RecordJob {
+            static constexpr size_t WholeNode = SIZE_MAX;
+
+            size_t position; // In the plan
+            size_t iteration = WholeNode;
+            size_t passCount = 0; // Of the multiple pass
+            uint32_t drawCount = 0; // Of the iteration
+        };
+
+        const RenderPassData &getPassData(const Node &node) const;
+        CompiledPass &getCompiledPass(const Node &node);
+        bool hasName(const Node &node, const std::string &name) const;
+
+        void computeTransientLifetimes();
+        void allocateTransientTextures(ES::Engine::Core &core, glm::uvec2 extent);
+        void resolvePass(const RenderPassData &renderPassData, CompiledPass &compiled, ES::Engine::Core &core);
+
+        wgpu::CommandBuffer recordNodes(size_t begin, size_t end, ES::Engine::Core &core);
+        wgpu::CommandBuffer recordIteration(RecordJob &job, ES::Engine::Core &core);
+        wgpu::CommandEncoder createCommandEncoder(ES::Engine::Core &core);
+        wgpu::CommandBuffer finishCommandEncoder(wgpu::CommandEncoder &commandEncoder);
+        // Transient textures read before any write by the pass at this position of the plan
+        void clearTransientTextures(wgpu::CommandEncoder &commandEncoder, size_t position);
+        void executeNode(wgpu::CommandEncoder &commandEncoder, const Node &node, ES::Engine::Core &core);
+        // Its callbacks and the pass, returns the number of draws
+        uint32_t executeIteration(wgpu::CommandEncoder &commandEncoder, MultipleRenderPassData &multiplePass, CompiledPass &compiled, ES::Engine::Core &core, size_t iteration);
+        // iteration tells apart the passes of a MultipleRenderPassData, each one keeps its own render bundle. Returns the
+        // number of draws.
+        uint32_t executePass(wgpu::CommandEncoder &commandEncoder, const RenderPassData& renderPassData, CompiledPass &compiled, ES::Engine::Core &core, size_t iteration = 0);
+        // Storage of the bundles of every iteration, before they are recorded in parallel
+        void reserveIterations(CompiledPass &compiled, size_t passCount, ES::Engine::Core &core);
+        void recordPassCommands(RenderEncoder &encoder, const RenderPassData &renderPassData, const CompiledPass &compiled, ES::Engine::Core &core, size_t iteration);
+        wgpu::RenderBundle createRenderBundle(const RenderPassData &renderPassData, const CompiledPass &compiled, ES::Engine::Core &core, const RenderEncoder &recorded);
+
         std::vector<RenderPassData> singleRenderPasses;
         std::vector<MultipleRenderPassData> multipleRenderPasses;
-        std::list<std::pair<std::string, size_t>> order;
+        std::vector<Node> nodes; // In insertion order
+        std::vector<Node> plan; // Sorted and culled nodes, valid while dirty is false
+        std::vector<CompiledPass> compiledRenderPasses; // Same indices as singleRenderPasses
+        std::vector<CompiledPass> compiledMultipleRenderPasses; // Same indices as multipleRenderPasses
+        bool resolveDirty = true;
+        uint64_t commandsGeneration = 1; // Bumped whenever recorded commands may be stale, see InvalidateRecordedCommands
+        uint64_t geometryGeneration = 0; // Of GeometryPool and GpuCulling at the last Execute
+        uint64_t cullingGeneration = 0;
+        std::vector<std::string> externalOutputs;
+        std::unordered_set<std::string> disabledPasses;
+        bool dirty = true;
+
+        std::vector<TransientTexture> transientTextures; // Sorted by first use
+        std::vector<TransientSlot> transientSlots;
+        std::vector<std::string> allocatedTransientTextureNames;
+        std::vector<std::function<void(ES::Engine::Core &)>> transientTexturesCallbacks;
+        glm::uvec2 transientExtent = { 0, 0 };
+        bool transientTexturesDirty = true;
+
+        std::unique_ptr<ThreadPool> threadPool;
+        std::vector<wgpu::CommandBuffer> commandBuffers; // In plan order, submitted at once
+        std::vector<RecordJob> recordJobs; // Of the current parallel run
+        std::unique_ptr<GpuProfiler> profiler = std::make_unique<GpuProfiler>(); // Its readback callbacks keep pointers to it
 };
@@ -0,0 +1,259 @@
+#include "TransformUniforms.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fmt/format.h>
+#include <limits>
+#include <stdexcept>
+
+static_assert(sizeof(TransformUniforms::TransformRecord) == 40, "TransformRecord has to match Transform in shaderTransforms.wgsl");
+static_assert(sizeof(TransformUniforms::VertexMapping) == 24, "VertexMapping has to match VertexMapping in shaderTransforms.wgsl");
+
+// Writes the runs of dirty elements, short runs of clean ones between them are merged in: one bigger write is cheaper
+// than several small ones. Returns the number of bytes written.
+template <typename T>
+static uint64_t UploadDirty(wgpu::Queue &queue, wgpu::Buffer buffer, const std::vector<T> &elements, std::vector<uint8_t> &dirty) {
+    uint64_t written = 0;
+    size_t count = elements.size();
+    size_t index = 0;
+    while (index < count) {
+        if (!dirty[index]) {
+            index++;
+            continue;
+        }
+        size_t first = index;
+        size_t last = index;
+        for (size_t next = index + 1; next < count && next - last <= TransformUniforms::MaxMergedGap; next++) {
+            if (dirty[next]) last = next;
+        }
+        std::fill(dirty.begin() + first, dirty.begin() + last + 1, 0);
+
+        uint64_t size = (last - first + 1) * sizeof(T);
+        queue.writeBuffer(buffer, first * sizeof(T), &elements[first], size);
+        written += size;
+        index = last + 1;
+    }
+    return written;
+}
+
+static wgpu::Buffer CreateBuffer(wgpu::Device &device, const char *label, uint64_t size) {
+    wgpu::BufferDescriptor bufferDesc(wgpu::Default);
+    bufferDesc.size = size;
+    bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage;
+    bufferDesc.label = wgpu::StringView(label);
+    wgpu::Buffer buffer = device.createBuffer(bufferDesc);
+    if (buffer == nullptr) throw std::runtime_error(fmt::format("TransformUniforms: Could not create the {}.", label));
+    return buffer;
+}
+
+uint32_t TransformUniforms::AllocateSlot() {
+    if (!freeSlots.empty()) {
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+
+    // NaN never compares equal, so the first Set of a new slot always computes it
+    float nan = std::numeric_limits<float>::quiet_NaN();
+    uniforms.push_back({});
+    transforms.push_back({ glm::vec3(nan), glm::quat(nan, nan, nan, nan), glm::vec3(nan), glm::vec3(nan), glm::vec3(nan) });
+    dirty.push_back(0);
+    if (gpuExpansion) {
+        records.push_back({});
+        vertexMappings.push_back({});
+        mappingDirty.push_back(0);
+    }
+    return static_cast<uint32_t>(uniforms.size() - 1);
+}
+
+void TransformUniforms::FreeSlot(uint32_t slot) {
+    if (slot >= uniforms.size()) return;
+    // The next owner may have the same matrices, it does not need to be uploaded again
+    freeSlots.push_back(slot);
+}
+
+void TransformUniforms::Set(uint32_t slot, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale, const glm::mat4 &vertexToLocal) {
+    // vertexToLocal only translates and scales
+    SlotTransform transform = { position, rotation, scale, glm::vec3(vertexToLocal[3]), glm::vec3(vertexToLocal[0][0], vertexToLocal[1][1], vertexToLocal[2][2]) };
+    if (transforms[slot] == transform) return;
+
+    if (gpuExpansion) {
+        // The vertex mapping only changes with the mesh, most frames only upload the record
+        if (transform.vertexOffset != transforms[slot].vertexOffset || transform.vertexScale != transforms[slot].vertexScale) {
+            vertexMappings[slot] = { transform.vertexOffset, transform.vertexScale };
+            mappingDirty[slot] = 1;
+            anyMappingDirty = true;
+        }
+        records[slot] = { position, glm::vec4(rotation.x, rotation.y, rotation.z, rotation.w), scale };
+    } else {
+        pending.Push(slot, position, rotation, scale, transform.vertexOffset, transform.vertexScale);
+    }
+    transforms[slot] = transform;
+    dirty[slot] = 1;
+    anyDirty = true;
+}
+
+void TransformUniforms::Compute(ThreadPool *pool) {
+    static_assert(sizeof(Uniforms) == 2 * sizeof(glm::mat4), "The matrices of a slot are written with a stride of 2 matrices");
+    if (pending.Size() == 0) return;
+    ES::Plugin::WebGPU::Util::ComputeTransformMatrices(pending, &uniforms[0].modelMatrix, &uniforms[0].normalModelMatrix, sizeof(Uniforms) / sizeof(glm::mat4), pool);
+    pending.Clear();
+}
+
+bool TransformUniforms::Reserve(wgpu::Device &device, wgpu::Buffer &buffer) {
+    uint64_t needed = std::max<uint64_t>(uniforms.size(), 1) * sizeof(Uniforms);
+    if (buffer != nullptr && buffer.getSize() >= needed) return false;
+
+    uint64_t capacity = buffer != nullptr ? buffer.getSize() / sizeof(Uniforms) : 0;
+    capacity = std::max({ uint64_t(uniforms.size()), capacity * 2, uint64_t(MinCapacity) });
+    if (buffer) buffer.release();
+    wgpu::BufferDescriptor bufferDesc(wgpu::Default);
+    bufferDesc.size = capacity * sizeof(Uniforms);
+    bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage;
+    bufferDesc.label = wgpu::StringView("Uniforms Buffer for GBuffer");
+    buffer = device.createBuffer(bufferDesc);
+    if (buffer == nullptr) throw std::runtime_error("TransformUniforms: Could not create the uniforms buffer.");
+
+    if (gpuExpansion) {
+        // The records are kept, only the matrices they expand into are lost
+        ReserveExpansion(device, capacity);
+    }
+    std::fill(dirty.begin(), dirty.end(), 1);
+    anyDirty = true;
+    return true;
+}
+
+void TransformUniforms::InitializeExpansion(wgpu::Device &device) {
+    wgpu::ShaderSourceWGSL wgslDesc(wgpu::Default);
+    std::string wgslSource = loadFile("./assets/shader/shaderTransforms.wgsl");
+    wgslDesc.code = wgpu::StringView(wgslSource);
+    wgpu::ShaderModuleDescriptor shaderDesc(wgpu::Default);
+    shaderDesc.nextInChain = &wgslDesc.chain;
+    shaderDesc.label = wgpu::StringView("Shader source Transforms");
+    wgpu::ShaderModule shaderModule = device.createShaderModule(shaderDesc);
+
+    std::array<WGPUBindGroupLayoutEntry, 3> entries = {};
+    const std::array<wgpu::BufferBindingType, 3> types = {
+        wgpu::BufferBindingType::ReadOnlyStorage, // Records
+        wgpu::BufferBindingType::ReadOnlyStorage, // Vertex mappings
+        wgpu::BufferBindingType::Storage, // GBuffer uniforms
+    };
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        entries[i].binding = i;
+        entries[i].visibility = wgpu::ShaderStage::Compute;
+        entries[i].buffer.type = types[i];
+    }
+    wgpu::BindGroupLayoutDescriptor bindGroupLayoutDesc(wgpu::Default);
+    bindGroupLayoutDesc.entryCount = entries.size();
+    bindGroupLayoutDesc.entries = entries.data();
+    bindGroupLayoutDesc.label = wgpu::StringView("Transforms Bind Group Layout");
+    bindGroupLayout = device.createBindGroupLayout(bindGroupLayoutDesc);
+
+    WGPUBindGroupLayout layouts[] = { bindGroupLayout };
+    wgpu::PipelineLayoutDescriptor layoutDesc(wgpu::Default);
+    layoutDesc.bindGroupLayoutCount = 1;
+    layoutDesc.bindGroupLayouts = layouts;
+    wgpu::PipelineLayout layout = device.createPipelineLayout(layoutDesc);
+
+    wgpu::ComputePipelineDescriptor pipelineDesc(wgpu::Default);
+    pipelineDesc.label = wgpu::StringView("Transforms Pipeline");
+    pipelineDesc.layout = layout;
+    pipelineDesc.compute.module = shaderModule;
+    pipelineDesc.compute.entryPoint = wgpu::StringView("cs_main");
+    pipeline = device.createComputePipeline(pipelineDesc);
+    layout.release();
+    shaderModule.release();
+    if (pipeline == nullptr) throw std::runtime_error("TransformUniforms: Could not create the transforms pipeline.");
+}
+
+void TransformUniforms::ReserveExpansion(wgpu::Device &device, uint64_t capacity) {
+    if (pipeline == nullptr) InitializeExpansion(device);
+
+    // Same capacity as the uniforms buffer, every slot it holds has a record
+    if (recordsBuffer) recordsBuffer.release();
+    if (vertexMappingsBuffer) vertexMappingsBuffer.release();
+    recordsBuffer = CreateBuffer(device, "Transform Records Buffer", capacity * sizeof(TransformRecord));
+    vertexMappingsBuffer = CreateBuffer(device, "Vertex Mappings Buffer", capacity * sizeof(VertexMapping));
+    std::fill(mappingDirty.begin(), mappingDirty.end(), 1);
+    anyMappingDirty = true;
+    if (bindGroup) bindGroup.release();
+    bindGroup = nullptr;
+}
+
+void TransformUniforms::Expand(wgpu::Device &device, wgpu::Queue &queue, wgpu::Buffer buffer) {
+    if (bindGroup == nullptr || boundBuffer != static_cast<WGPUBuffer>(buffer)) {
+        std::array<wgpu::Buffer, 3> buffers = { recordsBuffer, vertexMappingsBuffer, buffer };
+        std::array<wgpu::BindGroupEntry, 3> entries;
+        for (uint32_t i = 0; i < entries.size(); i++) {
+            entries[i] = wgpu::BindGroupEntry(wgpu::Default);
+            entries[i].binding = i;
+            entries[i].buffer = buffers[i];
+            entries[i].size = buffers[i].getSize();
+        }
+        wgpu::BindGroupDescriptor bindGroupDesc(wgpu::Default);
+        bindGroupDesc.layout = bindGroupLayout;
+        bindGroupDesc.entryCount = entries.size();
+        bindGroupDesc.entries = entries.data();
+        bindGroupDesc.label = wgpu::StringView("Transforms Bind Group");
+        if (bindGroup) bindGroup.release();
+        bindGroup = device.createBindGroup(bindGroupDesc);
+        if (bindGroup == nullptr) throw std::runtime_error("TransformUniforms: Could not create the transforms bind group.");
+        boundBuffer = buffer;
+    }
+
+    // Every slot is expanded again, it costs less than a list of the changed ones. Submitted on its own, before the
+    // culling and the render graph, which read the matrices.
+    uint32_t slotCount = GetSlotCount();
+    wgpu::CommandEncoder encoder = device.createCommandEncoder();
+    wgpu::ComputePassEncoder computePass = encoder.beginComputePass();
+    computePass.setPipeline(pipeline);
+    computePass.setBindGroup(0, bindGroup, 0, nullptr);
+    computePass.dispatchWorkgroups((slotCount + WorkgroupSize - 1) / WorkgroupSize, 1, 1);
+    computePass.end();
+    computePass.release();
+    wgpu::CommandBuffer commandBuffer = encoder.finish();
+    encoder.release();
+    queue.submit(1, &commandBuffer);
+    commandBuffer.release();
+}
+
+uint64_t TransformUniforms::Upload(wgpu::Device &device, wgpu::Queue &queue, wgpu::Buffer buffer) {
+    if (!anyDirty) return 0;
+
+    uint64_t written = 0;
+    if (gpuExpansion) {
+        if (anyMappingDirty) written += UploadDirty(queue, vertexMappingsBuffer, vertexMappings, mappingDirty);
+        written += UploadDirty(queue, recordsBuffer, records, dirty);
+        Expand(device, queue, buffer);
+    } else {
+        written += UploadDirty(queue, buffer, uniforms, dirty);
+    }
+    anyDirty = false;
+    anyMappingDirty = false;
+    return written;
+}
+
+void TransformUniforms::Release() {
+    uniforms.clear();
+    transforms.clear();
+    pending.Clear();
+    dirty.clear();
+    anyDirty = false;
+    freeSlots.clear();
+    records.clear();
+    vertexMappings.clear();
+    mappingDirty.clear();
+    anyMappingDirty = false;
+    if (bindGroup) bindGroup.release();
+    if (bindGroupLayout) bindGroupLayout.release();
+    if (pipeline) pipeline.release();
+    if (recordsBuffer) recordsBuffer.release();
+    if (vertexMappingsBuffer) vertexMappingsBuffer.release();
+    bindGroup = nullptr;
+    bindGroupLayout = nullptr;
+    pipeline = nullptr;
+    recordsBuffer = nullptr;
+    vertexMappingsBuffer = nullptr;
+    boundBuffer = nullptr;
+}
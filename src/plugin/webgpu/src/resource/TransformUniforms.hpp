@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+
+#include "webgpu.hpp"
+#include "ThreadPool.hpp"
+#include "TransformKernel.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// GBuffer uniforms of a mesh, read by shaderGBuffer.wgsl and shaderShadow.wgsl. Here rather than in structs.hpp, which
+// includes Mesh.hpp, so Mesh.hpp can include this header.
+struct Uniforms {
+    glm::mat4 modelMatrix;
+    glm::mat4 normalModelMatrix;
+};
+
+// CPU copy of the GBuffer uniforms. Each mesh owns a slot from its construction to its release (Mesh::transformIndex),
+// freed slots are reused, so meshes coming and going or toggled do not move the other ones. A slot is only recomputed
+// when its transform changed, all of them at once by Util::ComputeTransformMatrices, and only the changed slots are
+// uploaded, in a few coalesced writes.
+// With GPU expansion, the changed slots upload their TransformRecord (40 bytes instead of 128) and shaderTransforms.wgsl
+// writes the matrices into the same buffer, with the same layout, before the passes and the culling read it.
+// The GPU buffers grow geometrically.
+class TransformUniforms {
+    public:
+        static constexpr uint32_t InvalidSlot = UINT32_MAX;
+        static constexpr uint32_t MinCapacity = 256;
+        // Clean slots between two changed ones that are still uploaded in the same write
+        static constexpr uint32_t MaxMergedGap = 8;
+        static constexpr uint32_t WorkgroupSize = 64; // Has to match shaderTransforms.wgsl
+
+        // Has to match Transform in shaderTransforms.wgsl
+        struct TransformRecord {
+            glm::vec3 position;
+            glm::vec4 rotation; // Quaternion, x y z w
+            glm::vec3 scale;
+        };
+        // Has to match VertexMapping in shaderTransforms.wgsl, only uploaded when the mesh changes
+        struct VertexMapping {
+            glm::vec3 offset;
+            glm::vec3 scale;
+        };
+
+        explicit TransformUniforms(bool gpuExpansion = false) : gpuExpansion(gpuExpansion) {}
+
+        bool IsGpuExpansion() const { return gpuExpansion; }
+
+        uint32_t AllocateSlot();
+        void FreeSlot(uint32_t slot);
+        // Highest slot ever allocated + 1
+        uint32_t GetSlotCount() const { return static_cast<uint32_t>(uniforms.size()); }
+        // Transform of the mesh in the slot, vertexToLocal maps its vertex buffer positions (see Mesh::GetVertexToLocal).
+        // The matrices are only computed by Compute, or on the GPU, if the transform changed.
+        void Set(uint32_t slot, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale, const glm::mat4 &vertexToLocal);
+        // Matrices of the slots set with a new transform, split on pool when there are many. Nothing to do with GPU
+        // expansion.
+        void Compute(ThreadPool *pool = nullptr);
+        size_t GetPendingCount() const { return pending.Size(); }
+
+        // Recreate buffer when it cannot hold every slot, everything is then uploaded again. Returns true when it was.
+        bool Reserve(wgpu::Device &device, wgpu::Buffer &buffer);
+        // Write the changed slots once computed, or their records and submit the expansion into buffer. Returns the
+        // number of bytes written.
+        uint64_t Upload(wgpu::Device &device, wgpu::Queue &queue, wgpu::Buffer buffer);
+
+        void Release();
+
+    private:
+        struct SlotTransform {
+            glm::vec3 position;
+            glm::quat rotation;
+            glm::vec3 scale;
+            glm::vec3 vertexOffset;
+            glm::vec3 vertexScale;
+
+            bool operator==(const SlotTransform &other) const = default;
+        };
+
+        std::vector<Uniforms> uniforms;
+        std::vector<SlotTransform> transforms; // Transform each slot was computed from
+        ES::Plugin::WebGPU::Util::TransformBatch pending; // Set since the last Compute
+        std::vector<uint8_t> dirty;
+        bool anyDirty = false;
+        std::vector<uint32_t> freeSlots;
+
+        void InitializeExpansion(wgpu::Device &device);
+        void ReserveExpansion(wgpu::Device &device, uint64_t capacity);
+        void Expand(wgpu::Device &device, wgpu::Queue &queue, wgpu::Buffer buffer);
+
+        bool gpuExpansion = false;
+        std::vector<TransformRecord> records;
+        std::vector<VertexMapping> vertexMappings;
+        std::vector<uint8_t> mappingDirty;
+        bool anyMappingDirty = false;
+        wgpu::Buffer recordsBuffer = nullptr;
+        wgpu::Buffer vertexMappingsBuffer = nullptr;
+        wgpu::ComputePipeline pipeline = nullptr;
+        wgpu::BindGroupLayout bindGroupLayout = nullptr;
+        wgpu::BindGroup bindGroup = nullptr;
+        WGPUBuffer boundBuffer = nullptr; // Uniforms buffer of bindGroup
+};
@@ -3,23 +3,63 @@
 #include "WebGPU.hpp"
 #include "resource/window/Window.hpp"
 
-void ES::Plugin::WebGPU::System::ConfigureSurface(ES::Engine::Core &core) {
+// Headless, WindowColorTexture is a texture of the configured resolution that stays the same every frame
+static void ConfigureOffscreenTarget(ES::Engine::Core &core) {
+	const auto &device = core.GetResource<wgpu::Device>();
+	const auto &renderOutput = core.GetResource<RenderOutput>();
+	auto &textureManager = core.GetResource<TextureManager>();
+
+	if (renderOutput.size.x == 0 || renderOutput.size.y == 0) throw std::runtime_error("Headless resolution cannot be empty.");
+
+	wgpu::TextureDescriptor textureDesc(wgpu::Default);
+	textureDesc.label = wgpu::StringView("Offscreen Color Texture");
+	textureDesc.size = { renderOutput.size.x, renderOutput.size.y, 1u };
+	textureDesc.format = renderOutput.format;
+	textureDesc.usage = wgpu::TextureUsage::RenderAttachment | wgpu::TextureUsage::CopySrc | wgpu::TextureUsage::TextureBinding;
+
+	Texture texture;
+	texture.texture = device.createTexture(textureDesc);
+	if (texture.texture == nullptr) throw std::runtime_error("Could not create offscreen color texture.");
+	texture.textureView = texture.texture.createView();
+	texture.format = renderOutput.format;
+
+	if (textureManager.Contains("WindowColorTexture")) {
+		Texture &previous = textureManager.Get("WindowColorTexture");
+		previous.textureView.release();
+		previous.texture.release();
+		previous.texture = texture.texture;
+		previous.textureView = texture.textureView;
+		previous.format = texture.format;
+	} else {
+		textureManager.Add("WindowColorTexture", texture);
+	}
+}
 
+void ES::Plugin::WebGPU::System::ConfigureSurface(ES::Engine::Core &core) {
 	const auto &device = core.GetResource<wgpu::Device>();
+	auto &renderOutput = core.GetResource<RenderOutput>();
+
+	if (device == nullptr) throw std::runtime_error("Device is not created, cannot configure surface.");
+
+	if (renderOutput.headless) {
+		ConfigureOffscreenTarget(core);
+		return;
+	}
+
 	const auto &surface = core.GetResource<wgpu::Surface>();
-	const auto &capabilities = core.GetResource<wgpu::SurfaceCapabilities>();
 	auto &window = core.GetResource<ES::Plugin::Window::Resource::Window>();
 
 	if (surface == nullptr) throw std::runtime_error("Surface is not created, cannot configure it.");
-	if (device == nullptr) throw std::runtime_error("Device is not created, cannot configure surface.");
 
 	int frameBufferSizeX, frameBufferSizeY;
 	glfwGetFramebufferSize(window.GetGLFWWindow(), &frameBufferSizeX, &frameBufferSizeY);
+	renderOutput.size = { static_cast<uint32_t>(frameBufferSizeX), static_cast<uint32_t>(frameBufferSizeY) };
+
 	wgpu::SurfaceConfiguration config(wgpu::Default);
 	config.width = frameBufferSizeX;
 	config.height = frameBufferSizeY;
 	config.usage = wgpu::TextureUsage::RenderAttachment;
-	config.format = capabilities.formats[0];
+	config.format = renderOutput.format;
 	config.viewFormatCount = 0;
 	config.viewFormats = nullptr;
 	config.device = device;
@@ -11,10 +11,7 @@ void Create2DPipelineBuffer(ES::Engine::Core &core)
 	if (queue == nullptr) throw std::runtime_error("WebGPU queue is not created, cannot initialize buffers.");
 	if (device == nullptr) throw std::runtime_error("WebGPU device is not created, cannot initialize buffers.");
 
-	wgpu::BufferDescriptor bufferDesc(wgpu::Default);
-	bufferDesc.size = sizeof(Uniforms2D);
-	bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform;
-	uniform2DBuffer = device.createBuffer(bufferDesc);
+	uniform2DBuffer = core.GetResource<FramesInFlight>().CreateRing(device, "Uniform 2D Buffer", sizeof(Uniforms2D), wgpu::BufferUsage::Uniform);
 
 	Uniforms2D uniforms;
 	uniforms.orthoMatrix = glm::ortho(
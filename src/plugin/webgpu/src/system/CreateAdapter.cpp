@@ -10,10 +10,12 @@ void CreateAdapter(ES::Engine::Core &core) {
 	auto &surface = core.GetResource<wgpu::Surface>();
 
 	if (instance == nullptr) throw std::runtime_error("WebGPU instance is not created, cannot request adapter");
-	if (surface == nullptr) throw std::runtime_error("Surface is not created, cannot request adapter.");
+	bool headless = core.GetResource<RenderOutput>().headless;
+	if (surface == nullptr && !headless) throw std::runtime_error("Surface is not created, cannot request adapter.");
 
+	// Headless, any adapter will do, including software ones (e.g. lavapipe)
 	wgpu::RequestAdapterOptions adapterOpts(wgpu::Default);
-	adapterOpts.compatibleSurface = surface;
+	adapterOpts.compatibleSurface = headless ? nullptr : surface;
 
 	wgpu::Adapter adapter = core.RegisterResource(instance.requestAdapter(adapterOpts));
 
@@ -31,6 +31,7 @@ void CreateBindingGroup(ES::Engine::Core &core)
 	if (bg1 == nullptr) throw std::runtime_error("Could not create WebGPU bind group");
 
 	bindGroups.groups["1"] = bg1;
+	bindGroups.rings["1"] = &uniformBuffer;
 
 	wgpu::BindGroupEntry bindingLights(wgpu::Default);
 	bindingLights.binding = 0;
@@ -49,5 +50,6 @@ void CreateBindingGroup(ES::Engine::Core &core)
 	if (bg2 == nullptr) throw std::runtime_error("Could not create WebGPU bind group");
 
 	bindGroups.groups["2"] = bg2;
+	bindGroups.rings["2"] = &lightsBuffer;
 }
 }
@@ -28,5 +28,6 @@ void CreateBindingGroup2D(ES::Engine::Core &core)
 	if (bg1 == nullptr) throw std::runtime_error("Could not create WebGPU bind group");
 
 	bindGroups.groups["2D"] = bg1;
+	bindGroups.rings["2D"] = &uniform2DBuffer;
 }
 }
@@ -1,14 +1,14 @@
 #include "CreateBindingGroupDeferred.hpp"
 #include "structs.hpp"
+#include "RenderGraph.hpp"
 
-static void SetupBindingGroupDeferred(ES::Engine::Core &core)
+// The G-buffer textures are transient attachments of the render graph, this group is rebuilt each time they are reallocated
+static void SetupBindingGroupDeferredTextures(ES::Engine::Core &core)
 {
 	auto &device = core.GetResource<wgpu::Device>();
 	auto &pipelineData = core.GetResource<Pipelines>().renderPipelines["Deferred"];
 	auto &bindGroups = core.GetResource<BindGroups>();
 	auto &textureManager = core.GetResource<TextureManager>();
-	//TODO: Put this in a separate system
-	//TODO: Should we separate this from pipelineData?
 
 	if (device == nullptr) throw std::runtime_error("WebGPU device is not created, cannot create binding group.");
 
@@ -35,7 +35,17 @@ static void SetupBindingGroupDeferred(ES::Engine::Core &core)
 
 	if (bg0 == nullptr) throw std::runtime_error("Could not create WebGPU bind group");
 
+	if (bindGroups.groups.contains("DeferredGroup0")) bindGroups.groups["DeferredGroup0"].release();
 	bindGroups.groups["DeferredGroup0"] = bg0;
+}
+
+static void SetupBindingGroupDeferredCamera(ES::Engine::Core &core)
+{
+	auto &device = core.GetResource<wgpu::Device>();
+	auto &pipelineData = core.GetResource<Pipelines>().renderPipelines["Deferred"];
+	auto &bindGroups = core.GetResource<BindGroups>();
+
+	if (device == nullptr) throw std::runtime_error("WebGPU device is not created, cannot create binding group.");
 
 	wgpu::BindGroupEntry bindingCamera(wgpu::Default);
 	bindingCamera.binding = 0;
@@ -44,6 +54,7 @@ static void SetupBindingGroupDeferred(ES::Engine::Core &core)
 
 	std::array<wgpu::BindGroupEntry, 1> bindingsCamera = { bindingCamera };
 
+	wgpu::BindGroupDescriptor bindGroupDesc(wgpu::Default);
 	bindGroupDesc.layout = pipelineData.bindGroupLayouts[2];
 	bindGroupDesc.entryCount = bindingsCamera.size();
 	bindGroupDesc.entries = bindingsCamera.data();
@@ -51,21 +62,14 @@ static void SetupBindingGroupDeferred(ES::Engine::Core &core)
 	auto bg2 = device.createBindGroup(bindGroupDesc);
 
 	bindGroups.groups["DeferredGroup2"] = bg2;
+	bindGroups.rings["DeferredGroup2"] = &cameraBuffer;
 }
 
 namespace ES::Plugin::WebGPU::System {
 void CreateBindingGroupDeferred(ES::Engine::Core &core)
 {
-	SetupBindingGroupDeferred(core);
-
-	core.GetResource<WindowResizeCallbacks>().callbacks.push_back([](ES::Engine::Core &core, int width, int height) {
-		auto &bindGroups = core.GetResource<BindGroups>();
-		bindGroups.groups["DeferredGroup0"].release();
-		bindGroups.groups["DeferredGroup2"].release();
-		bindGroups.groups.erase("DeferredGroup0");
-		bindGroups.groups.erase("DeferredGroup2");
+	SetupBindingGroupDeferredCamera(core);
 
-		SetupBindingGroupDeferred(core);
-	});
+	core.GetResource<RenderGraph>().AddTransientTexturesCallback(SetupBindingGroupDeferredTextures);
 }
 }
@@ -22,13 +22,19 @@ void CreateBindingGroupGBuffer(ES::Engine::Core &core) {
     auto bg1 = device.createBindGroup(bindGroupDesc);
     if (bg1 == nullptr) throw std::runtime_error("Could not create WebGPU bind group");
     bindGroups.groups["GBuffer"] = bg1;
+    bindGroups.rings["GBuffer"] = &cameraBuffer;
 
     wgpu::BindGroupEntry bindingUniforms(wgpu::Default);
     bindingUniforms.binding = 0;
     bindingUniforms.buffer = uniformsBuffer;
     bindingUniforms.size = sizeof(Uniforms);
 
-    std::array<wgpu::BindGroupEntry, 1> bindingsUniforms = { bindingUniforms };
+    wgpu::BindGroupEntry bindingInstances(wgpu::Default);
+    bindingInstances.binding = 1;
+    bindingInstances.buffer = instancesBuffer;
+    bindingInstances.size = sizeof(uint32_t);
+
+    std::array<wgpu::BindGroupEntry, 2> bindingsUniforms = { bindingUniforms, bindingInstances };
     bindGroupDesc.layout = pipelineData.bindGroupLayouts[2];
     bindGroupDesc.entryCount = bindingsUniforms.size();
     bindGroupDesc.entries = bindingsUniforms.data();
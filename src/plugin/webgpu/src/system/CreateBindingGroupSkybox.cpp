@@ -37,6 +37,7 @@ static void SetupBindingGroupSkybox(ES::Engine::Core &core)
 	if (bg1 == nullptr) throw std::runtime_error("Could not create WebGPU bind group");
 
 	bindGroups.groups[name] = bg1;
+	bindGroups.rings[name] = &skyboxBuffer;
 }
 
 namespace ES::Plugin::WebGPU::System {
@@ -47,7 +48,6 @@ void CreateBindingGroupSkybox(ES::Engine::Core &core)
 	core.GetResource<WindowResizeCallbacks>().callbacks.push_back([](ES::Engine::Core &core, int width, int height) {
 		auto &bindGroups = core.GetResource<BindGroups>();
 		bindGroups.groups["Skybox"].release();
-		bindGroups.groups.erase("Skybox");
 
 		SetupBindingGroupSkybox(core);
 	});
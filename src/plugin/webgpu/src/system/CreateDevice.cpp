@@ -16,8 +16,15 @@ void CreateDevice(ES::Engine::Core &core) {
 
 	requiredLimits.maxBindGroups = 8;
 
+	// Timestamps are only used by the profiler, the device is still created without them
+	std::vector<WGPUFeatureName> requiredFeatures;
+	if (adapter.hasFeature(wgpu::FeatureName::TimestampQuery)) requiredFeatures.push_back(wgpu::FeatureName::TimestampQuery);
+	// Needed by the GPU culling, meshes are drawn directly without it
+	if (adapter.hasFeature(wgpu::FeatureName::IndirectFirstInstance)) requiredFeatures.push_back(wgpu::FeatureName::IndirectFirstInstance);
+
 	deviceDesc.label = wgpu::StringView("My Device");
-	deviceDesc.requiredFeatureCount = 0;
+	deviceDesc.requiredFeatureCount = requiredFeatures.size();
+	deviceDesc.requiredFeatures = requiredFeatures.data();
 	deviceDesc.requiredLimits = &requiredLimits;
 	deviceDesc.defaultQueue.nextInChain = nullptr;
 	deviceDesc.defaultQueue.label = wgpu::StringView("The default queue");
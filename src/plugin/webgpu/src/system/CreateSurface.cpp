@@ -9,6 +9,13 @@ void CreateSurface(ES::Engine::Core &core) {
 	ES::Utils::Log::Debug("Creating surface...");
 
 	auto &instance = core.GetResource<wgpu::Instance>();
+
+	if (core.GetResource<RenderOutput>().headless) {
+		core.RegisterResource(wgpu::Surface(nullptr));
+		ES::Utils::Log::Debug("Headless, no surface created.");
+		return;
+	}
+
 	auto glfwWindow = core.GetResource<ES::Plugin::Window::Resource::Window>().GetGLFWWindow();
 
 	wgpu::Surface &surface = core.RegisterResource(wgpu::Surface(glfwCreateWindowWGPUSurface(instance, glfwWindow)));
@@ -2,10 +2,16 @@
 
 #include "GetNextSurfaceViewData.hpp"
 #include "structs.hpp"
+#include "CpuProfiler.hpp"
 
 namespace ES::Plugin::WebGPU::System {
 void GenerateSurfaceTexture(ES::Engine::Core &core)
 {
+	ES_PROFILE_ZONE(core, "GenerateSurfaceTexture");
+
+	// Headless, the offscreen texture is rendered to every frame
+	if (core.GetResource<RenderOutput>().headless) return;
+
 	wgpu::Surface &surface = core.GetResource<wgpu::Surface>();
 	ES::Plugin::WebGPU::Util::GetNextSurfaceViewData(core, surface);
 }
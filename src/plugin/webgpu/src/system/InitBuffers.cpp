@@ -1,5 +1,6 @@
 #include "structs.hpp"
 #include "Engine.hpp"
+#include "FramesInFlight.hpp"
 
 
 namespace ES::Plugin::WebGPU::System {
@@ -13,16 +14,12 @@ void InitializeBuffers(ES::Engine::Core &core)
 	if (queue == nullptr) throw std::runtime_error("WebGPU queue is not created, cannot initialize buffers.");
 	if (device == nullptr) throw std::runtime_error("WebGPU device is not created, cannot initialize buffers.");
 
-	wgpu::BufferDescriptor bufferDesc(wgpu::Default);
-	bufferDesc.size = sizeof(MyUniforms);
-	bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform;
-	uniformBuffer = device.createBuffer(bufferDesc);
-
-	wgpu::BufferDescriptor lightsBufferDesc(wgpu::Default);
-	lightsBufferDesc.size = sizeof(Light) + sizeof(uint32_t) + 12 /* (padding) */;
-	lightsBufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage;
-	lightsBufferDesc.label = wgpu::StringView("Lights Buffer");
-	lightsBuffer = device.createBuffer(lightsBufferDesc);
+	// Rewritten every frame, a region per frame in flight
+	auto &framesInFlight = core.GetResource<FramesInFlight>();
+	uniformBuffer = framesInFlight.CreateRing(device, "Uniform Buffer", sizeof(MyUniforms), wgpu::BufferUsage::Uniform);
+	lightsBuffer = framesInFlight.CreateRing(device, "Lights Buffer", sizeof(Light) + sizeof(uint32_t) + 12 /* (padding) */, wgpu::BufferUsage::Storage);
+	// Matrices of the directional lights, UpdateLights recreates it for their count
+	additionalDirectionalLightsBuffer = framesInFlight.CreateRing(device, "Additional Directional Lights Buffer", sizeof(glm::mat4), wgpu::BufferUsage::Uniform);
 
 	// Upload the initial value of the uniforms
 	MyUniforms uniforms;
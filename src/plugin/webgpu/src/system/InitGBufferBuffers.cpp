@@ -1,5 +1,6 @@
 #include "InitGBufferBuffers.hpp"
 #include "structs.hpp"
+#include "FramesInFlight.hpp"
 
 namespace ES::Plugin::WebGPU::System {
 void InitGBufferBuffers(ES::Engine::Core &core) {
@@ -8,17 +9,14 @@ void InitGBufferBuffers(ES::Engine::Core &core) {
     if (queue == nullptr) throw std::runtime_error("WebGPU queue is not created, cannot initialize buffers.");
     if (device == nullptr) throw std::runtime_error("WebGPU device is not created, cannot initialize buffers.");
 
-    wgpu::BufferDescriptor bufferDesc(wgpu::Default);
-    bufferDesc.size = sizeof(Camera);
-    bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform;
-    bufferDesc.label = wgpu::StringView("Camera Buffer for GBuffer");
-    cameraBuffer = device.createBuffer(bufferDesc);
+    cameraBuffer = core.GetResource<FramesInFlight>().CreateRing(device, "Camera Buffer for GBuffer", sizeof(Camera), wgpu::BufferUsage::Uniform);
 
     Camera camera;
     camera.viewProjectionMatrix = glm::mat4(1.0f);
     camera.invViewProjectionMatrix = glm::mat4(1.0f);
     queue.writeBuffer(cameraBuffer, 0, &camera, sizeof(camera));
 
+    wgpu::BufferDescriptor bufferDesc(wgpu::Default);
     bufferDesc.size = sizeof(Uniforms);
     bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage;
     bufferDesc.label = wgpu::StringView("Uniforms Buffer for GBuffer");
@@ -28,5 +26,12 @@ void InitGBufferBuffers(ES::Engine::Core &core) {
     uniforms.modelMatrix = glm::mat4(1.0f);
     uniforms.normalModelMatrix = glm::mat4(1.0f);
     queue.writeBuffer(uniformsBuffer, 0, &uniforms, sizeof(uniforms));
+
+    bufferDesc.size = sizeof(uint32_t);
+    bufferDesc.label = wgpu::StringView("Instances Buffer for GBuffer");
+    instancesBuffer = device.createBuffer(bufferDesc);
+
+    uint32_t instance = 0;
+    queue.writeBuffer(instancesBuffer, 0, &instance, sizeof(instance));
 }
 }
@@ -1,6 +0,0 @@
-#pragma once
-#include "core/Core.hpp"
-
-namespace ES::Plugin::WebGPU::System {
-void InitGBufferTextures(ES::Engine::Core &core);
-}
@@ -1,4 +1,4 @@
-#include "InitGBufferTextures.hpp"
+#include "InitShadowTexture.hpp"
 #include "structs.hpp"
 #include "resource/window/Window.hpp"
 #include "plugin/PluginWindow.hpp"
@@ -33,6 +33,7 @@ void InitShadowTexture(ES::Engine::Core &core) {
 
     textureShadows.texture = device.createTexture(textureDesc);
     textureShadows.textureView = textureShadows.texture.createView(textureViewDesc);
+    shadowLayerViews.push_back(textureShadows.textureView);
 
 
 }
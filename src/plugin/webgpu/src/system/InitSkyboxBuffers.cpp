@@ -1,5 +1,7 @@
-#include "InitGBufferTextures.hpp"
+#include "InitSkyboxBuffers.hpp"
 #include "structs.hpp"
+#include "RenderGraph.hpp"
+#include "FramesInFlight.hpp"
 #include "resource/window/Window.hpp"
 #include "plugin/PluginWindow.hpp"
 #include <GLFW/glfw3.h>
@@ -10,7 +12,6 @@ static void CreateSkyboxBuffers(ES::Engine::Core &core)
 {
     wgpu::Device device = core.GetResource<wgpu::Device>();
     auto &textureManager = core.GetResource<TextureManager>();
-    auto &window = core.GetResource<ES::Plugin::Window::Resource::Window>();
     const std::array<std::string, 6> skyboxFaces = {
         "assets/skybox/right.jpg",
         "assets/skybox/left.jpg",
@@ -85,31 +86,17 @@ static void CreateSkyboxBuffers(ES::Engine::Core &core)
 }
 
 
-static void InitSkyboxOutputTexture(ES::Engine::Core &core)
+// SkyboxOutput is a transient attachment of the render graph, this group is rebuilt each time it is reallocated
+static void CreateSkyboxOutputBindGroup(ES::Engine::Core &core)
 {
     auto &device = core.GetResource<wgpu::Device>();
     auto &pipelineData = core.GetResource<Pipelines>().renderPipelines["Deferred"];
     auto &textureManager = core.GetResource<TextureManager>();
-    auto &window = core.GetResource<ES::Plugin::Window::Resource::Window>();
     auto &bindGroups = core.GetResource<BindGroups>();
 
-    int frameBufferSizeX, frameBufferSizeY;
-    glfwGetFramebufferSize(window.GetGLFWWindow(), &frameBufferSizeX, &frameBufferSizeY);
-
-    auto &texture = textureManager.Add("SkyboxOutput");
-
-    wgpu::TextureDescriptor textureDesc(wgpu::Default);
-    textureDesc.label = wgpu::StringView("SkyboxOutput");
-    textureDesc.size = { static_cast<uint32_t>(frameBufferSizeX), static_cast<uint32_t>(frameBufferSizeY), 1 };
-    textureDesc.format = wgpu::TextureFormat::RGBA16Float;
-    textureDesc.usage = wgpu::TextureUsage::TextureBinding | wgpu::TextureUsage::RenderAttachment;
-
-    texture.texture = device.createTexture(textureDesc);
-    texture.textureView = texture.texture.createView();
-
     wgpu::BindGroupEntry binding(wgpu::Default);
 	binding.binding = 0;
-	binding.textureView = texture.textureView;
+	binding.textureView = textureManager.Get("SkyboxOutput").textureView;
 
     std::array<wgpu::BindGroupEntry, 1> bindings = { binding };
 
@@ -122,6 +109,7 @@ static void InitSkyboxOutputTexture(ES::Engine::Core &core)
 
 	if (bg == nullptr) throw std::runtime_error("Could not create WebGPU bind group");
 
+	if (bindGroups.groups.contains("DeferredGroup4")) bindGroups.groups["DeferredGroup4"].release();
 	bindGroups.groups["DeferredGroup4"] = bg;
 }
 
@@ -144,11 +132,7 @@ static void CreateSkyboxUniformBuffer(ES::Engine::Core &core)
     wgpu::Device device = core.GetResource<wgpu::Device>();
     auto &queue = core.GetResource<wgpu::Queue>();
 
-    wgpu::BufferDescriptor bufferDesc(wgpu::Default);
-    bufferDesc.size = sizeof(glm::mat4);
-    bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Uniform;
-    bufferDesc.label = wgpu::StringView("Skybox Transform Buffer");
-    skyboxBuffer = device.createBuffer(bufferDesc);
+    skyboxBuffer = core.GetResource<FramesInFlight>().CreateRing(device, "Skybox Transform Buffer", sizeof(glm::mat4), wgpu::BufferUsage::Uniform);
 
     glm::mat4 identity = glm::mat4(1.0f);
     queue.writeBuffer(skyboxBuffer, 0, &identity, sizeof(identity));
@@ -176,25 +160,6 @@ void InitSkyboxBuffers(ES::Engine::Core &core) {
     //     CreateSkyboxBuffers(core);
     // });
 
-    InitSkyboxOutputTexture(core);
-
-    core.GetResource<WindowResizeCallbacks>().callbacks.push_back([](ES::Engine::Core &core, int width, int height) {
-        auto &textureManager = core.GetResource<TextureManager>();
-        auto &device = core.GetResource<wgpu::Device>();
-        auto &bindGroups = core.GetResource<BindGroups>();
-
-		{
-			auto &textureNormal = textureManager.Get("SkyboxOutput");
-			textureNormal.textureView.release();
-			textureNormal.texture.destroy();
-			textureNormal.texture.release();
-
-            bindGroups.groups["DeferredGroup4"].release();
-		}
-
-        textureManager.Remove("SkyboxOutput");
-
-		InitSkyboxOutputTexture(core);
-    });
+    core.GetResource<RenderGraph>().AddTransientTexturesCallback(CreateSkyboxOutputBindGroup);
 }
 }
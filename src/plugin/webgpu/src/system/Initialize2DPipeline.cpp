@@ -10,13 +10,10 @@ namespace ES::Plugin::WebGPU::System {
 void Initialize2DPipeline(ES::Engine::Core &core)
 {
 	auto &device = core.GetResource<wgpu::Device>();
-	auto &surface = core.GetResource<wgpu::Surface>();
-	auto &window = core.GetResource<ES::Plugin::Window::Resource::Window>();
-	wgpu::TextureFormat surfaceFormat = core.GetResource<wgpu::SurfaceCapabilities>().formats[0];
+	wgpu::TextureFormat surfaceFormat = core.GetResource<RenderOutput>().format;
 
 
 	if (device == nullptr) throw std::runtime_error("WebGPU device is not created, cannot initialize 2D pipeline.");
-	if (surface == nullptr) throw std::runtime_error("WebGPU surface is not created, cannot initialize 2D pipeline.");
 
 	wgpu::RenderPipelineDescriptor pipelineDesc(wgpu::Default);
 	pipelineDesc.label = wgpu::StringView("2D Render Pipeline");
@@ -28,28 +25,7 @@ void Initialize2DPipeline(ES::Engine::Core &core)
     shaderDesc.nextInChain = &wgslDesc.chain; // connect the chained extension
     shaderDesc.label = wgpu::StringView("Shader source from Application.cpp");
 	wgpu::ShaderModule shaderModule = device.createShaderModule(shaderDesc);
-	wgpu::VertexBufferLayout vertexBufferLayout(wgpu::Default);
-
-	std::vector<wgpu::VertexAttribute> vertexAttribs(3);
-
-    // Describe the position attribute
-    vertexAttribs[0].shaderLocation = 0;
-    vertexAttribs[0].format = wgpu::VertexFormat::Float32x3;
-    vertexAttribs[0].offset = 0;
-
-	vertexAttribs[1].shaderLocation = 1;
-	vertexAttribs[1].format = wgpu::VertexFormat::Float32x3;
-	vertexAttribs[1].offset = 3 * sizeof(float); // Offset by the size of the position attribute
-
-	vertexAttribs[2].shaderLocation = 2;
-	vertexAttribs[2].format = wgpu::VertexFormat::Float32x2;
-	vertexAttribs[2].offset = 6 * sizeof(float); // Offset by the size of the position attribute
-
-    vertexBufferLayout.attributeCount = static_cast<uint32_t>(vertexAttribs.size());
-    vertexBufferLayout.attributes = vertexAttribs.data();
-
-    vertexBufferLayout.arrayStride = (8 * sizeof(float));
-    vertexBufferLayout.stepMode = wgpu::VertexStepMode::Vertex;
+	wgpu::VertexBufferLayout vertexBufferLayout = GeometryPool::GetVertexBufferLayout(GeometryPool::VertexFormat::Float32);
 
 		// TODO: find why it does not work with wgpu::BindGroupLayoutEntry
 	WGPUBindGroupLayoutEntry bindingLayout = {0};
@@ -57,6 +33,7 @@ void Initialize2DPipeline(ES::Engine::Core &core)
 	bindingLayout.visibility = wgpu::ShaderStage::Vertex;
 	bindingLayout.buffer.type = wgpu::BufferBindingType::Uniform;
 	bindingLayout.buffer.minBindingSize = sizeof(Uniforms2D);
+	bindingLayout.buffer.hasDynamicOffset = true; // FramesInFlight ring
 
 	std::array<WGPUBindGroupLayoutEntry, 1> uniformsBindings = { bindingLayout };
 
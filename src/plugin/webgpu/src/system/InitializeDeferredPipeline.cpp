@@ -67,6 +67,7 @@ void InitializeDeferredPipeline(ES::Engine::Core &core)
 	bindingLayoutLights.visibility = wgpu::ShaderStage::Fragment;
 	bindingLayoutLights.buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
 	bindingLayoutLights.buffer.minBindingSize = sizeof(uint32_t) + 12 /* (padding) */ + sizeof(Light);
+	bindingLayoutLights.buffer.hasDynamicOffset = true; // FramesInFlight ring
 
 	std::array<WGPUBindGroupLayoutEntry, 1> bindingsLights = { bindingLayoutLights };
 
@@ -82,6 +83,7 @@ void InitializeDeferredPipeline(ES::Engine::Core &core)
 	bindingLayoutCamera.visibility = wgpu::ShaderStage::Fragment;
 	bindingLayoutCamera.buffer.type = wgpu::BufferBindingType::Uniform;
 	bindingLayoutCamera.buffer.minBindingSize = sizeof(glm::mat4) * 2 + sizeof(glm::vec3) + sizeof(float);
+	bindingLayoutCamera.buffer.hasDynamicOffset = true; // FramesInFlight ring
 
 	std::array<WGPUBindGroupLayoutEntry, 1> bindingsCamera = { bindingLayoutCamera };
 
@@ -7,7 +7,7 @@ namespace ES::Plugin::WebGPU::System {
 void InitializeEndPostProcessPipeline(ES::Engine::Core &core)
 {
 	wgpu::Device device = core.GetResource<wgpu::Device>();
-	wgpu::TextureFormat surfaceFormat = core.GetResource<wgpu::SurfaceCapabilities>().formats[0];
+	wgpu::TextureFormat surfaceFormat = core.GetResource<RenderOutput>().format;
 
 	wgpu::ShaderSourceWGSL wgslDesc(wgpu::Default);
 	std::string wgslSource = loadFile("./assets/shader/shaderEndPostProcess.wgsl");
@@ -26,39 +26,20 @@ void InitializeGBufferPipeline(ES::Engine::Core &core) {
     shaderDesc.label = wgpu::StringView("Shader source GBuffer");
     wgpu::ShaderModule shaderModule = device.createShaderModule(shaderDesc);
 
-    std::vector<wgpu::VertexAttribute> vertexAttribs(3);
-    vertexAttribs[0].shaderLocation = 0;
-    vertexAttribs[0].offset = 0;
-    vertexAttribs[0].format = wgpu::VertexFormat::Float32x3;
-    vertexAttribs[1].shaderLocation = 1;
-    vertexAttribs[1].offset = 3 * sizeof(float);
-    vertexAttribs[1].format = wgpu::VertexFormat::Float32x3;
-    vertexAttribs[2].shaderLocation = 2;
-    vertexAttribs[2].offset = 6 * sizeof(float);
-    vertexAttribs[2].format = wgpu::VertexFormat::Float32x2;
-
-    wgpu::VertexBufferLayout vertexBufferLayout(wgpu::Default);
-    vertexBufferLayout.attributeCount = static_cast<uint32_t>(vertexAttribs.size());
-    vertexBufferLayout.attributes = vertexAttribs.data();
-    vertexBufferLayout.arrayStride = (8 * sizeof(float));
-    vertexBufferLayout.stepMode = wgpu::VertexStepMode::Vertex;
-
-    std::vector<wgpu::VertexAttribute> vertexAttribsUniformsIndex(1);
-    vertexAttribsUniformsIndex[0].shaderLocation = 3;
-    vertexAttribsUniformsIndex[0].offset = 0;
-    vertexAttribsUniformsIndex[0].format = wgpu::VertexFormat::Uint32;
-
-    wgpu::VertexBufferLayout vertexBufferLayoutUniformsIndex(wgpu::Default);
-    vertexBufferLayoutUniformsIndex.attributeCount = static_cast<uint32_t>(vertexAttribsUniformsIndex.size());
-    vertexBufferLayoutUniformsIndex.attributes = vertexAttribsUniformsIndex.data();
-    vertexBufferLayoutUniformsIndex.arrayStride = sizeof(uint32_t);
-    vertexBufferLayoutUniformsIndex.stepMode = wgpu::VertexStepMode::Instance;
+    // Packed vertices need the decoding of their normals, their positions are mapped back by the model matrix
+    GeometryPool::VertexFormat vertexFormat = core.GetResource<GeometryPool>().GetFormat3D();
+    wgpu::VertexBufferLayout vertexBufferLayout = GeometryPool::GetVertexBufferLayout(vertexFormat);
+
+    wgpu::ConstantEntry packedVerticesConstant(wgpu::Default);
+    packedVerticesConstant.key = wgpu::StringView("PACKED_VERTICES");
+    packedVerticesConstant.value = vertexFormat == GeometryPool::VertexFormat::Packed ? 1.0 : 0.0;
 
     WGPUBindGroupLayoutEntry bindingLayoutCamera = {0};
     bindingLayoutCamera.binding = 0;
     bindingLayoutCamera.visibility = wgpu::ShaderStage::Vertex;
     bindingLayoutCamera.buffer.type = wgpu::BufferBindingType::Uniform;
     bindingLayoutCamera.buffer.minBindingSize = sizeof(glm::mat4) * 2 + sizeof(glm::vec3) + sizeof(float);
+    bindingLayoutCamera.buffer.hasDynamicOffset = true; // FramesInFlight ring
 
     std::array<WGPUBindGroupLayoutEntry, 1> cameraBindings = { bindingLayoutCamera };
 
@@ -92,7 +73,13 @@ void InitializeGBufferPipeline(ES::Engine::Core &core) {
     bindingLayoutUniforms.buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
     bindingLayoutUniforms.buffer.minBindingSize = sizeof(glm::mat4) * 2;
 
-    std::array<WGPUBindGroupLayoutEntry, 1> uniformsBindings = { bindingLayoutUniforms };
+    WGPUBindGroupLayoutEntry bindingLayoutInstances = {0};
+    bindingLayoutInstances.binding = 1;
+    bindingLayoutInstances.visibility = wgpu::ShaderStage::Vertex;
+    bindingLayoutInstances.buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+    bindingLayoutInstances.buffer.minBindingSize = sizeof(uint32_t);
+
+    std::array<WGPUBindGroupLayoutEntry, 2> uniformsBindings = { bindingLayoutUniforms, bindingLayoutInstances };
 
     bindGroupLayoutDesc.entryCount = uniformsBindings.size();
     bindGroupLayoutDesc.entries = uniformsBindings.data();
@@ -106,12 +93,14 @@ void InitializeGBufferPipeline(ES::Engine::Core &core) {
     layoutDesc.bindGroupLayouts = bindGroupLayouts.data();
     wgpu::PipelineLayout layout = device.createPipelineLayout(layoutDesc);
 
-    std::array<WGPUVertexBufferLayout, 2> vertexBuffers = { vertexBufferLayout, vertexBufferLayoutUniformsIndex };
 
-    pipelineDesc.vertex.bufferCount = vertexBuffers.size();
-    pipelineDesc.vertex.buffers = vertexBuffers.data();
+    // The uniforms slot is read from the instances buffer at the instance index, offset by the firstInstance of each draw
+    pipelineDesc.vertex.bufferCount = 1;
+    pipelineDesc.vertex.buffers = &vertexBufferLayout;
     pipelineDesc.vertex.module = shaderModule;
     pipelineDesc.vertex.entryPoint = wgpu::StringView("vs_main");
+    pipelineDesc.vertex.constantCount = 1;
+    pipelineDesc.vertex.constants = &packedVerticesConstant;
 
     wgpu::FragmentState fragmentState(wgpu::Default);
     fragmentState.module = shaderModule;
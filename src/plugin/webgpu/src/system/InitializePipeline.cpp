@@ -8,7 +8,7 @@ namespace ES::Plugin::WebGPU::System {
 void InitializePipeline(ES::Engine::Core &core)
 {
 	wgpu::Device device = core.GetResource<wgpu::Device>();
-	wgpu::TextureFormat surfaceFormat = core.GetResource<wgpu::SurfaceCapabilities>().formats[0];
+	wgpu::TextureFormat surfaceFormat = core.GetResource<RenderOutput>().format;
 
 	if (device == nullptr) throw std::runtime_error("WebGPU device is not created, cannot initialize pipeline.");
 
@@ -23,30 +23,7 @@ void InitializePipeline(ES::Engine::Core &core)
 	wgpu::ShaderModule shaderModule = device.createShaderModule(shaderDesc);
 	wgpu::RenderPipelineDescriptor pipelineDesc(wgpu::Default);
 	pipelineDesc.label = wgpu::StringView("My Render Pipeline");
-	wgpu::VertexBufferLayout vertexBufferLayout(wgpu::Default);
-
-	std::vector<wgpu::VertexAttribute> vertexAttribs(3);
-
-    // Describe the position attribute
-    vertexAttribs[0].shaderLocation = 0;
-    vertexAttribs[0].format = wgpu::VertexFormat::Float32x3;
-    vertexAttribs[0].offset = 0;
-
-    // Describe the color attribute
-    vertexAttribs[1].shaderLocation = 1;
-    vertexAttribs[1].format = wgpu::VertexFormat::Float32x3;
-    vertexAttribs[1].offset = 3 * sizeof(float);
-
-	// Describe the texture coordinate attribute
-	vertexAttribs[2].shaderLocation = 2;
-	vertexAttribs[2].format = wgpu::VertexFormat::Float32x2;
-	vertexAttribs[2].offset = 6 * sizeof(float);
-
-    vertexBufferLayout.attributeCount = static_cast<uint32_t>(vertexAttribs.size());
-    vertexBufferLayout.attributes = vertexAttribs.data();
-
-    vertexBufferLayout.arrayStride = 8 * sizeof(float);
-    vertexBufferLayout.stepMode = wgpu::VertexStepMode::Vertex;
+	wgpu::VertexBufferLayout vertexBufferLayout = GeometryPool::GetVertexBufferLayout(GeometryPool::VertexFormat::Float32);
 
 	// TODO: find why it does not work with wgpu::BindGroupLayoutEntry
 	WGPUBindGroupLayoutEntry bindingLayout = {0};
@@ -54,6 +31,7 @@ void InitializePipeline(ES::Engine::Core &core)
 	bindingLayout.visibility = wgpu::ShaderStage::Vertex | wgpu::ShaderStage::Fragment;
 	bindingLayout.buffer.type = wgpu::BufferBindingType::Uniform;
 	bindingLayout.buffer.minBindingSize = sizeof(MyUniforms);
+	bindingLayout.buffer.hasDynamicOffset = true; // FramesInFlight ring
 
 	std::array<WGPUBindGroupLayoutEntry, 1> bindings = { bindingLayout };
 
@@ -68,6 +46,7 @@ void InitializePipeline(ES::Engine::Core &core)
 	bindingLayoutLights.visibility = wgpu::ShaderStage::Fragment;
 	bindingLayoutLights.buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
 	bindingLayoutLights.buffer.minBindingSize = sizeof(uint32_t) + 12 /* (padding) */ + sizeof(Light);
+	bindingLayoutLights.buffer.hasDynamicOffset = true; // FramesInFlight ring
 
 	std::array<WGPUBindGroupLayoutEntry, 1> bindingsLights = { bindingLayoutLights };
 
@@ -104,8 +83,6 @@ void InitializePipeline(ES::Engine::Core &core)
     pipelineDesc.fragment = &fragmentState;
 	pipelineDesc.layout = layout;
 
-	auto &window = core.GetResource<ES::Plugin::Window::Resource::Window>();
-
 	wgpu::DepthStencilState depthStencilState(wgpu::Default);
 	depthStencilState.depthCompare = wgpu::CompareFunction::Less;
 	depthStencilState.depthWriteEnabled = wgpu::OptionalBool::True;
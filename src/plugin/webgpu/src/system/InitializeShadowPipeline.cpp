@@ -8,7 +8,7 @@ void InitializeShadowPipeline(ES::Engine::Core &core)
 {
 	const std::string passName = "ShadowPass";
 	wgpu::Device device = core.GetResource<wgpu::Device>();
-	wgpu::TextureFormat surfaceFormat = core.GetResource<wgpu::SurfaceCapabilities>().formats[0];
+	wgpu::TextureFormat surfaceFormat = core.GetResource<RenderOutput>().format;
 
 	if (device == nullptr) throw std::runtime_error("WebGPU device is not created, cannot initialize pipeline.");
 
@@ -24,33 +24,8 @@ void InitializeShadowPipeline(ES::Engine::Core &core)
 	wgpu::RenderPipelineDescriptor pipelineDesc(wgpu::Default);
 	pipelineDesc.label = wgpu::StringView("My Shadow Render Pipeline");
 
-	std::vector<wgpu::VertexAttribute> vertexAttribs(3);
-    vertexAttribs[0].shaderLocation = 0;
-    vertexAttribs[0].offset = 0;
-    vertexAttribs[0].format = wgpu::VertexFormat::Float32x3;
-    vertexAttribs[1].shaderLocation = 1;
-    vertexAttribs[1].offset = 3 * sizeof(float);
-    vertexAttribs[1].format = wgpu::VertexFormat::Float32x3;
-    vertexAttribs[2].shaderLocation = 2;
-    vertexAttribs[2].offset = 6 * sizeof(float);
-    vertexAttribs[2].format = wgpu::VertexFormat::Float32x2;
-
-    wgpu::VertexBufferLayout vertexBufferLayout(wgpu::Default);
-    vertexBufferLayout.attributeCount = static_cast<uint32_t>(vertexAttribs.size());
-    vertexBufferLayout.attributes = vertexAttribs.data();
-    vertexBufferLayout.arrayStride = (8 * sizeof(float));
-    vertexBufferLayout.stepMode = wgpu::VertexStepMode::Vertex;
-
-    std::vector<wgpu::VertexAttribute> vertexAttribsTransformsIndex(1);
-    vertexAttribsTransformsIndex[0].shaderLocation = 3;
-    vertexAttribsTransformsIndex[0].offset = 0;
-    vertexAttribsTransformsIndex[0].format = wgpu::VertexFormat::Uint32;
-
-	wgpu::VertexBufferLayout vertexBufferLayoutTransformsIndex(wgpu::Default);
-    vertexBufferLayoutTransformsIndex.attributeCount = static_cast<uint32_t>(vertexAttribsTransformsIndex.size());
-    vertexBufferLayoutTransformsIndex.attributes = vertexAttribsTransformsIndex.data();
-    vertexBufferLayoutTransformsIndex.arrayStride = sizeof(uint32_t);
-    vertexBufferLayoutTransformsIndex.stepMode = wgpu::VertexStepMode::Vertex;
+    // Packed positions are mapped back by the model matrix, the shadow pass does not read anything else
+    wgpu::VertexBufferLayout vertexBufferLayout = GeometryPool::GetVertexBufferLayout(core.GetResource<GeometryPool>().GetFormat3D());
 
     WGPUBindGroupLayoutEntry transformsBindingLayout = {0};
     transformsBindingLayout.binding = 0;
@@ -58,7 +33,14 @@ void InitializeShadowPipeline(ES::Engine::Core &core)
     transformsBindingLayout.buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
     transformsBindingLayout.buffer.minBindingSize = sizeof(glm::mat4) * 2;
 
-    std::array<WGPUBindGroupLayoutEntry, 1> transformsBindings = { transformsBindingLayout };
+    // Same layout as the GBuffer uniforms, the shadow passes use its bind group
+    WGPUBindGroupLayoutEntry instancesBindingLayout = {0};
+    instancesBindingLayout.binding = 1;
+    instancesBindingLayout.visibility = wgpu::ShaderStage::Vertex;
+    instancesBindingLayout.buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+    instancesBindingLayout.buffer.minBindingSize = sizeof(uint32_t);
+
+    std::array<WGPUBindGroupLayoutEntry, 2> transformsBindings = { transformsBindingLayout, instancesBindingLayout };
 
 	wgpu::BindGroupLayoutDescriptor transformBindGroupLayoutDesc(wgpu::Default);
     transformBindGroupLayoutDesc.entryCount = transformsBindings.size();
@@ -71,6 +53,7 @@ void InitializeShadowPipeline(ES::Engine::Core &core)
     shadowDataBindingLayoutUniforms.visibility = wgpu::ShaderStage::Vertex;
     shadowDataBindingLayoutUniforms.buffer.type = wgpu::BufferBindingType::Uniform;
     shadowDataBindingLayoutUniforms.buffer.minBindingSize = sizeof(glm::mat4);
+    shadowDataBindingLayoutUniforms.buffer.hasDynamicOffset = true; // FramesInFlight ring
 
     std::array<WGPUBindGroupLayoutEntry, 1> shadowBindings = { shadowDataBindingLayoutUniforms };
 
@@ -96,10 +79,10 @@ void InitializeShadowPipeline(ES::Engine::Core &core)
 	layoutDesc.bindGroupLayouts = bindGroupLayouts.data();
 	wgpu::PipelineLayout layout = device.createPipelineLayout(layoutDesc);
 
-	std::array<WGPUVertexBufferLayout, 2> vertexBuffers = { vertexBufferLayout, vertexBufferLayoutTransformsIndex };
 
-    pipelineDesc.vertex.bufferCount = static_cast<uint32_t>(vertexBuffers.size());
-    pipelineDesc.vertex.buffers = vertexBuffers.data();
+    // The transform slot is read from the instances buffer at the instance index, offset by the firstInstance of each draw
+    pipelineDesc.vertex.bufferCount = 1;
+    pipelineDesc.vertex.buffers = &vertexBufferLayout;
 	pipelineDesc.vertex.module = shaderModule;
     pipelineDesc.vertex.entryPoint = wgpu::StringView("vs_main");
 
@@ -117,8 +100,6 @@ void InitializeShadowPipeline(ES::Engine::Core &core)
     pipelineDesc.fragment = &fragmentState;
 	pipelineDesc.layout = layout;
 
-	auto &window = core.GetResource<ES::Plugin::Window::Resource::Window>();
-
 	wgpu::DepthStencilState depthStencilState(wgpu::Default);
 	depthStencilState.depthCompare = wgpu::CompareFunction::Less;
 	depthStencilState.depthWriteEnabled = wgpu::OptionalBool::True;
@@ -9,14 +9,11 @@ namespace ES::Plugin::WebGPU::System {
 void InitializeSkyboxPipeline(ES::Engine::Core &core)
 {
 	auto &device = core.GetResource<wgpu::Device>();
-	auto &surface = core.GetResource<wgpu::Surface>();
-	auto &window = core.GetResource<ES::Plugin::Window::Resource::Window>();
-	wgpu::TextureFormat surfaceFormat = core.GetResource<wgpu::SurfaceCapabilities>().formats[0];
+	wgpu::TextureFormat surfaceFormat = core.GetResource<RenderOutput>().format;
 	const std::string pipelineName = "Skybox";
 	const std::string shaderfilePath = "./assets/shader/shaderSkybox.wgsl";
 
 	if (device == nullptr) throw std::runtime_error(fmt::format("WebGPU device is not created, cannot initialize {} pipeline.", pipelineName));
-	if (surface == nullptr) throw std::runtime_error(fmt::format("WebGPU surface is not created, cannot initialize {} pipeline.", pipelineName));
 
 	wgpu::RenderPipelineDescriptor pipelineDesc(wgpu::Default);
 	pipelineDesc.label = wgpu::StringView(fmt::format("{} Render Pipeline", pipelineName));
@@ -48,6 +45,7 @@ void InitializeSkyboxPipeline(ES::Engine::Core &core)
 	uniformBindingLayout.visibility = wgpu::ShaderStage::Vertex;
 	uniformBindingLayout.buffer.type = wgpu::BufferBindingType::Uniform;
 	uniformBindingLayout.buffer.minBindingSize = sizeof(glm::mat4);
+	uniformBindingLayout.buffer.hasDynamicOffset = true; // FramesInFlight ring
 
 	WGPUBindGroupLayoutEntry textureBindingLayout = {0};
 	textureBindingLayout.binding = 1;
@@ -5,8 +5,15 @@ namespace ES::Plugin::WebGPU::System {
 
 void ReleaseBuffers(ES::Engine::Core &core)
 {
-	core.GetRegistry().view<ES::Plugin::WebGPU::Component::Mesh>().each([](ES::Plugin::WebGPU::Component::Mesh &mesh) {
-		mesh.Release();
+	core.GetRegistry().view<ES::Plugin::WebGPU::Component::Mesh>().each([&core](ES::Plugin::WebGPU::Component::Mesh &mesh) {
+		mesh.Release(core);
 	});
 }
+
+void ReleaseDestroyedMesh(ES::Engine::Core &core, entt::registry &registry, entt::entity entity)
+{
+	// Meshes destroyed with the registry at exit were released by ReleaseBuffers, the resources may already be gone
+	auto &mesh = registry.get<ES::Plugin::WebGPU::Component::Mesh>(entity);
+	if (!mesh.IsReleased()) mesh.Release(core);
+}
 }
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "core/Core.hpp"
+#include <entt/entt.hpp>
 
 namespace ES::Plugin::WebGPU::System {
 
 void ReleaseBuffers(ES::Engine::Core &core);
+// Connected to the destruction of Mesh components (entity destroyed or component removed) by the plugin
+void ReleaseDestroyedMesh(ES::Engine::Core &core, entt::registry &registry, entt::entity entity);
 }
@@ -5,6 +5,14 @@ namespace ES::Plugin::WebGPU::System {
 void ReleaseSurface(ES::Engine::Core &core)
 {
 	wgpu::Surface &surface = core.GetResource<wgpu::Surface>();
+	auto &textureManager = core.GetResource<TextureManager>();
+
+	if (core.GetResource<RenderOutput>().headless && textureManager.Contains("WindowColorTexture")) {
+		Texture &offscreen = textureManager.Get("WindowColorTexture");
+		offscreen.textureView.release();
+		offscreen.texture.release();
+		textureManager.Remove("WindowColorTexture");
+	}
 
 	if (surface) {
 		surface.unconfigure();
@@ -1,5 +1,6 @@
 #include "ReleaseUniforms.hpp"
 #include "structs.hpp"
+#include "TransformUniforms.hpp"
 
 namespace ES::Plugin::WebGPU::System {
 void ReleaseUniforms(ES::Engine::Core &core)
@@ -8,5 +9,14 @@ void ReleaseUniforms(ES::Engine::Core &core)
 		uniformBuffer.release();
 		uniformBuffer = nullptr;
 	}
+	if (uniformsBuffer) {
+		uniformsBuffer.release();
+		uniformsBuffer = nullptr;
+	}
+	if (instancesBuffer) {
+		instancesBuffer.release();
+		instancesBuffer = nullptr;
+	}
+	core.GetResource<TransformUniforms>().Release();
 }
 }
@@ -6,6 +6,11 @@ namespace ES::Plugin::WebGPU::System {
 
 void Render(ES::Engine::Core &core)
 {
+    ES_PROFILE_ZONE(core, "Render");
+
+    // Nothing to present, the offscreen texture is kept for the next frames
+    if (core.GetResource<RenderOutput>().headless) return;
+
     wgpu::Surface &surface = core.GetResource<wgpu::Surface>();
 
     // Stop having access to the texture view after the render pass is done
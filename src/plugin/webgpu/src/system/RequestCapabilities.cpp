@@ -6,6 +6,9 @@ void RequestCapabilities(ES::Engine::Core &core)
 {
 	const auto &adapter = core.GetResource<wgpu::Adapter>();
 	const wgpu::Surface &surface = core.GetResource<wgpu::Surface>();
+	auto &renderOutput = core.GetResource<RenderOutput>();
+
+	if (renderOutput.headless) return;
 
 	if (adapter == nullptr) throw std::runtime_error("Adapter is not created, cannot request capabilities.");
 	if (surface == nullptr) throw std::runtime_error("Surface is not created, cannot request capabilities.");
@@ -14,6 +17,9 @@ void RequestCapabilities(ES::Engine::Core &core)
 
 	surface.getCapabilities(adapter, &capabilities);
 
+	if (capabilities.formatCount == 0) throw std::runtime_error("Surface has no supported format.");
+	renderOutput.format = capabilities.formats[0];
+
 	core.RegisterResource(std::move(capabilities));
 }
 }
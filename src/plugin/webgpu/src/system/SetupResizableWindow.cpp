@@ -39,6 +39,8 @@ static void updateSurface(ES::Engine::Core &core, int width, int height) {
 
 void SetupResizableWindow(ES::Engine::Core &core) {
 	auto &windowResizeCallbacks = core.RegisterResource(WindowResizeCallbacks());
+	if (core.GetResource<RenderOutput>().headless) return;
+
 	core.GetResource<ES::Plugin::Window::Resource::Window>().SetResizable(true);
 	core.GetResource<ES::Plugin::Window::Resource::Window>().SetFramebufferSizeCallback(&core, onResize);
 
@@ -5,55 +5,68 @@
 #include "component/Transform.hpp"
 
 void ES::Plugin::WebGPU::System::UpdateBufferUniforms(ES::Engine::Core &core) {
+	ES_PROFILE_ZONE(core, "UpdateBufferUniforms");
+
 	auto &device = core.GetResource<wgpu::Device>();
     auto &pipelineData = core.GetResource<Pipelines>().renderPipelines["GBuffer"];
     auto &bindGroups = core.GetResource<BindGroups>();
     auto &queue = core.GetResource<wgpu::Queue>();
-	size_t entityCount = 0;
 
-	core.GetRegistry().view<ES::Plugin::WebGPU::Component::Mesh, ES::Plugin::Object::Component::Transform>().each([&](auto entity, ES::Plugin::WebGPU::Component::Mesh &mesh, ES::Plugin::Object::Component::Transform &transform) {
-		if (mesh.pipelineType != PipelineType::_3D || !mesh.enabled)
-			return;
-		entityCount++;
-	});
+	// Instances are numbered batch by batch, meshes drawn together are next to each other
+	auto &instanceBatches = core.GetResource<InstanceBatches>();
+	size_t entityCount = instanceBatches.Build(core);
+
+	auto &transformUniforms = core.GetResource<TransformUniforms>();
+	bool recreateUniforms = transformUniforms.Reserve(device, uniformsBuffer);
 
-	size_t offset = 0;
+	// Region 0 of the instances buffer maps each instance to the slot of its mesh, the following ones are filled by the
+	// GPU culling with the visible slots of each view. Like the uniforms, it grows geometrically.
+	size_t instanceRegions = 1 + GpuCulling::FirstLightView + additionalDirectionalLights.size();
+	size_t instancesSize = sizeof(uint32_t) * std::max(entityCount, size_t(1)) * instanceRegions;
+	bool recreateInstances = instancesBuffer == nullptr || instancesBuffer.getSize() < instancesSize;
 
-	if (uniformsBuffer.getSize() == sizeof(Uniforms) * entityCount) {
-		core.GetRegistry().view<ES::Plugin::WebGPU::Component::Mesh, ES::Plugin::Object::Component::Transform>().each([&](auto entity, ES::Plugin::WebGPU::Component::Mesh &mesh, ES::Plugin::Object::Component::Transform &transform) {
-			if (mesh.pipelineType != PipelineType::_3D || !mesh.enabled)
-				return;
-			Uniforms uniforms;
-			uniforms.modelMatrix = transform.getTransformationMatrix();
-			uniforms.normalModelMatrix = glm::transpose(glm::inverse(uniforms.modelMatrix));
-			queue.writeBuffer(uniformsBuffer, offset, &uniforms, sizeof(Uniforms));
-			offset += sizeof(Uniforms);
-		});
-		return;
+	if (recreateInstances) {
+		size_t capacity = instancesBuffer != nullptr ? instancesBuffer.getSize() * 2 : 0;
+		if (instancesBuffer) instancesBuffer.release();
+		wgpu::BufferDescriptor bufferDesc(wgpu::Default);
+		bufferDesc.size = std::max({ instancesSize, capacity, sizeof(uint32_t) * TransformUniforms::MinCapacity * instanceRegions });
+		bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage;
+		bufferDesc.label = wgpu::StringView("Instances Buffer for GBuffer");
+		instancesBuffer = device.createBuffer(bufferDesc);
 	}
 
-	wgpu::BufferDescriptor bufferDesc(wgpu::Default);
-	bufferDesc.size = sizeof(Uniforms) * std::max(entityCount, size_t(1));
-    bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage;
-    bufferDesc.label = wgpu::StringView("Uniforms Buffer for GBuffer");
-    uniformsBuffer = device.createBuffer(bufferDesc);
+	// Only rewritten when the batches changed, the other regions start past the instance count
+	const auto &instanceSlots = instanceBatches.GetInstanceSlots();
+	if ((recreateInstances || instanceBatches.InstancesChanged()) && !instanceSlots.empty()) {
+		queue.writeBuffer(instancesBuffer, 0, instanceSlots.data(), instanceSlots.size() * sizeof(uint32_t));
+		core.GetResource<FrameStats>().RecordUpload(instanceSlots.size() * sizeof(uint32_t));
+	}
 
-	core.GetRegistry().view<ES::Plugin::WebGPU::Component::Mesh, ES::Plugin::Object::Component::Transform>().each([&](auto entity, ES::Plugin::WebGPU::Component::Mesh &mesh, ES::Plugin::Object::Component::Transform &transform) {
-		if (mesh.pipelineType != PipelineType::_3D || !mesh.enabled)
+	// Slots do not move, only the meshes that moved are recomputed and uploaded
+	core.GetRegistry().view<ES::Plugin::WebGPU::Component::Mesh, ES::Plugin::Object::Component::Transform>().each([&](ES::Plugin::WebGPU::Component::Mesh &mesh, ES::Plugin::Object::Component::Transform &transform) {
+		if (mesh.pipelineType != PipelineType::_3D || !mesh.enabled || mesh.transformIndex == TransformUniforms::InvalidSlot)
 			return;
-		Uniforms uniforms;
-		uniforms.modelMatrix = transform.getTransformationMatrix();
-		uniforms.normalModelMatrix = glm::transpose(glm::inverse(uniforms.modelMatrix));
-		queue.writeBuffer(uniformsBuffer, offset, &uniforms, sizeof(Uniforms));
-		offset += sizeof(Uniforms);
+		transformUniforms.Set(mesh.transformIndex, transform.position, transform.rotation, transform.scale, mesh.GetVertexToLocal());
 	});
+	// Crowds of moving meshes are computed by the workers of the render graph, which are idle until it records. With GPU
+	// expansion there is nothing to compute here, Upload dispatches it.
+	bool parallel = transformUniforms.GetPendingCount() > ES::Plugin::WebGPU::Util::TransformKernelParallelThreshold;
+	transformUniforms.Compute(parallel ? &core.GetResource<RenderGraph>().GetThreadPool() : nullptr);
+	core.GetResource<FrameStats>().RecordUpload(transformUniforms.Upload(device, queue, uniformsBuffer));
+
+	if (!recreateUniforms && !recreateInstances) return;
 
 	wgpu::BindGroupEntry bindingUniforms(wgpu::Default);
     bindingUniforms.binding = 0;
     bindingUniforms.buffer = uniformsBuffer;
-    bindingUniforms.size = sizeof(Uniforms) * entityCount;
+    bindingUniforms.size = uniformsBuffer.getSize();
+
+	wgpu::BindGroupEntry bindingInstances(wgpu::Default);
+    bindingInstances.binding = 1;
+    bindingInstances.buffer = instancesBuffer;
+    bindingInstances.size = instancesBuffer.getSize();
 
-    std::array<wgpu::BindGroupEntry, 1> bindingsUniforms = { bindingUniforms };
+    std::array<wgpu::BindGroupEntry, 2> bindingsUniforms = { bindingUniforms, bindingInstances };
 	wgpu::BindGroupDescriptor bindGroupDesc(wgpu::Default);
 	bindGroupDesc.layout = pipelineData.bindGroupLayouts[2];
     bindGroupDesc.entryCount = bindingsUniforms.size();
@@ -61,5 +74,7 @@ void ES::Plugin::WebGPU::System::UpdateBufferUniforms(ES::Engine::Core &core) {
     bindGroupDesc.label = wgpu::StringView("GBuffer Binding Group Uniforms");
     auto bg2 = device.createBindGroup(bindGroupDesc);
     if (bg2 == nullptr) throw std::runtime_error("Could not create WebGPU bind group");
+    if (bindGroups.groups["GBufferUniforms"]) bindGroups.groups["GBufferUniforms"].release();
     bindGroups.groups["GBufferUniforms"] = bg2;
+    core.GetResource<RenderGraph>().InvalidateRecordedCommands();
 }
@@ -1,7 +1,7 @@
 #include "WebGPU.hpp"
 #include "UpdateBuffers.hpp"
 #include "structs.hpp"
-#include "resource/window/Window.hpp"
+#include <chrono>
 
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
@@ -10,14 +10,18 @@ namespace ES::Plugin::WebGPU::System {
 
 void UpdateBuffers(ES::Engine::Core &core)
 {
+	ES_PROFILE_ZONE(core, "UpdateBuffers");
+
 	wgpu::Device &device = core.GetResource<wgpu::Device>();
-	wgpu::Surface &surface = core.GetResource<wgpu::Surface>();
 	wgpu::Queue &queue = core.GetResource<wgpu::Queue>();
-	auto &window = core.GetResource<ES::Plugin::Window::Resource::Window>();
+	const auto &renderOutput = core.GetResource<RenderOutput>();
+
+	// Not glfwGetTime, GLFW is not initialized when headless
+	static const auto startTime = std::chrono::steady_clock::now();
 
 	MyUniforms uniforms;
 
-	uniforms.time = glfwGetTime();
+	uniforms.time = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
 	uniforms.color = { 1.f, 1.0f, 1.0f, 1.0f };
 
 	CameraData cameraData = core.GetResource<CameraData>();
@@ -40,19 +44,23 @@ void UpdateBuffers(ES::Engine::Core &core)
 
 	uniforms.cameraPosition = cameraData.position;
 
-	queue.writeBuffer(uniformBuffer, offsetof(MyUniforms, time), &uniforms.time, sizeof(MyUniforms::time));
-	queue.writeBuffer(uniformBuffer, offsetof(MyUniforms, color), &uniforms.color, sizeof(MyUniforms::color));
-	queue.writeBuffer(uniformBuffer, offsetof(MyUniforms, viewMatrix), &uniforms.viewMatrix, sizeof(MyUniforms::viewMatrix));
-	queue.writeBuffer(uniformBuffer, offsetof(MyUniforms, projectionMatrix), &uniforms.projectionMatrix, sizeof(MyUniforms::projectionMatrix));
-	queue.writeBuffer(uniformBuffer, offsetof(MyUniforms, cameraPosition), &uniforms.cameraPosition, sizeof(MyUniforms::cameraPosition));
+	// Each buffer is a ring, only the region of this frame is written, the GPU may still read the others
+	const auto &framesInFlight = core.GetResource<FramesInFlight>();
+	uint64_t uniformOffset = framesInFlight.GetOffset(uniformBuffer);
+	queue.writeBuffer(uniformBuffer, uniformOffset + offsetof(MyUniforms, time), &uniforms.time, sizeof(MyUniforms::time));
+	queue.writeBuffer(uniformBuffer, uniformOffset + offsetof(MyUniforms, color), &uniforms.color, sizeof(MyUniforms::color));
+	queue.writeBuffer(uniformBuffer, uniformOffset + offsetof(MyUniforms, viewMatrix), &uniforms.viewMatrix, sizeof(MyUniforms::viewMatrix));
+	queue.writeBuffer(uniformBuffer, uniformOffset + offsetof(MyUniforms, projectionMatrix), &uniforms.projectionMatrix, sizeof(MyUniforms::projectionMatrix));
+	queue.writeBuffer(uniformBuffer, uniformOffset + offsetof(MyUniforms, cameraPosition), &uniforms.cameraPosition, sizeof(MyUniforms::cameraPosition));
 
 	const glm::mat4 skyboxViewMatrix = glm::mat4(glm::mat3(uniforms.viewMatrix));
 	const glm::mat4 skyboxProjectionMatrix = uniforms.projectionMatrix;
 	const glm::mat4 skyboxVP = skyboxProjectionMatrix * skyboxViewMatrix;
-	queue.writeBuffer(skyboxBuffer, 0, &skyboxVP, sizeof(glm::mat4));
+	queue.writeBuffer(skyboxBuffer, framesInFlight.GetOffset(skyboxBuffer), &skyboxVP, sizeof(glm::mat4));
 
 	auto &lights = core.GetResource<std::vector<Light>>();
 	uint32_t lightsCount = static_cast<uint32_t>(lights.size());
+	uint64_t matricesOffset = framesInFlight.GetOffset(additionalDirectionalLightsBuffer);
 
 	for (auto &light : lights) {
 		if (light.type != Light::Type::Directional) continue;
@@ -71,14 +79,15 @@ void UpdateBuffers(ES::Engine::Core &core)
 		
 		additionalDirectionalLight.lightViewProj = lightSpaceMatrix;
 		light.lightViewProjMatrix = lightSpaceMatrix;
-		queue.writeBuffer(additionalDirectionalLight.buffer, 0, &additionalDirectionalLight.lightViewProj, sizeof(glm::mat4));
+		queue.writeBuffer(additionalDirectionalLightsBuffer, matricesOffset + additionalDirectionalLight.offset, &additionalDirectionalLight.lightViewProj, sizeof(glm::mat4));
 	}
-	queue.writeBuffer(lightsBuffer, 0, &lightsCount, sizeof(uint32_t));
-	queue.writeBuffer(lightsBuffer, sizeof(uint32_t) + 12 /* (padding) */, lights.data(), sizeof(Light) * lights.size());
+	uint64_t lightsOffset = framesInFlight.GetOffset(lightsBuffer);
+	queue.writeBuffer(lightsBuffer, lightsOffset, &lightsCount, sizeof(uint32_t));
+	queue.writeBuffer(lightsBuffer, lightsOffset + sizeof(uint32_t) + 12 /* (padding) */, lights.data(), sizeof(Light) * lights.size());
 
 	Uniforms2D uniforms2D;
 
-	glm::ivec2 windowSize = window.GetSize();
+	glm::vec2 windowSize = renderOutput.size;
 
 	uniforms2D.orthoMatrix = glm::ortho(
 		windowSize.x * -0.5f,
@@ -86,6 +95,10 @@ void UpdateBuffers(ES::Engine::Core &core)
 		windowSize.y * -0.5f,
 		windowSize.y * 0.5f);
 
-	queue.writeBuffer(uniform2DBuffer, 0, &uniforms2D, sizeof(Uniforms2D));
+	queue.writeBuffer(uniform2DBuffer, framesInFlight.GetOffset(uniform2DBuffer), &uniforms2D, sizeof(Uniforms2D));
+
+	core.GetResource<FrameStats>().RecordUpload(sizeof(MyUniforms::time) + sizeof(MyUniforms::color) + sizeof(MyUniforms::viewMatrix)
+		+ sizeof(MyUniforms::projectionMatrix) + sizeof(MyUniforms::cameraPosition) + sizeof(glm::mat4)
+		+ sizeof(glm::mat4) * additionalDirectionalLights.size() + sizeof(uint32_t) + sizeof(Light) * lights.size() + sizeof(Uniforms2D));
 }
 }
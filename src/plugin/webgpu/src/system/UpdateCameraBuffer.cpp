@@ -4,6 +4,8 @@
 #include "resource/window/Window.hpp"
 
 void ES::Plugin::WebGPU::System::UpdateCameraBuffer(ES::Engine::Core &core) {
+	ES_PROFILE_ZONE(core, "UpdateCameraBuffer");
+
 	wgpu::Queue queue = core.GetResource<wgpu::Queue>();
 	auto &camData = core.GetResource<CameraData>();
 
@@ -27,5 +29,7 @@ void ES::Plugin::WebGPU::System::UpdateCameraBuffer(ES::Engine::Core &core) {
 	cameraBuf.viewProjectionMatrix = projectionMatrix * viewMatrix;
 	cameraBuf.invViewProjectionMatrix = glm::inverse(cameraBuf.viewProjectionMatrix);
 	cameraBuf.position = camData.position;
-	queue.writeBuffer(cameraBuffer, 0, &cameraBuf, sizeof(cameraBuf));
+	queue.writeBuffer(cameraBuffer, core.GetResource<FramesInFlight>().GetOffset(cameraBuffer), &cameraBuf, sizeof(cameraBuf));
+	core.GetResource<FrameStats>().RecordUpload(sizeof(cameraBuf));
+	core.GetResource<GpuCulling>().SetCamera(cameraBuf.viewProjectionMatrix, camData.position);
 }
@@ -0,0 +1,51 @@
+#include "UpdateMeshLODs.hpp"
+#include "WebGPU.hpp"
+#include "component/Transform.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ES::Plugin::WebGPU::System {
+
+// Coarsest level whose error, in pixels, stays under the threshold
+static uint32_t SelectLOD(const Component::Mesh &mesh, float pixelsPerUnit, float pixelError) {
+	uint32_t level = 0;
+	for (uint32_t i = 0; i < mesh.lods.size(); i++) {
+		if (mesh.lods[i].error * pixelsPerUnit > pixelError) break;
+		level = i + 1;
+	}
+	return level;
+}
+
+void UpdateMeshLODs(ES::Engine::Core &core) {
+	ES_PROFILE_ZONE(core, "UpdateMeshLODs");
+
+	const auto &settings = core.GetResource<MeshLODSettings>();
+	const auto &camera = core.GetResource<CameraData>();
+	const auto &renderOutput = core.GetResource<RenderOutput>();
+
+	// Pixels covered by one world unit at distance 1, from the vertical field of view
+	float viewportHeight = static_cast<float>(std::max(renderOutput.size.y, 1u));
+	float pixelsAtUnitDistance = viewportHeight / (2.0f * std::tan(camera.fovY * 0.5f));
+
+	core.GetRegistry().view<Component::Mesh, ES::Plugin::Object::Component::Transform>().each([&](Component::Mesh &mesh, ES::Plugin::Object::Component::Transform &transform) {
+		mesh.lod = mesh.shadowLod = 0;
+		if (!settings.enabled || mesh.pipelineType != PipelineType::_3D || !mesh.enabled || mesh.lods.empty()) return;
+
+		// World space sphere around the local bounds, the error grows with the largest scale of the transform
+		glm::mat4 model = transform.getTransformationMatrix();
+		float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+		glm::vec3 center = glm::vec3(model * glm::vec4((mesh.boundsMin + mesh.boundsMax) * 0.5f, 1.0f));
+		float radius = glm::length(mesh.boundsMax - mesh.boundsMin) * 0.5f * scale;
+
+		// Inside the sphere, the closest surface can be at any distance
+		float distance = glm::length(center - camera.position) - radius;
+		if (distance <= camera.nearPlane) return;
+
+		float pixelsPerUnit = scale * pixelsAtUnitDistance / distance;
+		mesh.lod = SelectLOD(mesh, pixelsPerUnit, settings.pixelError);
+		mesh.shadowLod = std::max(mesh.lod, SelectLOD(mesh, pixelsPerUnit, settings.shadowPixelError));
+	});
+}
+
+}
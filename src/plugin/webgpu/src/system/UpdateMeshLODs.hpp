@@ -0,0 +1,10 @@
+#pragma once
+
+#include "core/Core.hpp"
+
+namespace ES::Plugin::WebGPU::System {
+
+// Pick the LOD of every 3D mesh from the size of its bounding sphere on screen, before the batches are built
+void UpdateMeshLODs(ES::Engine::Core &core);
+
+}
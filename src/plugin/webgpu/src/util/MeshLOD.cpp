@@ -0,0 +1,227 @@
+#include "MeshLOD.hpp"
+#include "OptimizeMesh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+#include <fmt/format.h>
+
+#include "core/Core.hpp"
+
+namespace ES::Plugin::WebGPU::Util {
+
+static constexpr size_t MinLODTriangles = 32;
+static constexpr size_t MaxSimplifyPasses = 32;
+
+// Sum of squared distances to a set of planes, as a symmetric 4x4 matrix
+struct Quadric {
+	double xx = 0, xy = 0, xz = 0, xw = 0, yy = 0, yz = 0, yw = 0, zz = 0, zw = 0, ww = 0;
+
+	void AddPlane(const glm::vec3 &normal, float distance) {
+		double x = normal.x, y = normal.y, z = normal.z, w = distance;
+		xx += x * x; xy += x * y; xz += x * z; xw += x * w;
+		yy += y * y; yz += y * z; yw += y * w;
+		zz += z * z; zw += z * w;
+		ww += w * w;
+	}
+
+	Quadric &operator+=(const Quadric &other) {
+		xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+		yy += other.yy; yz += other.yz; yw += other.yw;
+		zz += other.zz; zw += other.zw;
+		ww += other.ww;
+		return *this;
+	}
+
+	double Evaluate(const glm::vec3 &p) const {
+		double x = p.x, y = p.y, z = p.z;
+		double result = xx * x * x + yy * y * y + zz * z * z + ww;
+		result += 2.0 * (xy * x * y + xz * x * z + yz * y * z + xw * x + yw * y + zw * z);
+		return std::max(result, 0.0);
+	}
+};
+
+float SimplifyMesh(const std::vector<glm::vec3> &vertices, std::vector<uint32_t> &indices, size_t targetIndexCount) {
+	size_t vertexCount = vertices.size();
+
+	// Vertices at the same position are a single vertex for the simplification, split by their attributes (wedges)
+	std::vector<uint32_t> sortedVertices(vertexCount);
+	std::iota(sortedVertices.begin(), sortedVertices.end(), 0);
+	auto lessPosition = [&](uint32_t a, uint32_t b) {
+		const glm::vec3 &pa = vertices[a], &pb = vertices[b];
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		return pa.z < pb.z;
+	};
+	std::sort(sortedVertices.begin(), sortedVertices.end(), lessPosition);
+	std::vector<uint32_t> position(vertexCount);
+	uint32_t positionCount = 0;
+	for (size_t i = 0; i < vertexCount; i++) {
+		if (i > 0 && lessPosition(sortedVertices[i - 1], sortedVertices[i])) positionCount++;
+		position[sortedVertices[i]] = positionCount;
+	}
+	if (vertexCount > 0) positionCount++;
+	std::vector<glm::vec3> positions(positionCount);
+	for (size_t i = 0; i < vertexCount; i++) positions[position[i]] = vertices[i];
+
+	std::vector<Quadric> quadrics(positionCount);
+	for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+		const glm::vec3 &p0 = vertices[indices[t]], &p1 = vertices[indices[t + 1]], &p2 = vertices[indices[t + 2]];
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length == 0.0f) continue;
+		normal = normal / length;
+		for (size_t corner = 0; corner < 3; corner++) quadrics[position[indices[t + corner]]].AddPlane(normal, -glm::dot(normal, p0));
+	}
+
+	double maxCost = 0.0;
+	std::vector<uint32_t> wedgeRemap(vertexCount);
+	std::vector<uint32_t> adjacencyOffsets(positionCount + 1);
+	std::vector<uint32_t> adjacency;
+	std::vector<bool> locked(positionCount);
+	std::vector<bool> touched(positionCount);
+	std::vector<std::pair<uint32_t, uint32_t>> mapping;
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+	std::vector<Collapse> collapses;
+
+	for (size_t pass = 0; pass < MaxSimplifyPasses && indices.size() > targetIndexCount; pass++) {
+		// Triangles around each position
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t index : indices) adjacencyOffsets[position[index] + 1]++;
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+		adjacency.resize(indices.size());
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++) adjacency[fill[position[indices[i]]]++] = static_cast<uint32_t>(i / 3);
+
+		// Edges of a single triangle are borders, their vertices stay where they are
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		edgeUses.reserve(indices.size());
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			for (size_t corner = 0; corner < 3; corner++) {
+				uint32_t a = position[indices[t + corner]], b = position[indices[t + (corner + 1) % 3]];
+				edgeUses[(uint64_t(std::min(a, b)) << 32) | std::max(a, b)]++;
+			}
+		}
+		std::fill(locked.begin(), locked.end(), false);
+		for (const auto &[edge, uses] : edgeUses) {
+			if (uses != 1) continue;
+			locked[edge >> 32] = true;
+			locked[edge & 0xFFFFFFFF] = true;
+		}
+
+		collapses.clear();
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			for (size_t corner = 0; corner < 3; corner++) {
+				uint32_t a = position[indices[t + corner]], b = position[indices[t + (corner + 1) % 3]];
+				if (!locked[a]) collapses.push_back({ a, b, quadrics[a].Evaluate(positions[b]) });
+				if (!locked[b]) collapses.push_back({ b, a, quadrics[b].Evaluate(positions[a]) });
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) { return a.cost < b.cost; });
+
+		// Cheapest collapses first, a collapse changes the triangles around its vertex so their neighbours wait for the next pass
+		std::iota(wedgeRemap.begin(), wedgeRemap.end(), 0);
+		std::fill(touched.begin(), touched.end(), false);
+		size_t removedIndices = 0;
+		size_t collapsed = 0;
+		for (const Collapse &collapse : collapses) {
+			if (indices.size() - removedIndices <= targetIndexCount) break;
+			if (touched[collapse.from] || touched[collapse.to]) continue;
+
+			// Every wedge of the collapsed vertex moves to the wedge of the target it shares a triangle with
+			mapping.clear();
+			for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++) {
+				const uint32_t *triangle = &indices[adjacency[a] * 3];
+				uint32_t from = UINT32_MAX, to = UINT32_MAX;
+				for (size_t corner = 0; corner < 3; corner++) {
+					if (position[triangle[corner]] == collapse.from) from = triangle[corner];
+					if (position[triangle[corner]] == collapse.to) to = triangle[corner];
+				}
+				if (to == UINT32_MAX) continue;
+				if (std::none_of(mapping.begin(), mapping.end(), [&](const auto &pair) { return pair.first == from; })) mapping.emplace_back(from, to);
+			}
+
+			bool valid = true;
+			size_t removedTriangles = 0;
+			for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && valid; a++) {
+				const uint32_t *triangle = &indices[adjacency[a] * 3];
+				std::array<glm::vec3, 3> before, after;
+				bool removed = false;
+				for (size_t corner = 0; corner < 3; corner++) {
+					uint32_t vertexPosition = position[triangle[corner]];
+					if (vertexPosition == collapse.from && std::none_of(mapping.begin(), mapping.end(), [&](const auto &pair) { return pair.first == triangle[corner]; })) valid = false;
+					removed |= vertexPosition == collapse.to;
+					before[corner] = positions[vertexPosition];
+					after[corner] = vertexPosition == collapse.from ? positions[collapse.to] : positions[vertexPosition];
+				}
+				if (removed) {
+					removedTriangles++;
+					continue;
+				}
+				// The triangles left must not flip
+				glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(normalBefore, normalAfter) <= 0.0f) valid = false;
+			}
+			if (!valid) continue;
+
+			for (const auto &[from, to] : mapping) wedgeRemap[from] = to;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			maxCost = std::max(maxCost, collapse.cost);
+			removedIndices += removedTriangles * 3;
+			collapsed++;
+			for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++) {
+				for (size_t corner = 0; corner < 3; corner++) touched[position[indices[adjacency[a] * 3 + corner]]] = true;
+			}
+		}
+		if (collapsed == 0) break;
+
+		// Triangles around a collapsed edge are now degenerate
+		size_t kept = 0;
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			uint32_t i0 = wedgeRemap[indices[t]], i1 = wedgeRemap[indices[t + 1]], i2 = wedgeRemap[indices[t + 2]];
+			if (position[i0] == position[i1] || position[i1] == position[i2] || position[i0] == position[i2]) continue;
+			indices[kept++] = i0;
+			indices[kept++] = i1;
+			indices[kept++] = i2;
+		}
+		indices.resize(kept);
+	}
+
+	return static_cast<float>(std::sqrt(maxCost));
+}
+
+std::vector<LODLevel> BuildLODChain(const std::vector<glm::vec3> &vertices, const std::vector<uint32_t> &indices, size_t maxLevels, float ratio) {
+	std::vector<LODLevel> chain;
+	const std::vector<uint32_t> *previous = &indices;
+	float error = 0.0f;
+
+	for (size_t level = 1; level <= maxLevels; level++) {
+		size_t target = static_cast<size_t>(static_cast<float>(previous->size() / 3) * ratio) * 3;
+		if (target < MinLODTriangles * 3) break;
+
+		LODLevel lod;
+		lod.indices = *previous;
+		float simplifyError = SimplifyMesh(vertices, lod.indices, target);
+		// Not worth a level when it barely removed anything
+		if (lod.indices.size() * 10 > previous->size() * 9) break;
+
+		// Each level is simplified from the previous one, so their errors add up
+		error += simplifyError;
+		lod.error = error;
+		OptimizeVertexCache(lod.indices, vertices.size());
+		ES::Utils::Log::Debug(fmt::format("MeshLOD: Level {} has {} triangles, error {}", level, lod.indices.size() / 3, lod.error));
+		chain.push_back(std::move(lod));
+		previous = &chain.back().indices;
+	}
+	return chain;
+}
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ES::Plugin::WebGPU::Util {
+
+struct LODLevel {
+	std::vector<uint32_t> indices; // Into the vertices of the full mesh
+	float error = 0.0f; // How far the surface may have moved from the full mesh, in local units
+};
+
+// Quadric error edge collapses (Garland and Heckbert 1997) until the mesh is down to targetIndexCount or nothing can be
+// collapsed anymore. Vertices are only collapsed onto a neighbour, so the result still indexes the same vertices.
+// Borders are kept and attribute seams only collapse along themselves. Returns the error of the simplification.
+float SimplifyMesh(const std::vector<glm::vec3> &vertices, std::vector<uint32_t> &indices, size_t targetIndexCount);
+
+// LODs of a mesh, each one about ratio times the triangles of the previous one, all indexing the vertices of the mesh
+// so they share its vertex buffer. Stops after maxLevels or when the mesh does not simplify anymore. The mesh itself,
+// level 0, is not part of the chain. Levels are ordered for the vertex cache.
+std::vector<LODLevel> BuildLODChain(const std::vector<glm::vec3> &vertices, const std::vector<uint32_t> &indices, size_t maxLevels = 4, float ratio = 0.5f);
+
+}
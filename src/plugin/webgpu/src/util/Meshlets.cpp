@@ -0,0 +1,85 @@
+#include "Meshlets.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <fmt/format.h>
+
+namespace ES::Plugin::WebGPU::Util {
+
+static void ComputeMeshletBounds(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, Meshlet &meshlet) {
+	std::span<const uint32_t> triangles = indices.subspan(meshlet.firstIndex, meshlet.indexCount);
+
+	glm::vec3 boundsMin = positions[triangles[0]], boundsMax = positions[triangles[0]];
+	for (uint32_t index : triangles) {
+		boundsMin = glm::min(boundsMin, positions[index]);
+		boundsMax = glm::max(boundsMax, positions[index]);
+	}
+	meshlet.center = (boundsMin + boundsMax) * 0.5f;
+	meshlet.radius = 0.0f;
+	for (uint32_t index : triangles) meshlet.radius = std::max(meshlet.radius, glm::length(positions[index] - meshlet.center));
+
+	// Cone around the normals, its axis is their average and its angle reaches the farthest one
+	glm::vec3 normalSum(0.0f);
+	for (size_t t = 0; t < triangles.size(); t += 3) {
+		const glm::vec3 &p0 = positions[triangles[t]], &p1 = positions[triangles[t + 1]], &p2 = positions[triangles[t + 2]];
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length > 0.0f) normalSum += normal / length;
+	}
+	float sumLength = glm::length(normalSum);
+	meshlet.coneAxis = sumLength > 0.0f ? normalSum / sumLength : glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+	if (sumLength == 0.0f) return;
+
+	float minDot = 1.0f;
+	for (size_t t = 0; t < triangles.size(); t += 3) {
+		const glm::vec3 &p0 = positions[triangles[t]], &p1 = positions[triangles[t + 1]], &p2 = positions[triangles[t + 2]];
+		glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(normal);
+		if (length > 0.0f) minDot = std::min(minDot, glm::dot(normal / length, meshlet.coneAxis));
+	}
+	// Wider than a half cone, some triangles always face the eye
+	if (minDot <= 0.0f) return;
+	meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+std::vector<Meshlet> BuildMeshlets(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, uint32_t maxVertices, uint32_t maxTriangles) {
+	if (indices.size() % 3 != 0) throw std::runtime_error(fmt::format("BuildMeshlets: {} indices is not a triangle list.", indices.size()));
+	if (maxVertices < 3 || maxTriangles < 1) throw std::runtime_error("BuildMeshlets: A meshlet has to hold at least one triangle.");
+
+	std::vector<Meshlet> meshlets;
+	// Meshlet that last used each vertex, to count the distinct vertices of the current one
+	std::vector<uint32_t> lastMeshlet(positions.size(), UINT32_MAX);
+
+	Meshlet current;
+	for (uint32_t t = 0; t < indices.size(); t += 3) {
+		uint32_t newVertices = 0;
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			uint32_t index = indices[t + corner];
+			if (index >= positions.size()) throw std::runtime_error(fmt::format("BuildMeshlets: Index {} is out of the {} vertices.", index, positions.size()));
+			if (lastMeshlet[index] != meshlets.size()) newVertices++;
+		}
+		// Repeated indices of a degenerate triangle were counted twice, only an upper bound is needed here
+		if (current.indexCount > 0 && (current.vertexCount + newVertices > maxVertices || current.indexCount / 3 + 1 > maxTriangles)) {
+			ComputeMeshletBounds(positions, indices, current);
+			meshlets.push_back(current);
+			current = Meshlet{ .firstIndex = t };
+		}
+
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			uint32_t index = indices[t + corner];
+			if (lastMeshlet[index] == meshlets.size()) continue;
+			lastMeshlet[index] = static_cast<uint32_t>(meshlets.size());
+			current.vertexCount++;
+		}
+		current.indexCount += 3;
+	}
+	if (current.indexCount > 0) {
+		ComputeMeshletBounds(positions, indices, current);
+		meshlets.push_back(current);
+	}
+	return meshlets;
+}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <span>
+#include <vector>
+
+namespace ES::Plugin::WebGPU::Util {
+
+inline constexpr uint32_t MeshletMaxVertices = 64;
+inline constexpr uint32_t MeshletMaxTriangles = 124;
+
+// Consecutive triangles of a mesh, culled together by GpuCulling
+struct Meshlet {
+	uint32_t firstIndex = 0; // In the index list of the mesh
+	uint32_t indexCount = 0;
+	uint32_t vertexCount = 0; // Distinct vertices referenced
+	glm::vec3 center = glm::vec3(0.0f); // Bounding sphere of the triangles
+	float radius = 0.0f;
+	// Every triangle faces away from an eye for which dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius.
+	// A cutoff of 1 never culls, e.g. when the normals spread over more than a half sphere.
+	glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+	float coneCutoff = 1.0f;
+};
+
+// Split a triangle list in meshlets of at most maxVertices vertices and maxTriangles triangles, in the order of the
+// triangles, which should already be ordered for locality (see OptimizeMesh). Triangles are counter-clockwise.
+std::vector<Meshlet> BuildMeshlets(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, uint32_t maxVertices = MeshletMaxVertices, uint32_t maxTriangles = MeshletMaxTriangles);
+
+}
@@ -0,0 +1,211 @@
+#include "OptimizeMesh.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <fmt/format.h>
+
+#include "core/Core.hpp"
+
+namespace ES::Plugin::WebGPU::Util {
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize) {
+	VertexCacheStats stats;
+	if (indices.empty() || vertexCount == 0) return stats;
+
+	// A vertex is in the cache while fewer than cacheSize misses happened since its own miss
+	std::vector<uint32_t> missTime(vertexCount, 0);
+	uint32_t misses = 0;
+	for (uint32_t index : indices) {
+		if (missTime[index] != 0 && misses - missTime[index] < cacheSize) continue;
+		missTime[index] = ++misses;
+	}
+
+	stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+	return stats;
+}
+
+// Triangles ordered by fanning around a vertex while its neighbours are likely still in the cache. Returns the new
+// order of the triangles and the first triangle of each cluster, a cluster ends when the fan has to jump away.
+static std::vector<uint32_t> Tipsify(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t> &clusters) {
+	size_t triangleCount = indices.size() / 3;
+
+	// Triangles around each vertex
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (uint32_t index : indices) live[index]++;
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	std::partial_sum(live.begin(), live.end(), adjacencyOffsets.begin() + 1);
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++) adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+
+	std::vector<uint32_t> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnd;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> order;
+	order.reserve(triangleCount);
+	clusters.clear();
+
+	uint32_t time = cacheSize + 1;
+	size_t cursor = 0;
+	int64_t fanning = 0;
+	bool jumped = true;
+
+	while (fanning >= 0) {
+		if (jumped && (clusters.empty() || clusters.back() != order.size())) clusters.push_back(static_cast<uint32_t>(order.size()));
+
+		candidates.clear();
+		for (uint32_t a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle]) continue;
+			emitted[triangle] = true;
+			order.push_back(triangle);
+
+			for (size_t corner = 0; corner < 3; corner++) {
+				uint32_t vertex = indices[triangle * 3 + corner];
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				live[vertex]--;
+				if (time - cacheTime[vertex] > cacheSize) cacheTime[vertex] = time++;
+			}
+		}
+
+		// Next fan around the candidate that stays in the cache the longest while its remaining triangles are emitted
+		fanning = -1;
+		int64_t bestPriority = -1;
+		for (uint32_t vertex : candidates) {
+			if (live[vertex] == 0) continue;
+			int64_t priority = 0;
+			if (time - cacheTime[vertex] + 2 * live[vertex] <= cacheSize) priority = time - cacheTime[vertex];
+			if (priority > bestPriority) {
+				bestPriority = priority;
+				fanning = vertex;
+			}
+		}
+		jumped = fanning < 0;
+		if (!jumped) continue;
+
+		// Dead end: go back to a recently used vertex, or to the next vertex with triangles left
+		while (!deadEnd.empty() && fanning < 0) {
+			uint32_t vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[vertex] > 0) fanning = vertex;
+		}
+		while (cursor < vertexCount && fanning < 0) {
+			if (live[cursor] > 0) fanning = static_cast<int64_t>(cursor);
+			cursor++;
+		}
+	}
+	return order;
+}
+
+// Clusters facing away from the center of the mesh are drawn first, they tend to occlude the other ones
+// (Sander et al. 2007, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw")
+static void SortClusters(const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices, std::vector<uint32_t> &order, const std::vector<uint32_t> &clusters) {
+	auto corner = [&](uint32_t triangle, size_t i) { return positions[indices[triangle * 3 + i]]; };
+
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for (uint32_t triangle : order) {
+		float area = glm::length(glm::cross(corner(triangle, 1) - corner(triangle, 0), corner(triangle, 2) - corner(triangle, 0)));
+		meshCentroid += (corner(triangle, 0) + corner(triangle, 1) + corner(triangle, 2)) * (area / 3.0f);
+		meshArea += area;
+	}
+	if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+	struct Cluster {
+		uint32_t begin;
+		uint32_t end;
+		float key;
+	};
+	std::vector<Cluster> sorted(clusters.size());
+	for (size_t c = 0; c < clusters.size(); c++) {
+		Cluster &cluster = sorted[c];
+		cluster.begin = clusters[c];
+		cluster.end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(order.size());
+
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f); // Area weighted, the cross products are twice the areas
+		float area = 0.0f;
+		for (uint32_t t = cluster.begin; t < cluster.end; t++) {
+			uint32_t triangle = order[t];
+			glm::vec3 cross = glm::cross(corner(triangle, 1) - corner(triangle, 0), corner(triangle, 2) - corner(triangle, 0));
+			float triangleArea = glm::length(cross);
+			centroid += (corner(triangle, 0) + corner(triangle, 1) + corner(triangle, 2)) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+		if (area > 0.0f) centroid /= area;
+		float normalLength = glm::length(normal);
+		cluster.key = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster &a, const Cluster &b) { return a.key > b.key; });
+
+	std::vector<uint32_t> reordered;
+	reordered.reserve(order.size());
+	for (const Cluster &cluster : sorted) reordered.insert(reordered.end(), order.begin() + cluster.begin, order.begin() + cluster.end);
+	order.swap(reordered);
+}
+
+template <typename T>
+static void Remap(std::vector<T> &attribute, const std::vector<uint32_t> &remap, size_t newCount) {
+	std::vector<T> remapped(newCount);
+	for (size_t i = 0; i < attribute.size(); i++) {
+		if (remap[i] != UINT32_MAX) remapped[remap[i]] = attribute[i];
+	}
+	attribute.swap(remapped);
+}
+
+void OptimizeMesh(std::vector<glm::vec3> &vertices, std::vector<glm::vec3> &normals, std::vector<glm::vec2> &texCoords, std::vector<uint32_t> &indices) {
+	if (normals.size() != vertices.size() || texCoords.size() != vertices.size()) {
+		throw std::runtime_error(fmt::format("OptimizeMesh: {} vertices but {} normals and {} uvs.", vertices.size(), normals.size(), texCoords.size()));
+	}
+	if (indices.size() % 3 != 0) throw std::runtime_error(fmt::format("OptimizeMesh: {} indices is not a triangle list.", indices.size()));
+	for (uint32_t index : indices) {
+		if (index >= vertices.size()) throw std::runtime_error(fmt::format("OptimizeMesh: Index {} is out of the {} vertices.", index, vertices.size()));
+	}
+	if (indices.empty()) return;
+
+	VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+
+	std::vector<uint32_t> clusters;
+	std::vector<uint32_t> order = Tipsify(indices, vertices.size(), OptimizeMeshCacheSize, clusters);
+	SortClusters(vertices, indices, order, clusters);
+
+	// Vertices are renumbered in the order of their first use, so they are also fetched in order
+	std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+	std::vector<uint32_t> reordered(indices.size());
+	uint32_t vertexCount = 0;
+	for (size_t t = 0; t < order.size(); t++) {
+		for (size_t corner = 0; corner < 3; corner++) {
+			uint32_t index = indices[order[t] * 3 + corner];
+			if (remap[index] == UINT32_MAX) remap[index] = vertexCount++;
+			reordered[t * 3 + corner] = remap[index];
+		}
+	}
+	size_t previousVertexCount = vertices.size();
+	Remap(vertices, remap, vertexCount);
+	Remap(normals, remap, vertexCount);
+	Remap(texCoords, remap, vertexCount);
+	indices.swap(reordered);
+
+	VertexCacheStats after = AnalyzeVertexCache(indices, vertices.size());
+	ES::Utils::Log::Debug(fmt::format("OptimizeMesh: {} triangles in {} clusters, {} vertices ({} unused removed), ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}",
+		indices.size() / 3, clusters.size(), vertices.size(), previousVertexCount - vertices.size(), before.acmr, after.acmr, before.atvr, after.atvr));
+}
+
+void OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount) {
+	if (indices.empty()) return;
+
+	std::vector<uint32_t> clusters;
+	std::vector<uint32_t> order = Tipsify(indices, vertexCount, OptimizeMeshCacheSize, clusters);
+	std::vector<uint32_t> reordered(indices.size());
+	for (size_t t = 0; t < order.size(); t++) {
+		for (size_t corner = 0; corner < 3; corner++) reordered[t * 3 + corner] = indices[order[t] * 3 + corner];
+	}
+	indices.swap(reordered);
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace ES::Plugin::WebGPU::Util {
+
+inline constexpr uint32_t OptimizeMeshCacheSize = 16; // Entries of the vertex cache the triangles are ordered for
+
+// Post-transform vertex cache statistics of an index buffer, simulated with a FIFO cache
+struct VertexCacheStats {
+	float acmr = 0.0f; // Transformed vertices per triangle, 0.5 at best and 3 at worst
+	float atvr = 0.0f; // Transformed vertices per vertex, 1 at best
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t> &indices, size_t vertexCount, uint32_t cacheSize = OptimizeMeshCacheSize);
+
+// Reorder a triangle list before building its Mesh, the geometry drawn does not change:
+// - triangles for the post-transform vertex cache (Tipsify, Sander et al. 2007),
+// - the clusters found by Tipsify so the ones facing outwards are drawn first, which lowers the overdraw,
+// - vertices in the order the triangles use them, unused ones are removed.
+// Statistics before and after are logged.
+void OptimizeMesh(std::vector<glm::vec3> &vertices, std::vector<glm::vec3> &normals, std::vector<glm::vec2> &texCoords, std::vector<uint32_t> &indices);
+
+// Only the triangle order for the vertex cache, for index buffers sharing their vertices with another one (LODs)
+void OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+}
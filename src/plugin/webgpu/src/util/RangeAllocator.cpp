@@ -0,0 +1,59 @@
+#include "RangeAllocator.hpp"
+
+#include <stdexcept>
+
+RangeAllocator::RangeAllocator(uint32_t capacity) : capacity(capacity) {
+    if (capacity > 0) freeRanges.emplace(0, capacity);
+}
+
+uint32_t RangeAllocator::Allocate(uint32_t size) {
+    if (size == 0) return 0;
+
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->second < size) continue;
+
+        uint32_t offset = it->first;
+        uint32_t remaining = it->second - size;
+        freeRanges.erase(it);
+        if (remaining > 0) freeRanges.emplace(offset + size, remaining);
+        used += size;
+        return offset;
+    }
+    return InvalidOffset;
+}
+
+void RangeAllocator::Free(uint32_t offset, uint32_t size) {
+    if (size == 0) return;
+    if (offset > capacity || size > capacity - offset) throw std::runtime_error("RangeAllocator: Freed range is out of bounds.");
+
+    insertFree(offset, size);
+    used -= size;
+}
+
+void RangeAllocator::Grow(uint32_t newCapacity) {
+    if (newCapacity <= capacity) return;
+
+    uint32_t oldCapacity = capacity;
+    capacity = newCapacity;
+    insertFree(oldCapacity, newCapacity - oldCapacity);
+}
+
+void RangeAllocator::insertFree(uint32_t offset, uint32_t size) {
+    auto next = freeRanges.lower_bound(offset);
+    if (next != freeRanges.end() && next->first < offset + size) throw std::runtime_error("RangeAllocator: Range is already free.");
+
+    if (next != freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second > offset) throw std::runtime_error("RangeAllocator: Range is already free.");
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            size += previous->second;
+            freeRanges.erase(previous);
+        }
+    }
+    if (next != freeRanges.end() && next->first == offset + size) {
+        size += next->second;
+        freeRanges.erase(next);
+    }
+    freeRanges.emplace(offset, size);
+}
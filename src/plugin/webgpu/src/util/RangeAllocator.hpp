@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// First-fit allocator of ranges in [0, capacity), adjacent free ranges are merged back together. It only does the
+// bookkeeping, what the ranges index into (e.g. a GPU buffer) is up to the owner.
+class RangeAllocator {
+    public:
+        static constexpr uint32_t InvalidOffset = UINT32_MAX;
+
+        RangeAllocator() = default;
+        explicit RangeAllocator(uint32_t capacity);
+
+        // Returns InvalidOffset when no free range is large enough
+        uint32_t Allocate(uint32_t size);
+        void Free(uint32_t offset, uint32_t size);
+
+        // Extend the range, what is already allocated stays where it is
+        void Grow(uint32_t newCapacity);
+
+        uint32_t GetCapacity() const { return capacity; }
+        uint32_t GetUsed() const { return used; }
+
+    private:
+        void insertFree(uint32_t offset, uint32_t size);
+
+        uint32_t capacity = 0;
+        uint32_t used = 0;
+        std::map<uint32_t, uint32_t> freeRanges; // offset -> size, never adjacent
+};
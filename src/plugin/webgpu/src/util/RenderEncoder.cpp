@@ -0,0 +1,125 @@
+#include "RenderEncoder.hpp"
+
+static uint64_t HashCombine(uint64_t seed, uint64_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+void RenderEncoder::record(const Command &command) {
+    commands.push_back(command);
+
+    hash = HashCombine(hash, static_cast<uint64_t>(command.type));
+    hash = HashCombine(hash, reinterpret_cast<uintptr_t>(command.handle));
+    for (uint32_t arg : command.args) hash = HashCombine(hash, arg);
+    hash = HashCombine(hash, static_cast<uint32_t>(command.baseVertex));
+    hash = HashCombine(hash, command.offset);
+    hash = HashCombine(hash, command.size);
+    hash = HashCombine(hash, static_cast<uint64_t>(command.indexFormat));
+    if (command.type == CommandType::SetBindGroup) {
+        for (size_t i = 0; i < command.args[1]; i++) hash = HashCombine(hash, dynamicOffsets[command.dynamicOffsetsStart + i]);
+    }
+}
+
+void RenderEncoder::setPipeline(wgpu::RenderPipeline pipeline) {
+    if (!IsRecording()) return renderPass.setPipeline(pipeline);
+    record({ .type = CommandType::SetPipeline, .handle = static_cast<WGPURenderPipeline>(pipeline) });
+}
+
+void RenderEncoder::setBindGroup(uint32_t groupIndex, wgpu::BindGroup group, size_t dynamicOffsetCount, uint32_t const *offsets) {
+    if (!IsRecording()) return renderPass.setBindGroup(groupIndex, group, dynamicOffsetCount, offsets);
+    size_t start = dynamicOffsets.size();
+    dynamicOffsets.insert(dynamicOffsets.end(), offsets, offsets + dynamicOffsetCount);
+    record({
+        .type = CommandType::SetBindGroup,
+        .handle = static_cast<WGPUBindGroup>(group),
+        .args = { groupIndex, static_cast<uint32_t>(dynamicOffsetCount), 0, 0 },
+        .dynamicOffsetsStart = start,
+    });
+}
+
+void RenderEncoder::setVertexBuffer(uint32_t slot, wgpu::Buffer buffer, uint64_t offset, uint64_t size) {
+    if (!IsRecording()) return renderPass.setVertexBuffer(slot, buffer, offset, size);
+    record({
+        .type = CommandType::SetVertexBuffer,
+        .handle = static_cast<WGPUBuffer>(buffer),
+        .args = { slot, 0, 0, 0 },
+        .offset = offset,
+        .size = size,
+    });
+}
+
+void RenderEncoder::setIndexBuffer(wgpu::Buffer buffer, wgpu::IndexFormat format, uint64_t offset, uint64_t size) {
+    if (!IsRecording()) return renderPass.setIndexBuffer(buffer, format, offset, size);
+    record({
+        .type = CommandType::SetIndexBuffer,
+        .handle = static_cast<WGPUBuffer>(buffer),
+        .offset = offset,
+        .size = size,
+        .indexFormat = format,
+    });
+}
+
+void RenderEncoder::draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance) {
+    drawCount++;
+    if (!IsRecording()) return renderPass.draw(vertexCount, instanceCount, firstVertex, firstInstance);
+    record({ .type = CommandType::Draw, .args = { vertexCount, instanceCount, firstVertex, firstInstance } });
+}
+
+void RenderEncoder::drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance) {
+    drawCount++;
+    if (!IsRecording()) return renderPass.drawIndexed(indexCount, instanceCount, firstIndex, baseVertex, firstInstance);
+    record({
+        .type = CommandType::DrawIndexed,
+        .args = { indexCount, instanceCount, firstIndex, firstInstance },
+        .baseVertex = baseVertex,
+    });
+}
+
+void RenderEncoder::drawIndexedIndirect(wgpu::Buffer indirectBuffer, uint64_t indirectOffset) {
+    drawCount++;
+    if (!IsRecording()) return renderPass.drawIndexedIndirect(indirectBuffer, indirectOffset);
+    record({
+        .type = CommandType::DrawIndexedIndirect,
+        .handle = static_cast<WGPUBuffer>(indirectBuffer),
+        .offset = indirectOffset,
+    });
+}
+
+void RenderEncoder::Reset() {
+    commands.clear();
+    dynamicOffsets.clear();
+    hash = 0;
+    drawCount = 0;
+}
+
+bool RenderEncoder::SameCommands(const RenderEncoder &other) const {
+    return hash == other.hash && commands == other.commands && dynamicOffsets == other.dynamicOffsets;
+}
+
+void RenderEncoder::Replay(wgpu::RenderBundleEncoder &bundleEncoder) const {
+    for (const Command &command : commands) {
+        switch (command.type) {
+        case CommandType::SetPipeline:
+            bundleEncoder.setPipeline(static_cast<WGPURenderPipeline>(command.handle));
+            break;
+        case CommandType::SetBindGroup:
+            bundleEncoder.setBindGroup(command.args[0], static_cast<WGPUBindGroup>(command.handle), command.args[1],
+                command.args[1] > 0 ? &dynamicOffsets[command.dynamicOffsetsStart] : nullptr);
+            break;
+        case CommandType::SetVertexBuffer:
+            bundleEncoder.setVertexBuffer(command.args[0], static_cast<WGPUBuffer>(command.handle), command.offset, command.size);
+            break;
+        case CommandType::SetIndexBuffer:
+            bundleEncoder.setIndexBuffer(static_cast<WGPUBuffer>(command.handle), command.indexFormat, command.offset, command.size);
+            break;
+        case CommandType::Draw:
+            bundleEncoder.draw(command.args[0], command.args[1], command.args[2], command.args[3]);
+            break;
+        case CommandType::DrawIndexed:
+            bundleEncoder.drawIndexed(command.args[0], command.args[1], command.args[2], command.baseVertex, command.args[3]);
+            break;
+        case CommandType::DrawIndexedIndirect:
+            bundleEncoder.drawIndexedIndirect(static_cast<WGPUBuffer>(command.handle), command.offset);
+            break;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "webgpu.hpp"
+
+// Front of the draw commands recorded by the render graph. It either forwards them straight to a render pass, or
+// keeps them in a command list that can be hashed and replayed later into a render bundle.
+class RenderEncoder {
+    public:
+        explicit RenderEncoder(wgpu::RenderPassEncoder renderPass) : renderPass(renderPass) {}
+        RenderEncoder() = default; // Recording mode
+
+        void setPipeline(wgpu::RenderPipeline pipeline);
+        void setBindGroup(uint32_t groupIndex, wgpu::BindGroup group, size_t dynamicOffsetCount, uint32_t const *dynamicOffsets);
+        void setVertexBuffer(uint32_t slot, wgpu::Buffer buffer, uint64_t offset, uint64_t size);
+        void setIndexBuffer(wgpu::Buffer buffer, wgpu::IndexFormat format, uint64_t offset, uint64_t size);
+        void draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance);
+        void drawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance);
+        void drawIndexedIndirect(wgpu::Buffer indirectBuffer, uint64_t indirectOffset);
+
+        bool IsRecording() const { return renderPass == nullptr; }
+
+        // Drop the recorded commands but keep the memory, so the encoder can be reused every frame
+        void Reset();
+
+        // Draws since construction or the last Reset, in both modes
+        uint32_t GetDrawCount() const { return drawCount; }
+
+        // Hash of the recorded commands and of the handles they reference, only a quick reject: equal hashes do not
+        // mean equal commands, see SameCommands
+        uint64_t GetHash() const { return hash; }
+
+        // Both recorded the same commands, with the same handles and dynamic offsets
+        bool SameCommands(const RenderEncoder &other) const;
+
+        void Replay(wgpu::RenderBundleEncoder &bundleEncoder) const;
+
+    private:
+        enum class CommandType {
+            SetPipeline,
+            SetBindGroup,
+            SetVertexBuffer,
+            SetIndexBuffer,
+            Draw,
+            DrawIndexed,
+            DrawIndexedIndirect,
+        };
+
+        struct Command {
+            CommandType type;
+            void *handle = nullptr;
+            uint32_t args[4] = { 0, 0, 0, 0 };
+            int32_t baseVertex = 0;
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            size_t dynamicOffsetsStart = 0; // In dynamicOffsets
+            wgpu::IndexFormat indexFormat = wgpu::IndexFormat::Undefined;
+
+            bool operator==(const Command &) const = default;
+        };
+
+        void record(const Command &command);
+
+        wgpu::RenderPassEncoder renderPass = nullptr;
+        std::vector<Command> commands;
+        std::vector<uint32_t> dynamicOffsets;
+        uint64_t hash = 0;
+        uint32_t drawCount = 0;
+};
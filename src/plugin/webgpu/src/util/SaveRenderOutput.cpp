@@ -0,0 +1,84 @@
+#include "SaveRenderOutput.hpp"
+#include "structs.hpp"
+
+#include <lodepng.h>
+
+namespace ES::Plugin::WebGPU::Util {
+
+void SaveRenderOutputAsPNG(ES::Engine::Core &core, const std::filesystem::path &path) {
+	auto &device = core.GetResource<wgpu::Device>();
+	auto &queue = core.GetResource<wgpu::Queue>();
+	const auto &renderOutput = core.GetResource<RenderOutput>();
+
+	if (!renderOutput.headless) throw std::runtime_error("Render output can only be saved when headless.");
+
+	bool swapRedBlue = false;
+	switch (static_cast<WGPUTextureFormat>(renderOutput.format)) {
+	case WGPUTextureFormat_BGRA8Unorm:
+	case WGPUTextureFormat_BGRA8UnormSrgb: swapRedBlue = true; break;
+	case WGPUTextureFormat_RGBA8Unorm:
+	case WGPUTextureFormat_RGBA8UnormSrgb: break;
+	default: throw std::runtime_error("Render output format cannot be saved as PNG.");
+	}
+
+	wgpu::Texture &texture = core.GetResource<TextureManager>().Get("WindowColorTexture").texture;
+	uint32_t width = renderOutput.size.x;
+	uint32_t height = renderOutput.size.y;
+	uint32_t bytesPerRow = ((width * 4 + 255) / 256) * 256; // Copies need rows aligned on 256 bytes
+
+	wgpu::BufferDescriptor bufferDesc(wgpu::Default);
+	bufferDesc.label = wgpu::StringView("Render Output Readback Buffer");
+	bufferDesc.size = uint64_t(bytesPerRow) * height;
+	bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead;
+	wgpu::Buffer readbackBuffer = device.createBuffer(bufferDesc);
+
+	wgpu::TexelCopyTextureInfo source(wgpu::Default);
+	source.texture = texture;
+	wgpu::TexelCopyBufferInfo destination(wgpu::Default);
+	destination.buffer = readbackBuffer;
+	destination.layout.bytesPerRow = bytesPerRow;
+	destination.layout.rowsPerImage = height;
+
+	wgpu::CommandEncoder encoder = device.createCommandEncoder();
+	wgpu::Extent3D copySize(width, height, 1);
+	encoder.copyTextureToBuffer(source, destination, copySize);
+	wgpu::CommandBuffer commandBuffer = encoder.finish();
+	encoder.release();
+	queue.submit(1, &commandBuffer);
+	commandBuffer.release();
+
+	WGPUMapAsyncStatus mapStatus = WGPUMapAsyncStatus_Unknown;
+	wgpu::BufferMapCallbackInfo callbackInfo(wgpu::Default);
+	callbackInfo.mode = wgpu::CallbackMode::AllowSpontaneous;
+	callbackInfo.callback = [](WGPUMapAsyncStatus status, WGPUStringView, WGPU_NULLABLE void *userdata1, WGPU_NULLABLE void *) {
+		*static_cast<WGPUMapAsyncStatus *>(userdata1) = status;
+	};
+	callbackInfo.userdata1 = &mapStatus;
+	readbackBuffer.mapAsync(wgpu::MapMode::Read, 0, bufferDesc.size, callbackInfo);
+	while (mapStatus == WGPUMapAsyncStatus_Unknown) device.poll(true, nullptr);
+
+	if (mapStatus != WGPUMapAsyncStatus_Success) {
+		readbackBuffer.release();
+		throw std::runtime_error("Could not map the render output readback buffer.");
+	}
+
+	const auto *mapped = static_cast<const uint8_t *>(readbackBuffer.getConstMappedRange(0, bufferDesc.size));
+	std::vector<unsigned char> pixels(size_t(width) * height * 4);
+	for (uint32_t y = 0; y < height; y++) {
+		const uint8_t *row = mapped + size_t(y) * bytesPerRow;
+		unsigned char *out = pixels.data() + size_t(y) * width * 4;
+		for (uint32_t x = 0; x < width; x++) {
+			out[x * 4 + 0] = row[x * 4 + (swapRedBlue ? 2 : 0)];
+			out[x * 4 + 1] = row[x * 4 + 1];
+			out[x * 4 + 2] = row[x * 4 + (swapRedBlue ? 0 : 2)];
+			out[x * 4 + 3] = 255;
+		}
+	}
+	readbackBuffer.unmap();
+	readbackBuffer.release();
+
+	unsigned error = lodepng::encode(path.string(), pixels, width, height);
+	if (error) throw std::runtime_error(fmt::format("Could not write {}: {}", path.string(), lodepng_error_text(error)));
+}
+
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "core/Core.hpp"
+#include <filesystem>
+
+namespace ES::Plugin::WebGPU::Util {
+
+// Read WindowColorTexture back and write it as a PNG, waiting for the GPU. Only available when headless, surface
+// textures cannot be copied from.
+void SaveRenderOutputAsPNG(ES::Engine::Core &core, const std::filesystem::path &path);
+
+}
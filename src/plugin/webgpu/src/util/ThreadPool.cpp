@@ -0,0 +1,78 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (auto &worker : workers) worker.join();
+}
+
+size_t ThreadPool::consumeJobs(void (*invoke)(void *, size_t), void *context, size_t count) {
+    size_t done = 0;
+    for (size_t index = nextIndex.fetch_add(1); index < count; index = nextIndex.fetch_add(1)) {
+        invoke(context, index);
+        done++;
+    }
+    return done;
+}
+
+void ThreadPool::run(size_t count, void (*invoke)(void *, size_t), void *context) {
+    if (count == 0) return;
+
+    {
+        std::unique_lock lock(mutex);
+        // A worker waking up late for the previous job may still be reading the counter
+        doneCondition.wait(lock, [this] { return activeWorkers == 0; });
+        jobInvoke = invoke;
+        jobContext = context;
+        jobCount = count;
+        remainingCount = count;
+        nextIndex = 0;
+        generation++;
+    }
+    wakeCondition.notify_all();
+
+    size_t done = consumeJobs(invoke, context, count);
+
+    std::unique_lock lock(mutex);
+    remainingCount -= done;
+    doneCondition.wait(lock, [this] { return remainingCount == 0 && activeWorkers == 0; });
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seenGeneration = 0;
+
+    while (true) {
+        void (*invoke)(void *, size_t);
+        void *context;
+        size_t count;
+        {
+            std::unique_lock lock(mutex);
+            wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+            invoke = jobInvoke;
+            context = jobContext;
+            count = jobCount;
+            activeWorkers++;
+        }
+
+        size_t done = consumeJobs(invoke, context, count);
+
+        {
+            std::lock_guard lock(mutex);
+            remainingCount -= done;
+            activeWorkers--;
+        }
+        doneCondition.notify_all();
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of workers running one indexed job at a time, enough for the render graph to record passes in parallel.
+// Submitting a job does not allocate.
+class ThreadPool {
+    public:
+        explicit ThreadPool(size_t threadCount);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // Call job(i) for every i in [0, count), the calling thread takes part. Returns once every call is done.
+        template <typename Job>
+        void ParallelFor(size_t count, Job &&job) {
+            using JobType = std::remove_reference_t<Job>;
+            run(count, [](void *context, size_t index) { (*static_cast<JobType *>(context))(index); }, static_cast<void *>(&job));
+        }
+
+        size_t GetThreadCount() const { return workers.size(); }
+
+    private:
+        void run(size_t count, void (*invoke)(void *, size_t), void *context);
+        void workerLoop();
+        // Returns the number of calls made by this thread
+        size_t consumeJobs(void (*invoke)(void *, size_t), void *context, size_t count);
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wakeCondition;
+        std::condition_variable doneCondition;
+
+        void (*jobInvoke)(void *, size_t) = nullptr;
+        void *jobContext = nullptr;
+        size_t jobCount = 0;
+        std::atomic<size_t> nextIndex = 0;
+        size_t remainingCount = 0; // Guarded by mutex
+        size_t activeWorkers = 0; // Workers that picked the current job up, guarded by mutex
+        uint64_t generation = 0;
+        bool stopping = false;
+};
@@ -0,0 +1,122 @@
+#include "TransformKernel.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace ES::Plugin::WebGPU::Util {
+
+void TransformBatch::Clear() {
+	for (auto &component : components) component.clear();
+	outputs.clear();
+}
+
+void TransformBatch::Push(uint32_t output, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale, const glm::vec3 &vertexOffset, const glm::vec3 &vertexScale) {
+	const float values[ComponentCount] = {
+		position.x, position.y, position.z,
+		rotation.x, rotation.y, rotation.z, rotation.w,
+		scale.x, scale.y, scale.z,
+		vertexOffset.x, vertexOffset.y, vertexOffset.z,
+		vertexScale.x, vertexScale.y, vertexScale.z,
+	};
+	for (size_t c = 0; c < ComponentCount; c++) components[c].push_back(values[c]);
+	outputs.push_back(output);
+}
+
+// Every loop over the lanes has a fixed count and no branch, so the compiler turns them into vector instructions of the
+// target (SSE, AVX2 or NEON), or plain scalar code when there is none
+static void ComputeBlock(const TransformBatch &batch, size_t first, size_t lanes, glm::mat4 *modelMatrices, glm::mat4 *normalMatrices, size_t matrixStride) {
+	constexpr size_t W = TransformKernelWidth;
+
+	// A partial block is padded with identity transforms, its extra lanes are computed but not written
+	alignas(32) float in[TransformBatch::ComponentCount][W];
+	for (size_t c = 0; c < TransformBatch::ComponentCount; c++) {
+		bool one = c == TransformBatch::RotationW || (c >= TransformBatch::ScaleX && c <= TransformBatch::ScaleZ) || c >= TransformBatch::VertexScaleX;
+		std::copy_n(batch.components[c].data() + first, lanes, in[c]);
+		std::fill(in[c] + lanes, in[c] + W, one ? 1.0f : 0.0f);
+	}
+
+	// Rotation matrix, column by column, as glm::mat3_cast
+	alignas(32) float rotation[9][W];
+	for (size_t l = 0; l < W; l++) {
+		float x = in[TransformBatch::RotationX][l], y = in[TransformBatch::RotationY][l], z = in[TransformBatch::RotationZ][l], w = in[TransformBatch::RotationW][l];
+		rotation[0][l] = 1.0f - 2.0f * (y * y + z * z);
+		rotation[1][l] = 2.0f * (x * y + w * z);
+		rotation[2][l] = 2.0f * (x * z - w * y);
+		rotation[3][l] = 2.0f * (x * y - w * z);
+		rotation[4][l] = 1.0f - 2.0f * (x * x + z * z);
+		rotation[5][l] = 2.0f * (y * z + w * x);
+		rotation[6][l] = 2.0f * (x * z + w * y);
+		rotation[7][l] = 2.0f * (y * z - w * x);
+		rotation[8][l] = 1.0f - 2.0f * (x * x + y * y);
+	}
+
+	// (R * S)^-T = R * S^-1, a zero scale gives a zero column instead of infinities
+	alignas(32) float model[12][W];
+	alignas(32) float normal[9][W];
+	for (size_t column = 0; column < 3; column++) {
+		const float *scale = in[TransformBatch::ScaleX + column];
+		const float *vertexScale = in[TransformBatch::VertexScaleX + column];
+		alignas(32) float modelScale[W];
+		alignas(32) float inverseScale[W];
+		for (size_t l = 0; l < W; l++) {
+			modelScale[l] = scale[l] * vertexScale[l];
+			inverseScale[l] = 1.0f / (scale[l] != 0.0f ? scale[l] : std::numeric_limits<float>::infinity());
+		}
+		for (size_t row = 0; row < 3; row++) {
+			for (size_t l = 0; l < W; l++) {
+				model[column * 3 + row][l] = rotation[column * 3 + row][l] * modelScale[l];
+				normal[column * 3 + row][l] = rotation[column * 3 + row][l] * inverseScale[l];
+			}
+		}
+	}
+	// The vertex offset goes through the transform: R * (S * offset) + position
+	alignas(32) float offset[3][W];
+	for (size_t axis = 0; axis < 3; axis++) {
+		for (size_t l = 0; l < W; l++) offset[axis][l] = in[TransformBatch::VertexOffsetX + axis][l] * in[TransformBatch::ScaleX + axis][l];
+	}
+	for (size_t row = 0; row < 3; row++) {
+		for (size_t l = 0; l < W; l++) {
+			model[9 + row][l] = rotation[row][l] * offset[0][l] + rotation[3 + row][l] * offset[1][l] + rotation[6 + row][l] * offset[2][l] + in[TransformBatch::PositionX + row][l];
+		}
+	}
+
+	// Matrices are scattered to their slots, where the GPU expects them
+	for (size_t l = 0; l < lanes; l++) {
+		size_t output = size_t(batch.outputs[first + l]) * matrixStride;
+		glm::mat4 &modelMatrix = modelMatrices[output];
+		glm::mat4 &normalMatrix = normalMatrices[output];
+		for (size_t column = 0; column < 4; column++) {
+			bool linear = column < 3;
+			for (size_t row = 0; row < 3; row++) {
+				modelMatrix[column][row] = model[column * 3 + row][l];
+				normalMatrix[column][row] = linear ? normal[column * 3 + row][l] : 0.0f;
+			}
+			modelMatrix[column][3] = linear ? 0.0f : 1.0f;
+			normalMatrix[column][3] = linear ? 0.0f : 1.0f;
+		}
+	}
+}
+
+static void ComputeRange(const TransformBatch &batch, size_t begin, size_t end, glm::mat4 *modelMatrices, glm::mat4 *normalMatrices, size_t matrixStride) {
+	for (size_t first = begin; first < end; first += TransformKernelWidth) {
+		ComputeBlock(batch, first, std::min(TransformKernelWidth, end - first), modelMatrices, normalMatrices, matrixStride);
+	}
+}
+
+void ComputeTransformMatrices(const TransformBatch &batch, glm::mat4 *modelMatrices, glm::mat4 *normalMatrices, size_t matrixStride, ThreadPool *pool) {
+	size_t count = batch.Size();
+	if (pool == nullptr || count <= TransformKernelParallelThreshold) {
+		ComputeRange(batch, 0, count, modelMatrices, normalMatrices, matrixStride);
+		return;
+	}
+
+	// Chunks are a multiple of the block width, and every output is written by a single chunk
+	size_t chunkCount = (count + TransformKernelParallelThreshold - 1) / TransformKernelParallelThreshold;
+	pool->ParallelFor(chunkCount, [&](size_t chunk) {
+		size_t begin = chunk * TransformKernelParallelThreshold;
+		ComputeRange(batch, begin, std::min(count, begin + TransformKernelParallelThreshold), modelMatrices, normalMatrices, matrixStride);
+	});
+}
+
+}
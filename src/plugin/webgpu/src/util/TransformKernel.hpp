@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+class ThreadPool;
+
+namespace ES::Plugin::WebGPU::Util {
+
+// Transforms expanded by a block at a time, the lanes of a block are computed together: one AVX2 register of floats,
+// two NEON or SSE ones
+inline constexpr size_t TransformKernelWidth = 8;
+// Below this many transforms the kernel stays on the calling thread, above it is split in chunks of this size
+inline constexpr size_t TransformKernelParallelThreshold = 4096;
+
+// Transforms to expand into matrices, one array per component so each block reads contiguous lanes
+struct TransformBatch {
+	enum Component : uint8_t {
+		PositionX, PositionY, PositionZ,
+		RotationX, RotationY, RotationZ, RotationW,
+		ScaleX, ScaleY, ScaleZ,
+		// Maps the positions of the vertex buffer to local space before the transform (see Mesh::GetVertexToLocal)
+		VertexOffsetX, VertexOffsetY, VertexOffsetZ,
+		VertexScaleX, VertexScaleY, VertexScaleZ,
+		ComponentCount,
+	};
+
+	std::array<std::vector<float>, ComponentCount> components;
+	std::vector<uint32_t> outputs; // Matrix written for each transform
+
+	size_t Size() const { return outputs.size(); }
+	void Clear();
+	void Push(uint32_t output, const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale,
+		const glm::vec3 &vertexOffset = glm::vec3(0.0f), const glm::vec3 &vertexScale = glm::vec3(1.0f));
+};
+
+// For each transform, writes translate(position) * rotation * scale(scale) * translate(vertexOffset) *
+// scale(vertexScale) to modelMatrices[output * matrixStride], and the inverse transpose of the transform without the
+// vertex mapping to normalMatrices[output * matrixStride]. It is computed from the rotation and the scale directly,
+// without inverting a matrix. Its fourth row and column are those of the identity, shaders only use the upper 3x3.
+// Chunks run on pool above TransformKernelParallelThreshold, when it is given.
+void ComputeTransformMatrices(const TransformBatch &batch, glm::mat4 *modelMatrices, glm::mat4 *normalMatrices, size_t matrixStride, ThreadPool *pool = nullptr);
+
+}
@@ -1,6 +1,10 @@
 #include "webgpu.hpp"
 #include "UpdateLights.hpp"
 #include "structs.hpp"
+#include "FrameStats.hpp"
+#include "FramesInFlight.hpp"
+#include "RenderGraph.hpp"
+#include <algorithm>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/string_cast.hpp>
 
@@ -17,15 +21,15 @@ void UpdateLights(ES::Engine::Core &core)
     lightsBuffer.destroy();
     lightsBuffer.release();
 
-    wgpu::BufferDescriptor lightsBufferDesc(wgpu::Default);
-    lightsBufferDesc.size = sizeof(Light) * std::max(lights.size(), size_t(1)) + sizeof(uint32_t) + 12 /* (padding) */;
-    lightsBufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage;
-    lightsBufferDesc.label = wgpu::StringView("Lights Buffer");
-    lightsBuffer = device.createBuffer(lightsBufferDesc);
+    // UpdateBuffers fills the region of each frame before it is bound
+    auto &framesInFlight = core.GetResource<FramesInFlight>();
+    lightsBuffer = framesInFlight.CreateRing(device, "Lights Buffer", sizeof(Light) * std::max(lights.size(), size_t(1)) + sizeof(uint32_t) + 12 /* (padding) */, wgpu::BufferUsage::Storage);
 
     uint32_t lightsCount = static_cast<uint32_t>(lights.size());
-    queue.writeBuffer(lightsBuffer, 0, &lightsCount, sizeof(uint32_t));
-    queue.writeBuffer(lightsBuffer, sizeof(uint32_t), lights.data(), sizeof(Light) * lights.size());
+    uint64_t lightsOffset = framesInFlight.GetOffset(lightsBuffer);
+    queue.writeBuffer(lightsBuffer, lightsOffset, &lightsCount, sizeof(uint32_t));
+    queue.writeBuffer(lightsBuffer, lightsOffset + sizeof(uint32_t), lights.data(), sizeof(Light) * lights.size());
+    core.GetResource<FrameStats>().RecordUpload(sizeof(uint32_t) + sizeof(Light) * lights.size());
 
     bindGroups.groups["2"].release();
 
@@ -47,12 +51,18 @@ void UpdateLights(ES::Engine::Core &core)
 
     for (auto &additionalLight : additionalDirectionalLights) {
         additionalLight.bindGroup.release();
-        additionalLight.buffer.release();
     }
 
 
     additionalDirectionalLights.clear();
 
+    // One ring for the matrices of every directional light, each one bound at its own offset in the regions
+    size_t directionalCount = std::count_if(lights.begin(), lights.end(), [](const Light &light) { return light.type == Light::Type::Directional; });
+    uint64_t alignment = FramesInFlight::GetOffsetAlignment(device, wgpu::BufferUsage::Uniform);
+    uint64_t matrixStride = (sizeof(glm::mat4) + alignment - 1) / alignment * alignment;
+    if (additionalDirectionalLightsBuffer) additionalDirectionalLightsBuffer.release();
+    additionalDirectionalLightsBuffer = framesInFlight.CreateRing(device, "Additional Directional Lights Buffer", matrixStride * std::max(directionalCount, size_t(1)), wgpu::BufferUsage::Uniform);
+    uint64_t matricesOffset = framesInFlight.GetOffset(additionalDirectionalLightsBuffer);
 
     uint32_t lightIndex = 0;
     for (auto &light : lights) {
@@ -76,17 +86,14 @@ void UpdateLights(ES::Engine::Core &core)
             additionalDataLight.lightViewProj = lightSpaceMatrix;
             light.lightViewProjMatrix = lightSpaceMatrix;
 
-            wgpu::BufferDescriptor bufferDesc(wgpu::Default);
-            bufferDesc.size = sizeof(glm::mat4);
-            bufferDesc.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Uniform;
-            bufferDesc.label = wgpu::StringView("Additional Directional Light Buffer");
-            additionalDataLight.buffer = device.createBuffer(bufferDesc);
-
-            queue.writeBuffer(additionalDataLight.buffer, 0, &additionalDataLight.lightViewProj, sizeof(glm::mat4));
+            additionalDataLight.offset = lightIndex * matrixStride;
+            queue.writeBuffer(additionalDirectionalLightsBuffer, matricesOffset + additionalDataLight.offset, &additionalDataLight.lightViewProj, sizeof(glm::mat4));
+            core.GetResource<FrameStats>().RecordUpload(sizeof(glm::mat4));
 
             wgpu::BindGroupEntry bindingAdditionalDirectionalLights(wgpu::Default);
             bindingAdditionalDirectionalLights.binding = 0;
-            bindingAdditionalDirectionalLights.buffer = additionalDataLight.buffer;
+            bindingAdditionalDirectionalLights.buffer = additionalDirectionalLightsBuffer;
+            bindingAdditionalDirectionalLights.offset = additionalDataLight.offset;
             bindingAdditionalDirectionalLights.size = sizeof(glm::mat4);
 
             std::array<wgpu::BindGroupEntry, 1> additionalDirectionalLightsBindings = { bindingAdditionalDirectionalLights };
@@ -104,5 +111,8 @@ void UpdateLights(ES::Engine::Core &core)
             lightIndex++;
         }
     }
+
+    // The shadow bundles bind the groups of the lights
+    core.GetResource<RenderGraph>().InvalidateRecordedCommands();
 }
 }
@@ -5,6 +5,7 @@
 #include "webgpu.hpp"
 #include "Object.hpp"
 #include "Mesh.hpp"
+#include "RenderEncoder.hpp"
 
 #include "stb_image.h"
 
@@ -18,11 +19,6 @@ struct MyUniforms {
 };
 
 
-struct Uniforms {
-    glm::mat4 modelMatrix;
-    glm::mat4 normalModelMatrix;
-};
-
 struct Camera {
     glm::mat4 viewProjectionMatrix;
     glm::mat4 invViewProjectionMatrix;
@@ -52,12 +48,19 @@ static_assert(sizeof(Light) % 16 == 0, "Light struct must be 16 bytes for WebGPU
 
 struct AdditionalDirectionalLight {
 	glm::mat4 lightViewProj;
-	wgpu::BindGroup bindGroup = nullptr;
-	wgpu::Buffer buffer = nullptr;
+	wgpu::BindGroup bindGroup = nullptr; // Binds the matrix at offset, the region of the frame is the dynamic offset
+	uint64_t offset = 0; // Of the matrix in each region of additionalDirectionalLightsBuffer
 };
 inline wgpu::Sampler additionalDirectionalLightsSampler = nullptr;
+// FramesInFlight ring, each region holds the matrices of every directional light
+inline wgpu::Buffer additionalDirectionalLightsBuffer = nullptr;
 
 inline std::vector<AdditionalDirectionalLight> additionalDirectionalLights;
+// Views of the shadow map kept across frames: one per layer rendered by the shadow pass, and the array view sampled by
+// the deferred pass. Only updated before the render graph records, the shadow pass reads them from a worker.
+inline std::vector<wgpu::TextureView> shadowLayerViews;
+inline wgpu::TextureView shadowArrayView = nullptr;
+inline size_t shadowArrayViewLayerCount = 0;
 
 
 struct CameraData {
@@ -71,16 +74,31 @@ struct CameraData {
 	float aspectRatio = 800.0f / 800.0f;
 };
 
+// Thresholds of UpdateMeshLODs: a mesh is drawn with its coarsest LOD whose error covers at most this many pixels on
+// screen. Shadow maps use a larger threshold, their texels are already blurred by the filtering.
+struct MeshLODSettings {
+	bool enabled = true;
+	float pixelError = 1.0f;
+	float shadowPixelError = 4.0f;
+};
+
 struct ClearColor {
 	wgpu::Color value = { 0.05, 0.05, 0.05, 1.0 };
 };
 
+// Set when the lights changed during a frame, UpdateLights is called before the next render graph records
+struct LightsDirty {
+	bool value = false;
+};
+
 struct Name {
 	std::string value;
 };
 
 struct BindGroups {
 	std::map<std::string, wgpu::BindGroup> groups;
+	// Groups binding a FramesInFlight ring, their single dynamic offset selects the region of the frame
+	std::map<std::string, const wgpu::Buffer *> rings;
 };
 
 struct PipelineData {
@@ -100,6 +118,8 @@ struct Uniforms2D {
 };
 
 // TODO: store them is resource
+// uniformBuffer, uniform2DBuffer, skyboxBuffer, lightsBuffer and cameraBuffer are FramesInFlight rings, uniformsBuffer and
+// instancesBuffer are not (see FramesInFlight)
 inline wgpu::Buffer uniformBuffer = nullptr;
 inline wgpu::Buffer uniform2DBuffer = nullptr;
 inline wgpu::Buffer skyboxBuffer = nullptr;
@@ -109,7 +129,7 @@ inline wgpu::TextureFormat depthTextureFormat = wgpu::TextureFormat::Depth24Plus
 inline wgpu::Buffer cameraBuffer = nullptr;
 inline wgpu::Buffer transformsBuffer = nullptr;
 inline wgpu::Buffer uniformsBuffer = nullptr; // GBuffer uniforms
-inline uint32_t entityIndex = 0;
+inline wgpu::Buffer instancesBuffer = nullptr; // Uniforms slot of each instance drawn, see UpdateBufferUniforms
 
 
 struct BindGroupsLinks {
@@ -125,28 +145,77 @@ struct WindowResizeCallbacks {
 	std::list<std::function<void(ES::Engine::Core &, int width, int height)>> callbacks;
 };
 
+// What WindowColorTexture is: the window surface, or an offscreen texture when the plugin runs headless
+struct RenderOutput {
+	bool headless = false;
+	glm::uvec2 size = { 0, 0 };
+	wgpu::TextureFormat format = wgpu::TextureFormat::Undefined;
+};
+
+// Render target owned by the render graph, it only exists while a pass of the compiled plan uses it.
+// Two transient textures share one texture when they have the same format, usage and sizeScale, and the last pass of
+// the plan using one comes before the first pass using the other. A pass reading one texture and writing the other
+// keeps them apart: in the default graph, Deferred reads the RGBA16Float G-buffer and SkyboxOutput while writing
+// InputEndPostProcess, so nothing is shared. A chain of post-processes does share: with A -> B -> C, the input of B
+// and the output of C use the same texture, and any longer chain needs only two of them.
+// Its content is undefined before the first write of the frame, so the declaring pass has to clear it. When that pass
+// is disabled or culled, the graph clears it (to 0, depth to 1) before the first pass reading it.
+struct TransientTextureDescriptor {
+	std::string name;
+	wgpu::TextureFormat format = wgpu::TextureFormat::RGBA8Unorm;
+	wgpu::TextureUsage usage = wgpu::TextureUsage::RenderAttachment | wgpu::TextureUsage::TextureBinding;
+	glm::vec2 sizeScale = { 1.0f, 1.0f }; // Relative to the size of the graph external output
+};
+
 struct RenderPassData {
 	std::string name;
 	std::optional<std::string> shaderName;
 	PipelineType pipelineType;
 	wgpu::LoadOp loadOp = wgpu::LoadOp::Load;
-	std::optional<std::function<glm::vec4(ES::Engine::Core &)>> clearColor; // 0 to 1 range, nullptr if load operation is not clear
-	std::list<std::string> dependsOn;
+	// 0 to 1 range, nullptr if load operation is not clear. Plain function pointers like perEntityCallback, the
+	// callbacks run every frame.
+	glm::vec4 (*clearColor)(ES::Engine::Core &) = nullptr;
+	std::list<std::string> dependsOn; // Names of passes that must run before this one, regardless of insertion order
+	std::vector<std::string> inputTextureNames; // Textures sampled through bind groups, used to order and cull passes
 	std::vector<std::string> outputColorTextureName;
 	std::optional<std::string> outputDepthTextureName;
+	std::vector<TransientTextureDescriptor> transientTextures; // Outputs created by this pass and owned by the graph
 	std::vector<BindGroupsLinks> bindGroups;
-	std::optional<std::function<void(wgpu::RenderPassEncoder &renderPass, ES::Engine::Core &core)>> uniqueRenderCallback = std::nullopt;
-	std::optional<std::function<void(wgpu::RenderPassEncoder &renderPass, ES::Engine::Core &core, ES::Plugin::WebGPU::Component::Mesh &, ES::Plugin::Object::Component::Transform &, ES::Engine::Entity)>> perEntityCallback;
+	// Record the per-entity draws into a render bundle and replay it. 3D passes only record again when
+	// RenderGraph::InvalidateRecordedCommands says what they draw changed, see there.
+	bool useRenderBundle = false;
+	// Record on a worker thread, in parallel with the neighbouring passes of the plan that also allow it. Each iteration
+	// of a multiple pass is recorded on its own, at the same time as the others. Its callbacks then run on that worker:
+	// they may read what does not change while the graph executes, but must not write shared state (globals, resources,
+	// TextureManager entries...). What differs between the iterations of a multiple pass comes from their iteration
+	// argument, and what has to be created or updated is done by preMultiplePassCallback, which runs on the calling
+	// thread before any pass is recorded.
+	bool parallelRecording = false;
+	// Draw the 3D batches with the arguments written by GpuCulling for this view, the iterations of a multiple pass use
+	// the following views. Ignored when the culling is disabled or unsupported, except that light views always draw
+	// the shadow LODs (Mesh::shadowLod).
+	std::optional<uint32_t> cullingView = std::nullopt;
+	void (*uniqueRenderCallback)(wgpu::RenderPassEncoder &renderPass, ES::Engine::Core &core) = nullptr;
+	// Replaces the view of outputDepthTextureName, e.g. to render each iteration of a multiple pass in its own layer
+	wgpu::TextureView (*depthAttachmentView)(ES::Engine::Core &core, size_t iteration) = nullptr;
+	// Called once before the draws, to bind what is the same for every entity of the pass or of this iteration
+	void (*passCallback)(RenderEncoder &renderPass, ES::Engine::Core &core, size_t iteration) = nullptr;
+	// Plain function pointer, it is called for every entity of every pass and the built-in ones capture nothing. 3D passes
+	// call it once per InstanceBatches batch, with its first entity.
+	void (*perEntityCallback)(RenderEncoder &renderPass, ES::Engine::Core &core, ES::Plugin::WebGPU::Component::Mesh &, ES::Plugin::Object::Component::Transform &, ES::Engine::Entity) = nullptr;
 };
 
 struct MultipleRenderPassData {
 	std::string name;
 	RenderPassData pass;
-	std::function<size_t(ES::Engine::Core &)> getNumberOfPass;
-	std::optional<std::function<void(ES::Engine::Core &, RenderPassData &)>> preMultiplePassCallback;
-	std::optional<std::function<void(ES::Engine::Core &, RenderPassData &)>> prePassCallback;
-	std::optional<std::function<void(ES::Engine::Core &, RenderPassData &)>> postPassCallback;
-	std::optional<std::function<void(ES::Engine::Core &, RenderPassData &)>> postMultiplePassCallback;
+	size_t (*getNumberOfPass)(ES::Engine::Core &) = nullptr;
+	// Run on the thread calling RenderGraph::Execute, before the first and after the last pass of the plan is recorded
+	void (*preMultiplePassCallback)(ES::Engine::Core &, RenderPassData &) = nullptr;
+	void (*postMultiplePassCallback)(ES::Engine::Core &, RenderPassData &) = nullptr;
+	// Run on the recording thread around each iteration, possibly at the same time as for other iterations, see
+	// RenderPassData::parallelRecording
+	void (*prePassCallback)(ES::Engine::Core &, const RenderPassData &, size_t iteration) = nullptr;
+	void (*postPassCallback)(ES::Engine::Core &, const RenderPassData &, size_t iteration) = nullptr;
 };
 
 inline const std::array<float, 180> skyboxCube = {
@@ -9,6 +9,18 @@ add_repositories("package_repo https://github.com/EngineSquared/xrepo.git")
 
 add_requires("enginesquared webgpu")
 
+option("profiling")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Record CPU profiling zones in release mode, they are always recorded in debug mode")
+option_end()
+
+option("avx2")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Build the plugin for AVX2 CPUs, the transform kernel then computes 8 transforms per instruction instead of 4")
+option_end()
+
 target("PluginWebGPU")
     set_group(PLUGINS_GROUP_NAME)
     set_kind("static")
@@ -21,6 +33,14 @@ target("PluginWebGPU")
         add_defines("DEBUG")
     end
 
+    if is_mode("debug") or has_config("profiling") then
+        add_defines("ES_PROFILING", {public = true})
+    end
+
+    if has_config("avx2") then
+        add_vectorexts("avx2")
+    end
+
 
     add_files("src/**.cpp")
 
@@ -53,3 +53,23 @@ target(project_name)
     -- if is_plat("macosx") then
     --     add_cxxflags("-Weverything", "-Wno-c++98-compat", "-Wno-c++98-compat-pedantic", {force = true})
     -- end
+
+target(project_name .. "-bench")
+    set_kind("binary")
+    set_default(false)
+    add_packages("wgpu-native")
+    add_packages("stb")
+    add_packages("glfw3webgpu")
+    add_packages("lodepng")
+
+    add_packages("enginesquared")
+    add_deps("PluginWebGPU")
+
+    if is_mode("debug") then
+        add_defines("DEBUG")
+        add_defines("ES_DEBUG")
+    end
+
+    add_files("bench/**.cpp")
+
+    set_rundir("$(projectdir)")